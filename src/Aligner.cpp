@@ -3,6 +3,7 @@
 #include <fstream>
 #include <functional>
 #include <algorithm>
+#include <deque>
 #include <thread>
 #include <concurrentqueue.h> //https://github.com/cameron314/concurrentqueue
 #include <google/protobuf/util/json_util.h>
@@ -32,6 +33,8 @@ struct Seeder
 	size_t minimizerLength;
 	size_t minimizerWindowSize;
 	double minimizerSeedDensity;
+	double prescreenMinHitFraction;
+	bool minimizerMaximalMatches;
 	const MummerSeeder* mummerSeeder;
 	const MinimizerSeeder* minimizerSeeder;
 	const std::unordered_map<std::string, std::vector<SeedHit>>* fileSeeds;
@@ -42,6 +45,8 @@ struct Seeder
 		minimizerLength(params.minimizerLength),
 		minimizerWindowSize(params.minimizerWindowSize),
 		minimizerSeedDensity(params.minimizerSeedDensity),
+		prescreenMinHitFraction(params.prescreenMinHitFraction),
+		minimizerMaximalMatches(params.minimizerMaximalMatches),
 		mummerSeeder(mummerSeeder),
 		minimizerSeeder(minimizerSeeder),
 		fileSeeds(fileSeeds)
@@ -98,12 +103,35 @@ struct Seeder
 				return mummerSeeder->getMemSeeds(seq, memCount, mxmLength);
 			case Mode::Minimizer:
 				assert(minimizerSeeder != nullptr);
+				if (minimizerMaximalMatches) return minimizerSeeder->getMaximalMatchSeeds(seq, minimizerSeedDensity);
 				return minimizerSeeder->getSeeds(seq, minimizerSeedDensity);
 			case Mode::None:
 				assert(false);
 		}
 		return std::vector<SeedHit>{};
 	}
+	//seeds of seq[windowStart, windowEnd) in window coordinates
+	std::vector<SeedHit> getWindowSeeds(const std::string& seqName, const std::string& seq, size_t windowStart, size_t windowEnd) const
+	{
+		assert(windowEnd > windowStart);
+		assert(windowEnd <= seq.size());
+		if (mode != Mode::File) return getSeeds(seqName, seq.substr(windowStart, windowEnd - windowStart));
+		std::vector<SeedHit> result;
+		for (auto seed : getSeeds(seqName, seq))
+		{
+			if (seed.seqPos >= windowEnd || seed.seqPos + 1 < windowStart + seed.matchLen) continue;
+			seed.seqPos -= windowStart;
+			result.push_back(seed);
+		}
+		return result;
+	}
+	bool passesPrescreen(const std::string& seq) const
+	{
+		if (mode != Mode::Minimizer || prescreenMinHitFraction == 0) return true;
+		assert(minimizerSeeder != nullptr);
+		return minimizerSeeder->sampledHitFraction(seq, PrescreenSampleStride) >= prescreenMinHitFraction;
+	}
+	static constexpr size_t PrescreenSampleStride = 16;
 };
 
 struct AlignmentStats
@@ -123,6 +151,10 @@ struct AlignmentStats
 	bpInAlignments(0),
 	bpInFullAlignments(0),
 	allAlignmentsCount(0),
+	readsPrescreenRejected(0),
+	bpInReadsPrescreenRejected(0),
+	readsOutOfBudget(0),
+	readsBatchAligned(0),
 	assertionBroke(false)
 	{
 	}
@@ -140,6 +172,10 @@ struct AlignmentStats
 	std::atomic<size_t> bpInAlignments;
 	std::atomic<size_t> bpInFullAlignments;
 	std::atomic<size_t> allAlignmentsCount;
+	std::atomic<size_t> readsPrescreenRejected;
+	std::atomic<size_t> bpInReadsPrescreenRejected;
+	std::atomic<size_t> readsOutOfBudget;
+	std::atomic<size_t> readsBatchAligned;
 	std::atomic<bool> assertionBroke;
 };
 
@@ -310,6 +346,40 @@ void writeGAFToQueue(moodycamel::ProducerToken& token, const AlignerParams& para
 	QueueInsertSlowly(token, alignmentsOut, strstr.str());
 }
 
+void addNodePosToStream(std::stringstream& strstr, const AlignmentGraph& alignmentGraph, int nodeId)
+{
+	strstr << ((nodeId % 2 == 0) ? ">" : "<");
+	std::string name = alignmentGraph.OriginalNodeName(nodeId);
+	if (name == "")
+	{
+		strstr << nodeId / 2;
+	}
+	else
+	{
+		strstr << name;
+	}
+}
+
+//score-only records: read name, length, start and end, then the graph node and offset of the first and last aligned bp
+void writeScoresToQueue(moodycamel::ProducerToken& token, const AlignerParams& params, const AlignmentGraph& alignmentGraph, const std::string& readName, size_t readLength, moodycamel::ConcurrentQueue<std::string*>& scoresOut, const AlignmentResult& alignments)
+{
+	std::stringstream strstr;
+	for (size_t i = 0; i < alignments.alignments.size(); i++)
+	{
+		const auto& aln = alignments.alignments[i];
+		assert(!aln.alignmentFailed());
+		strstr << readName << "\t" << readLength << "\t" << aln.alignmentStart << "\t" << aln.alignmentEnd << "\t";
+		addNodePosToStream(strstr, alignmentGraph, aln.alignmentStartPos.node);
+		strstr << "\t" << aln.alignmentStartPos.nodeOffset << "\t";
+		addNodePosToStream(strstr, alignmentGraph, aln.alignmentEndPos.node);
+		strstr << "\t" << aln.alignmentEndPos.nodeOffset << "\t" << aln.mappingQuality;
+		strstr << "\t" << "NM:i:" << aln.alignmentScore << "\t" << "AS:f:" << aln.alignmentXScore;
+		if (aln.budgetExhausted) strstr << "\t" << "be:i:1";
+		strstr << '\n';
+	}
+	QueueInsertSlowly(token, scoresOut, strstr.str());
+}
+
 void writeCorrectedToQueue(moodycamel::ProducerToken& token, const AlignerParams& params, const std::string& readName, const std::string& original, size_t maxOverlap, moodycamel::ConcurrentQueue<std::string*>& correctedOut, const AlignmentResult& alignments)
 {
 	std::stringstream strstr;
@@ -388,21 +458,149 @@ std::string hpcCollapse(const std::string& read)
 	return result;
 }
 
-void runComponentMappings(const AlignmentGraph& alignmentGraph, moodycamel::ConcurrentQueue<std::shared_ptr<FastQ>>& readFastqsQueue, std::atomic<bool>& readStreamingFinished, int threadnum, const Seeder& seeder, AlignerParams params, moodycamel::ConcurrentQueue<std::string*>& GAMOut, moodycamel::ConcurrentQueue<std::string*>& JSONOut, moodycamel::ConcurrentQueue<std::string*>& GAFOut, moodycamel::ConcurrentQueue<std::string*>& correctedOut, moodycamel::ConcurrentQueue<std::string*>& correctedClippedOut, moodycamel::ConcurrentQueue<std::string*>& deallocqueue, AlignmentStats& stats)
+//seeds and aligns overlapping windows of a long read independently, idle threads take windows of this read
+AlignmentResult alignInWindows(const AlignmentGraph& alignmentGraph, const FastQ& fastq, const Seeder& seeder, const AlignerParams& params, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState, AlignmentStats& stats)
+{
+	assert(params.windowSize > params.windowOverlap);
+	std::vector<size_t> windowStarts;
+	for (size_t start = 0; ; start += params.windowSize - params.windowOverlap)
+	{
+		windowStarts.push_back(start);
+		if (start + params.windowSize >= fastq.sequence.size()) break;
+	}
+	std::vector<AlignmentResult> windowResults;
+	windowResults.resize(windowStarts.size());
+	std::atomic<bool> hasSeeds { false };
+	std::vector<std::function<void(GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState&)>> tasks;
+	for (size_t i = 0; i < windowStarts.size(); i++)
+	{
+		tasks.emplace_back([&alignmentGraph, &fastq, &seeder, &params, &stats, &windowStarts, &windowResults, &hasSeeds, i](GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& state)
+		{
+			size_t windowEnd = std::min(windowStarts[i] + params.windowSize, fastq.sequence.size());
+			std::string windowSequence = fastq.sequence.substr(windowStarts[i], windowEnd - windowStarts[i]);
+			std::vector<SeedHit> seeds = seeder.getWindowSeeds(fastq.seq_id, fastq.sequence, windowStarts[i], windowEnd);
+			stats.seeds += seeds.size();
+			if (seeds.size() == 0) return;
+			stats.seedsFound += seeds.size();
+			hasSeeds = true;
+			if (params.multiseedDP)
+			{
+				PrepareMultiseeds(alignmentGraph, seeds, windowSequence.size());
+				windowResults[i] = AlignMultiseed(alignmentGraph, fastq.seq_id, windowSequence, params.alignmentBandwidth, params.rampBandwidth, params.maxCellsPerSlice, !params.verboseMode, !params.tryAllSeeds, seeds, state, params.seedClusterMinSize, params.seedExtendDensity, params.preciseClippingIdentityCutoff, params.Xdropcutoff, params.multimapScoreFraction);
+			}
+			else
+			{
+				OrderSeeds(alignmentGraph, seeds);
+				windowResults[i] = AlignOneWay(alignmentGraph, fastq.seq_id, windowSequence, params.alignmentBandwidth, params.rampBandwidth, params.maxCellsPerSlice, !params.verboseMode, !params.tryAllSeeds, seeds, state, params.seedClusterMinSize, params.seedExtendDensity, params.preciseClippingIdentityCutoff, params.Xdropcutoff, params.multimapScoreFraction, params.selectionECutoff, params.minAlignmentScore, params.DPCheckpointInterval, params.wavefrontMaxDivergence, params.scoreOnly);
+			}
+		});
+	}
+	reusableState.runTasks(tasks);
+	//counted like the seed path, whether or not any window aligns
+	if (hasSeeds)
+	{
+		stats.readsWithASeed += 1;
+		stats.bpInReadsWithASeed += fastq.sequence.size();
+	}
+	AlignmentResult result = StitchWindows(alignmentGraph, fastq.seq_id, fastq.sequence, windowStarts, windowResults, params.preciseClippingIdentityCutoff);
+	if (params.multiseedDP) AlignmentSelection::AddMappingQualities(result.alignments);
+	return result;
+}
+
+//the longest reads that fit in the lanes of a short read batch
+constexpr size_t ShortReadBatchMaxLength = 256;
+
+//a read taken from the input queue, possibly already seeded and aligned in a short read batch
+struct BufferedRead
+{
+	BufferedRead(std::shared_ptr<FastQ> fastq) :
+	fastq(fastq),
+	seeds(),
+	seeded(false),
+	batchAlignments(),
+	batchAligned(false)
+	{
+	}
+	std::shared_ptr<FastQ> fastq;
+	std::vector<SeedHit> seeds;
+	bool seeded;
+	AlignmentResult batchAlignments;
+	bool batchAligned;
+};
+
+//seeds the short reads of the buffer and aligns the reads with exactly one seed together from that seed
+//the batch gives one alignment per read, so reads with more seeds or with --try-all-seeds go through the seed loop for their secondary alignments
+//reads which don't get a good alignment keep their ordered seeds and are aligned normally
+void alignShortReadBatch(const AlignmentGraph& alignmentGraph, std::deque<BufferedRead>& reads, const Seeder& seeder, const AlignerParams& params, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState)
+{
+	std::vector<size_t> batched;
+	std::vector<std::string> seq_ids;
+	std::vector<std::string> sequences;
+	std::vector<SeedHit> seedHits;
+	for (size_t i = 0; i < reads.size(); i++)
+	{
+		const FastQ& fastq = *reads[i].fastq;
+		if (fastq.sequence.size() > ShortReadBatchMaxLength) continue;
+		if (params.windowSplitLength > 0 && fastq.sequence.size() > params.windowSplitLength) continue;
+		try
+		{
+			if (!seeder.passesPrescreen(fastq.sequence)) continue;
+			reads[i].seeds = seeder.getSeeds(fastq.seq_id, fastq.sequence);
+			if (reads[i].seeds.size() > 0) OrderSeeds(alignmentGraph, reads[i].seeds);
+			reads[i].seeded = true;
+		}
+		catch (const ThreadReadAssertion::AssertionFailure& a)
+		{
+			reads[i].seeds.clear();
+			reads[i].seeded = false;
+			continue;
+		}
+		if (params.tryAllSeeds || reads[i].seeds.size() != 1) continue;
+		batched.push_back(i);
+		seq_ids.push_back(fastq.seq_id);
+		sequences.push_back(fastq.sequence);
+		seedHits.push_back(reads[i].seeds[0]);
+	}
+	if (batched.size() == 0) return;
+	std::vector<AlignmentResult> results;
+	try
+	{
+		results = AlignShortReadBatch(alignmentGraph, seq_ids, sequences, params.alignmentBandwidth, params.rampBandwidth, params.maxCellsPerSlice, !params.verboseMode, seedHits, reusableState, params.preciseClippingIdentityCutoff, params.Xdropcutoff);
+	}
+	catch (const ThreadReadAssertion::AssertionFailure& a)
+	{
+		reusableState.clear();
+		return;
+	}
+	for (size_t i = 0; i < batched.size(); i++)
+	{
+		if (results[i].alignments.size() == 0) continue;
+		reads[batched[i]].batchAlignments = std::move(results[i]);
+		reads[batched[i]].batchAligned = true;
+	}
+}
+
+void runComponentMappings(const AlignmentGraph& alignmentGraph, moodycamel::ConcurrentQueue<std::shared_ptr<FastQ>>& readFastqsQueue, std::atomic<bool>& readStreamingFinished, int threadnum, const Seeder& seeder, AlignerParams params, moodycamel::ConcurrentQueue<std::string*>& GAMOut, moodycamel::ConcurrentQueue<std::string*>& JSONOut, moodycamel::ConcurrentQueue<std::string*>& GAFOut, moodycamel::ConcurrentQueue<std::string*>& scoresOut, moodycamel::ConcurrentQueue<std::string*>& correctedOut, moodycamel::ConcurrentQueue<std::string*>& correctedClippedOut, moodycamel::ConcurrentQueue<std::string*>& deallocqueue, AlignmentStats& stats, WorkStealingPool<GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState>& taskPool, std::shared_ptr<GraphAlignerCommon<size_t, int32_t, uint64_t>::FullStartSliceCache> fullStartSlices)
 {
 	moodycamel::ProducerToken GAMToken { GAMOut };
 	moodycamel::ProducerToken JSONToken { JSONOut };
 	moodycamel::ProducerToken GAFToken { GAFOut };
+	moodycamel::ProducerToken scoresToken { scoresOut };
 	moodycamel::ProducerToken correctedToken { correctedOut };
 	moodycamel::ProducerToken clippedToken { correctedClippedOut };
 	assertSetNoRead("Before any read");
-	GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState reusableState { alignmentGraph, params.alignmentBandwidth };
+	GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState reusableState { alignmentGraph, std::max(params.alignmentBandwidth, params.rampBandwidth) };
+	reusableState.taskPool = &taskPool;
+	reusableState.taskWorker = threadnum;
+	reusableState.parallelBandMinNodes = params.parallelBandMinNodes;
+	reusableState.fullStartSlices = fullStartSlices;
 	AlignmentSelection::SelectionOptions selectionOptions;
 	selectionOptions.graphSize = alignmentGraph.SizeInBP();
 	selectionOptions.ECutoff = params.selectionECutoff;
 	selectionOptions.minAlignmentScore = params.minAlignmentScore;
 	selectionOptions.EValueCalc = EValueCalculator { params.preciseClippingIdentityCutoff };
 	selectionOptions.AlignmentScoreFractionCutoff = params.multimapScoreFraction;
+	std::deque<BufferedRead> readBuffer;
 	BufferedWriter cerroutput;
 	BufferedWriter coutoutput;
 	if (params.verboseMode)
@@ -417,17 +615,41 @@ void runComponentMappings(const AlignmentGraph& alignmentGraph, moodycamel::Conc
 		{
 			delete dealloc;
 		}
-		std::shared_ptr<FastQ> fastq = nullptr;
-		while (fastq == nullptr && !readFastqsQueue.try_dequeue(fastq))
+		if (readBuffer.size() == 0)
 		{
-			bool tryBreaking = readStreamingFinished;
-			if (!readFastqsQueue.try_dequeue(fastq) && tryBreaking) break;
-			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			std::shared_ptr<FastQ> fastq = nullptr;
+			taskPool.beginIdle();
+			while (fastq == nullptr && !readFastqsQueue.try_dequeue(fastq))
+			{
+				bool tryBreaking = readStreamingFinished;
+				if (!readFastqsQueue.try_dequeue(fastq) && tryBreaking) break;
+				taskPool.stealOrWait(threadnum, reusableState, std::chrono::milliseconds(10));
+			}
+			taskPool.endIdle();
+			if (fastq == nullptr) break;
+			readBuffer.emplace_back(fastq);
+			if (params.shortReadBatchSize > 1)
+			{
+				std::vector<std::shared_ptr<FastQ>> more;
+				more.resize(params.shortReadBatchSize - 1);
+				size_t got = readFastqsQueue.try_dequeue_bulk(more.begin(), more.size());
+				for (size_t i = 0; i < got; i++)
+				{
+					readBuffer.emplace_back(more[i]);
+				}
+			}
+			for (auto& read : readBuffer)
+			{
+				assert(read.fastq->quality.size() == 0);
+				if (params.hpcCollapse) read.fastq->sequence = hpcCollapse(read.fastq->sequence);
+			}
+			//runs before the reads' budgets are started and isn't charged to them, the batch work per read is bounded by the read length and the batch region size
+			if (params.shortReadBatchSize > 0 && seeder.mode != Seeder::Mode::None) alignShortReadBatch(alignmentGraph, readBuffer, seeder, params, reusableState);
 		}
-		if (fastq == nullptr) break;
+		BufferedRead buffered = std::move(readBuffer.front());
+		readBuffer.pop_front();
+		std::shared_ptr<FastQ> fastq = buffered.fastq;
 		assertSetNoRead(fastq->seq_id);
-		assert(fastq->quality.size() == 0);
-		if (params.hpcCollapse) fastq->sequence = hpcCollapse(fastq->sequence);
 		coutoutput << "Read " << fastq->seq_id << " size " << fastq->sequence.size() << "bp" << BufferedWriter::Flush;
 		selectionOptions.readSize = fastq->sequence.size();
 		stats.reads += 1;
@@ -436,15 +658,43 @@ void runComponentMappings(const AlignmentGraph& alignmentGraph, moodycamel::Conc
 		AlignmentResult alignments;
 
 		size_t alntimems = 0;
+		reusableState.budget.start(params.readTimeBudget, params.readCellBudget);
 		try
 		{
-			if (seeder.mode != Seeder::Mode::None)
+			if (!buffered.seeded && !seeder.passesPrescreen(fastq->sequence))
+			{
+				coutoutput << "Read " << fastq->seq_id << " rejected by seed prescreen" << BufferedWriter::Flush;
+				cerroutput << "Read " << fastq->seq_id << " rejected by seed prescreen" << BufferedWriter::Flush;
+				coutoutput << "Read " << fastq->seq_id << " alignment failed" << BufferedWriter::Flush;
+				cerroutput << "Read " << fastq->seq_id << " alignment failed" << BufferedWriter::Flush;
+				stats.readsPrescreenRejected += 1;
+				stats.bpInReadsPrescreenRejected += fastq->sequence.size();
+				if (params.outputCorrectedFile != "") writeCorrectedToQueue(correctedToken, params, fastq->seq_id, fastq->sequence, alignmentGraph.getDBGoverlap(), correctedOut, alignments);
+				continue;
+			}
+			if (seeder.mode != Seeder::Mode::None && params.windowSplitLength > 0 && fastq->sequence.size() > params.windowSplitLength)
 			{
-				auto timeStart = std::chrono::system_clock::now();
-				std::vector<SeedHit> seeds = seeder.getSeeds(fastq->seq_id, fastq->sequence);
-				auto timeEnd = std::chrono::system_clock::now();
-				size_t time = std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - timeStart).count();
-				coutoutput << "Read " << fastq->seq_id << " seeding took " << time << "ms" << BufferedWriter::Flush;
+				auto alntimeStart = std::chrono::system_clock::now();
+				alignments = alignInWindows(alignmentGraph, *fastq, seeder, params, reusableState, stats);
+				auto alntimeEnd = std::chrono::system_clock::now();
+				alntimems = std::chrono::duration_cast<std::chrono::milliseconds>(alntimeEnd - alntimeStart).count();
+				coutoutput << "Read " << fastq->seq_id << " aligned in windows, " << alignments.alignments.size() << " stitched alignments" << BufferedWriter::Flush;
+			}
+			else if (seeder.mode != Seeder::Mode::None)
+			{
+				std::vector<SeedHit> seeds;
+				if (buffered.seeded)
+				{
+					seeds = std::move(buffered.seeds);
+				}
+				else
+				{
+					auto timeStart = std::chrono::system_clock::now();
+					seeds = seeder.getSeeds(fastq->seq_id, fastq->sequence);
+					auto timeEnd = std::chrono::system_clock::now();
+					size_t time = std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - timeStart).count();
+					coutoutput << "Read " << fastq->seq_id << " seeding took " << time << "ms" << BufferedWriter::Flush;
+				}
 				stats.seeds += seeds.size();
 				if (seeds.size() == 0)
 				{
@@ -463,22 +713,38 @@ void runComponentMappings(const AlignmentGraph& alignmentGraph, moodycamel::Conc
 				{
 					PrepareMultiseeds(alignmentGraph, seeds, fastq->sequence.size());
 				}
-				else
+				else if (!buffered.seeded)
 				{
 					OrderSeeds(alignmentGraph, seeds);
 				}
 				auto clusterTimeEnd = std::chrono::system_clock::now();
 				size_t clusterTime = std::chrono::duration_cast<std::chrono::milliseconds>(clusterTimeEnd - clusterTimeStart).count();
 				coutoutput << "Read " << fastq->seq_id << " clustering took " << clusterTime << "ms" << BufferedWriter::Flush;
+				if (reusableState.budget.exhausted())
+				{
+					coutoutput << "Read " << fastq->seq_id << " ran out of budget during seeding" << BufferedWriter::Flush;
+					cerroutput << "Read " << fastq->seq_id << " ran out of budget during seeding" << BufferedWriter::Flush;
+					coutoutput << "Read " << fastq->seq_id << " alignment failed" << BufferedWriter::Flush;
+					cerroutput << "Read " << fastq->seq_id << " alignment failed" << BufferedWriter::Flush;
+					stats.readsOutOfBudget += 1;
+					if (params.outputCorrectedFile != "") writeCorrectedToQueue(correctedToken, params, fastq->seq_id, fastq->sequence, alignmentGraph.getDBGoverlap(), correctedOut, alignments);
+					continue;
+				}
 				auto alntimeStart = std::chrono::system_clock::now();
-				if (params.multiseedDP)
+				if (buffered.batchAligned)
 				{
-					alignments = AlignMultiseed(alignmentGraph, fastq->seq_id, fastq->sequence, params.alignmentBandwidth, params.maxCellsPerSlice, !params.verboseMode, !params.tryAllSeeds, seeds, reusableState, params.seedClusterMinSize, params.seedExtendDensity, params.preciseClippingIdentityCutoff, params.Xdropcutoff, params.multimapScoreFraction);
+					alignments = std::move(buffered.batchAlignments);
+					stats.readsBatchAligned += 1;
+					coutoutput << "Read " << fastq->seq_id << " aligned in a short read batch" << BufferedWriter::Flush;
+				}
+				else if (params.multiseedDP)
+				{
+					alignments = AlignMultiseed(alignmentGraph, fastq->seq_id, fastq->sequence, params.alignmentBandwidth, params.rampBandwidth, params.maxCellsPerSlice, !params.verboseMode, !params.tryAllSeeds, seeds, reusableState, params.seedClusterMinSize, params.seedExtendDensity, params.preciseClippingIdentityCutoff, params.Xdropcutoff, params.multimapScoreFraction);
 					AlignmentSelection::AddMappingQualities(alignments.alignments);
 				}
 				else
 				{
-					alignments = AlignOneWay(alignmentGraph, fastq->seq_id, fastq->sequence, params.alignmentBandwidth, params.maxCellsPerSlice, !params.verboseMode, !params.tryAllSeeds, seeds, reusableState, params.seedClusterMinSize, params.seedExtendDensity, params.preciseClippingIdentityCutoff, params.Xdropcutoff);
+					alignments = AlignOneWay(alignmentGraph, fastq->seq_id, fastq->sequence, params.alignmentBandwidth, params.rampBandwidth, params.maxCellsPerSlice, !params.verboseMode, !params.tryAllSeeds, seeds, reusableState, params.seedClusterMinSize, params.seedExtendDensity, params.preciseClippingIdentityCutoff, params.Xdropcutoff, params.multimapScoreFraction, params.selectionECutoff, params.minAlignmentScore, params.DPCheckpointInterval, params.wavefrontMaxDivergence, params.scoreOnly);
 				}
 				auto alntimeEnd = std::chrono::system_clock::now();
 				alntimems = std::chrono::duration_cast<std::chrono::milliseconds>(alntimeEnd - alntimeStart).count();
@@ -486,7 +752,7 @@ void runComponentMappings(const AlignmentGraph& alignmentGraph, moodycamel::Conc
 			else
 			{
 				auto alntimeStart = std::chrono::system_clock::now();
-				alignments = AlignOneWay(alignmentGraph, fastq->seq_id, fastq->sequence, params.alignmentBandwidth, !params.verboseMode, reusableState, params.preciseClippingIdentityCutoff, params.Xdropcutoff, params.DPRestartStride);
+				alignments = AlignOneWay(alignmentGraph, fastq->seq_id, fastq->sequence, params.alignmentBandwidth, params.rampBandwidth, !params.verboseMode, reusableState, params.preciseClippingIdentityCutoff, params.Xdropcutoff, params.DPRestartStride, params.DPCheckpointInterval);
 				auto alntimeEnd = std::chrono::system_clock::now();
 				alntimems = std::chrono::duration_cast<std::chrono::milliseconds>(alntimeEnd - alntimeStart).count();
 			}
@@ -501,6 +767,12 @@ void runComponentMappings(const AlignmentGraph& alignmentGraph, moodycamel::Conc
 		}
 
 		stats.allAlignmentsCount += alignments.alignments.size();
+		if (alignments.budgetExhausted)
+		{
+			coutoutput << "Read " << fastq->seq_id << " ran out of budget, keeping partial alignments" << BufferedWriter::Flush;
+			cerroutput << "Read " << fastq->seq_id << " ran out of budget, keeping partial alignments" << BufferedWriter::Flush;
+			stats.readsOutOfBudget += 1;
+		}
 
 		coutoutput << "Read " << fastq->seq_id << " alignment took " << alntimems << "ms" << BufferedWriter::Flush;
 		if (alignments.alignments.size() > 0) alignments.alignments = AlignmentSelection::SelectAlignments(alignments.alignments, selectionOptions);
@@ -578,7 +850,7 @@ void runComponentMappings(const AlignmentGraph& alignmentGraph, moodycamel::Conc
 				stats.bpInFullAlignments += alignmentSize;
 			}
 			stats.bpInAlignments += alignmentSize;
-			if (params.outputCorrectedFile != "" || params.outputCorrectedClippedFile != "") AddCorrected(alignments.alignments[i]);
+			if (params.outputCorrectedFile != "" || params.outputCorrectedClippedFile != "") AddCorrected(alignmentGraph, alignments.alignments[i]);
 			alignmentpositions += std::to_string(alignments.alignments[i].alignmentStart) + "-" + std::to_string(alignments.alignments[i].alignmentEnd) + ", ";
 		}
 
@@ -591,6 +863,7 @@ void runComponentMappings(const AlignmentGraph& alignmentGraph, moodycamel::Conc
 			if (params.outputGAMFile != "") writeGAMToQueue(GAMToken, params, GAMOut, alignments);
 			if (params.outputJSONFile != "") writeJSONToQueue(JSONToken, params, JSONOut, alignments);
 			if (params.outputGAFFile != "") writeGAFToQueue(GAFToken, params, GAFOut, alignments);
+			if (params.outputScoresFile != "") writeScoresToQueue(scoresToken, params, alignmentGraph, fastq->seq_id, fastq->sequence.size(), scoresOut, alignments);
 			if (params.outputCorrectedFile != "") writeCorrectedToQueue(correctedToken, params, fastq->seq_id, fastq->sequence, alignmentGraph.getDBGoverlap(), correctedOut, alignments);
 			if (params.outputCorrectedClippedFile != "") writeCorrectedClippedToQueue(clippedToken, params, correctedClippedOut, alignments);
 		}
@@ -602,6 +875,14 @@ void runComponentMappings(const AlignmentGraph& alignmentGraph, moodycamel::Conc
 		}
 
 	}
+	//help the threads still aligning their last reads
+	taskPool.finishWorking();
+	taskPool.beginIdle();
+	while (taskPool.anyoneWorking())
+	{
+		taskPool.stealOrWait(threadnum, reusableState, std::chrono::milliseconds(1));
+	}
+	taskPool.endIdle();
 	assertSetNoRead("After all reads");
 	coutoutput << "Thread " << threadnum << " finished" << BufferedWriter::Flush;
 }
@@ -725,6 +1006,8 @@ void alignReads(AlignerParams params)
 			break;
 		case Seeder::Mode::Minimizer:
 			std::cout << "Minimizer seeds, length " << seeder.minimizerLength << ", window size " << seeder.minimizerWindowSize << ", density " << seeder.minimizerSeedDensity << std::endl;
+			if (seeder.minimizerMaximalMatches) std::cout << "Extend minimizer hits to maximal exact matches" << std::endl;
+			if (seeder.prescreenMinHitFraction != 0) std::cout << "Reject reads with < " << seeder.prescreenMinHitFraction * 100 << "% of sampled minimizers in the graph" << std::endl;
 			break;
 		case Seeder::Mode::None:
 			std::cout << "No seeds, calculate the entire first row. VERY SLOW!" << std::endl;
@@ -734,16 +1017,25 @@ void alignReads(AlignerParams params)
 	if (seeder.mode != Seeder::Mode::None && params.seedExtendDensity != -1) std::cout << "Extend up to best " << params.seedExtendDensity << " fraction of seeds" << std::endl;
 
 	std::cout << "Alignment bandwidth " << params.alignmentBandwidth;
+	if (params.rampBandwidth > params.alignmentBandwidth) std::cout << ", ramp bandwidth " << params.rampBandwidth;
 	if (params.maxCellsPerSlice != std::numeric_limits<size_t>::max()) std::cout << ", tangle effort " << params.maxCellsPerSlice;
+	if (params.parallelBandMinNodes > 0) std::cout << ", parallel band from " << params.parallelBandMinNodes << " nodes";
 	std::cout << std::endl;
 
 	if (params.selectionECutoff != -1) std::cout << "Discard alignments with an E-value > " << params.selectionECutoff << std::endl;
 	std::cout << "Clip alignment ends with identity < " << params.preciseClippingIdentityCutoff * 100 << "%" << std::endl;
 	std::cout << "X-drop DP score cutoff " << params.Xdropcutoff << std::endl;
+	if (params.readTimeBudget > 0) std::cout << "Read time budget " << params.readTimeBudget << "s" << std::endl;
+	if (params.readCellBudget > 0) std::cout << "Read cell budget " << params.readCellBudget << std::endl;
+	if (seeder.mode != Seeder::Mode::None && params.shortReadBatchSize > 0) std::cout << "Align reads up to " << ShortReadBatchMaxLength << "bp in short read batches, taking " << params.shortReadBatchSize << " reads at a time" << std::endl;
+	if (seeder.mode != Seeder::Mode::None && params.windowSplitLength > 0) std::cout << "Align reads longer than " << params.windowSplitLength << "bp in " << params.windowSize << "bp windows overlapping by " << params.windowOverlap << "bp" << std::endl;
+	if (seeder.mode != Seeder::Mode::None && params.wavefrontMaxDivergence > 0) std::cout << "Extend seeds with wavefront alignment, DP for extensions diverging more than " << params.wavefrontMaxDivergence * 100 << "%" << std::endl;
+	if (params.DPCheckpointInterval > 1) std::cout << "Store every " << params.DPCheckpointInterval << "th DP slice, recalculate the rest during backtrace" << std::endl;
 
 	if (params.outputGAMFile != "") std::cout << "write alignments to " << params.outputGAMFile << std::endl;
 	if (params.outputJSONFile != "") std::cout << "write alignments to " << params.outputJSONFile << std::endl;
 	if (params.outputGAFFile != "") std::cout << "write alignments to " << params.outputGAFFile << std::endl;
+	if (params.scoreOnly) std::cout << "write alignment ends and scores to " << params.outputScoresFile << ", no traces" << std::endl;
 	if (params.outputCorrectedFile != "") std::cout << "write corrected reads to " << params.outputCorrectedFile << std::endl;
 	if (params.outputCorrectedClippedFile != "") std::cout << "write corrected & clipped reads to " << params.outputCorrectedClippedFile << std::endl;
 
@@ -753,6 +1045,7 @@ void alignReads(AlignerParams params)
 
 	moodycamel::ConcurrentQueue<std::string*> outputGAM { 50, params.numThreads, params.numThreads };
 	moodycamel::ConcurrentQueue<std::string*> outputGAF { 50, params.numThreads, params.numThreads };
+	moodycamel::ConcurrentQueue<std::string*> outputScores { 50, params.numThreads, params.numThreads };
 	moodycamel::ConcurrentQueue<std::string*> outputJSON { 50, params.numThreads, params.numThreads };
 	moodycamel::ConcurrentQueue<std::string*> deallocAlns;
 	moodycamel::ConcurrentQueue<std::string*> outputCorrected { 50, params.numThreads, params.numThreads };
@@ -762,22 +1055,26 @@ void alignReads(AlignerParams params)
 	std::atomic<bool> allThreadsDone { false };
 	std::atomic<bool> GAMWriteDone { false };
 	std::atomic<bool> GAFWriteDone { false };
+	std::atomic<bool> scoresWriteDone { false };
 	std::atomic<bool> JSONWriteDone { false };
 	std::atomic<bool> correctedWriteDone { false };
 	std::atomic<bool> correctedClippedWriteDone { false };
 
 	std::cout << "Align" << std::endl;
 	AlignmentStats stats;
+	WorkStealingPool<GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState> taskPool { params.numThreads };
+	auto fullStartSlices = std::make_shared<GraphAlignerCommon<size_t, int32_t, uint64_t>::FullStartSliceCache>();
 	std::thread fastqThread { [files=params.fastqFiles, &readFastqsQueue, &readStreamingFinished]() { readFastqs(files, readFastqsQueue, readStreamingFinished); } };
 	std::thread GAMwriterThread { [file=params.outputGAMFile, &outputGAM, &deallocAlns, &allThreadsDone, &GAMWriteDone, verboseMode=params.verboseMode]() { if (file != "") consumeBytesAndWrite(file, outputGAM, deallocAlns, allThreadsDone, GAMWriteDone, verboseMode, false); else GAMWriteDone = true; } };
 	std::thread GAFwriterThread { [file=params.outputGAFFile, &outputGAF, &deallocAlns, &allThreadsDone, &GAFWriteDone, verboseMode=params.verboseMode]() { if (file != "") consumeBytesAndWrite(file, outputGAF, deallocAlns, allThreadsDone, GAFWriteDone, verboseMode, true); else GAFWriteDone = true; } };
+	std::thread scoresWriterThread { [file=params.outputScoresFile, &outputScores, &deallocAlns, &allThreadsDone, &scoresWriteDone, verboseMode=params.verboseMode]() { if (file != "") consumeBytesAndWrite(file, outputScores, deallocAlns, allThreadsDone, scoresWriteDone, verboseMode, true); else scoresWriteDone = true; } };
 	std::thread JSONwriterThread { [file=params.outputJSONFile, &outputJSON, &deallocAlns, &allThreadsDone, &JSONWriteDone, verboseMode=params.verboseMode]() { if (file != "") consumeBytesAndWrite(file, outputJSON, deallocAlns, allThreadsDone, JSONWriteDone, verboseMode, true); else JSONWriteDone = true; } };
 	std::thread correctedWriterThread { [file=params.outputCorrectedFile, &outputCorrected, &deallocAlns, &allThreadsDone, &correctedWriteDone, verboseMode=params.verboseMode, uncompressed=!params.compressCorrected]() { if (file != "") consumeBytesAndWrite(file, outputCorrected, deallocAlns, allThreadsDone, correctedWriteDone, verboseMode, uncompressed); else correctedWriteDone = true; } };
 	std::thread correctedClippedWriterThread { [file=params.outputCorrectedClippedFile, &outputCorrectedClipped, &deallocAlns, &allThreadsDone, &correctedClippedWriteDone, verboseMode=params.verboseMode, uncompressed=!params.compressClipped]() { if (file != "") consumeBytesAndWrite(file, outputCorrectedClipped, deallocAlns, allThreadsDone, correctedClippedWriteDone, verboseMode, uncompressed); else correctedClippedWriteDone = true; } };
 
 	for (size_t i = 0; i < params.numThreads; i++)
 	{
-		threads.emplace_back([&alignmentGraph, &readFastqsQueue, &readStreamingFinished, i, seeder, params, &outputGAM, &outputJSON, &outputGAF, &outputCorrected, &outputCorrectedClipped, &deallocAlns, &stats]() { runComponentMappings(alignmentGraph, readFastqsQueue, readStreamingFinished, i, seeder, params, outputGAM, outputJSON, outputGAF, outputCorrected, outputCorrectedClipped, deallocAlns, stats); });
+		threads.emplace_back([&alignmentGraph, &readFastqsQueue, &readStreamingFinished, i, seeder, params, &outputGAM, &outputJSON, &outputGAF, &outputScores, &outputCorrected, &outputCorrectedClipped, &deallocAlns, &stats, &taskPool, fullStartSlices]() { runComponentMappings(alignmentGraph, readFastqsQueue, readStreamingFinished, i, seeder, params, outputGAM, outputJSON, outputGAF, outputScores, outputCorrected, outputCorrectedClipped, deallocAlns, stats, taskPool, fullStartSlices); });
 	}
 
 	for (size_t i = 0; i < params.numThreads; i++)
@@ -790,6 +1087,7 @@ void alignReads(AlignerParams params)
 
 	GAMwriterThread.join();
 	GAFwriterThread.join();
+	scoresWriterThread.join();
 	JSONwriterThread.join();
 	correctedWriterThread.join();
 	correctedClippedWriterThread.join();
@@ -808,6 +1106,9 @@ void alignReads(AlignerParams params)
 	std::cout << "Input reads: " << stats.reads << " (" << stats.bpInReads << "bp)" << std::endl;
 	std::cout << "Seeds found: " << stats.seedsFound << std::endl;
 	std::cout << "Seeds extended: " << stats.seedsExtended << std::endl;
+	if (stats.readsOutOfBudget > 0) std::cout << "Reads out of budget: " << stats.readsOutOfBudget << std::endl;
+	if (stats.readsBatchAligned > 0) std::cout << "Reads aligned in short read batches: " << stats.readsBatchAligned << std::endl;
+	if (stats.readsPrescreenRejected > 0) std::cout << "Reads rejected by prescreen: " << stats.readsPrescreenRejected << " (" << stats.bpInReadsPrescreenRejected << "bp)" << std::endl;
 	std::cout << "Reads with a seed: " << stats.readsWithASeed << " (" << stats.bpInReadsWithASeed << "bp)" << std::endl;
 	std::cout << "Reads with an alignment: " << stats.readsWithAnAlignment << " (" << stats.bpFromReadsAligned << "bp)" << std::endl;
 	std::cout << "Alignments: " << stats.alignments << " (" << stats.bpInAlignments << "bp)";
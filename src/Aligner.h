@@ -13,12 +13,15 @@ struct AlignerParams
 	std::vector<std::string> fastqFiles;
 	size_t numThreads;
 	size_t alignmentBandwidth;
+	size_t rampBandwidth;
 	bool dynamicRowStart;
 	size_t maxCellsPerSlice;
+	size_t parallelBandMinNodes;
 	std::vector<std::string> seedFiles;
 	std::string outputGAMFile;
 	std::string outputJSONFile;
 	std::string outputGAFFile;
+	std::string outputScoresFile;
 	std::string outputCorrectedFile;
 	std::string outputCorrectedClippedFile;
 	bool verboseMode;
@@ -35,10 +38,21 @@ struct AlignerParams
 	double minimizerSeedDensity;
 	size_t seedClusterMinSize;
 	double minimizerDiscardMostNumerousFraction;
+	double prescreenMinHitFraction;
+	bool minimizerMaximalMatches;
 	double seedExtendDensity;
 	double preciseClippingIdentityCutoff;
 	int Xdropcutoff;
 	size_t DPRestartStride;
+	size_t DPCheckpointInterval;
+	double readTimeBudget;
+	size_t readCellBudget;
+	size_t windowSplitLength;
+	size_t windowSize;
+	size_t windowOverlap;
+	double wavefrontMaxDivergence;
+	size_t shortReadBatchSize;
+	bool scoreOnly;
 	bool multiseedDP;
 	double multimapScoreFraction;
 	bool cigarMatchMismatchMerge;
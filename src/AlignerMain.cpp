@@ -9,6 +9,7 @@
 #include "stream.hpp"
 #include "ThreadReadAssertion.h"
 #include "EValue.h"
+#include "WordSlice.h"
 
 int main(int argc, char** argv)
 {
@@ -17,14 +18,7 @@ int main(int argc, char** argv)
 	std::cout << "GraphAligner " << VERSION << std::endl;
 	std::cerr << "GraphAligner " << VERSION << std::endl;
 
-#ifndef NOBUILTINPOPCOUNT
-	if (__builtin_cpu_supports("popcnt") == 0)
-	{
-		std::cerr << "CPU does not support builtin popcount operation" << std::endl;
-		std::cerr << "recompile with -DNOBUILTINPOPCOUNT" << std::endl;
-		std::abort();
-	}
-#endif
+	std::cerr << "Bitvector kernel: " << CPUFeatures::KernelName() << std::endl;
 
 	struct sigaction act;
 	act.sa_handler = ThreadReadAssertion::signal;
@@ -36,7 +30,7 @@ int main(int argc, char** argv)
 	mandatory.add_options()
 		("graph,g", boost::program_options::value<std::string>(), "input graph (.gfa / .vg)")
 		("reads,f", boost::program_options::value<std::vector<std::string>>()->multitoken(), "input reads (fasta or fastq, uncompressed or gzipped)")
-		("alignments-out,a", boost::program_options::value<std::vector<std::string>>(), "output alignment file (.gaf/.gam/.json)")
+		("alignments-out,a", boost::program_options::value<std::vector<std::string>>(), "output alignment file (.gaf/.gam/.json, or .tsv with --score-only)")
 		("corrected-out", boost::program_options::value<std::string>(), "output corrected reads file (.fa/.fa.gz)")
 		("corrected-clipped-out", boost::program_options::value<std::string>(), "output corrected clipped reads file (.fa/.fa.gz)")
 	;
@@ -65,6 +59,8 @@ int main(int argc, char** argv)
 		("seeds-minimizer-windowsize", boost::program_options::value<size_t>(), "window size for minimizer seeding (int)")
 		("seeds-minimizer-density", boost::program_options::value<double>(), "keep approximately (arg * sequence length) least frequent minimizers (double) (-1 for all)")
 		("seeds-minimizer-ignore-frequent", boost::program_options::value<double>(), "ignore arg most frequent fraction of minimizers (double)")
+		("seeds-minimizer-mem", "extend minimizer hits to maximal exact matches along the graph")
+		("seeds-minimizer-prescreen", boost::program_options::value<double>(), "before seeding, reject reads where fewer than arg fraction of sampled k-mers are in the graph (double) (default 0, disabled)")
 		("seeds-mum-count", boost::program_options::value<size_t>(), "arg longest maximal unique matches (int) (-1 for all)")
 		("seeds-mem-count", boost::program_options::value<size_t>(), "arg longest maximal exact matches (int) (-1 for all)")
 		("seeds-mxm-length", boost::program_options::value<size_t>(), "minimum length for maximal unique / exact matches (int)")
@@ -73,9 +69,19 @@ int main(int argc, char** argv)
 	boost::program_options::options_description alignment("Extension");
 	alignment.add_options()
 		("bandwidth,b", boost::program_options::value<size_t>(), "alignment bandwidth (int)")
+		("ramp-bandwidth,B", boost::program_options::value<size_t>(), "rewind and realign with bandwidth arg where the alignment bandwidth fails (int) (default 0 for no ramping)")
 		("tangle-effort,C", boost::program_options::value<size_t>(), "tangle effort limit (int) (-1 for unlimited)")
+		("parallel-band", boost::program_options::value<size_t>(), "calculate slices whose band queue reaches arg nodes in rounds shared with idle threads (int) (default 0 for never)")
 		("X-drop", boost::program_options::value<int>(), "X-drop alignment ending score cutoff (int)")
 		("precise-clipping", boost::program_options::value<double>(), "clip the alignment ends with arg as the identity cutoff between correct / wrong alignments (double) (default 0.66)")
+		("read-time-budget", boost::program_options::value<double>(), "stop aligning a read after arg seconds and output its partial alignments (double) (default 0 for no limit)")
+		("read-cell-budget", boost::program_options::value<size_t>(), "stop aligning a read after processing arg DP cells and output its partial alignments (int) (default 0 for no limit)")
+		("window-split-length", boost::program_options::value<size_t>(), "align reads longer than arg bp in overlapping windows and stitch the window alignments together (int) (default 0 for no splitting)")
+		("window-size", boost::program_options::value<size_t>(), "read window length for --window-split-length (int) (default 50000)")
+		("window-overlap", boost::program_options::value<size_t>(), "overlap between consecutive read windows (int) (default 5000)")
+		("wavefront-divergence", boost::program_options::value<double>(), "extend seeds with wavefront alignment before DP, and use DP for extensions diverging more than arg (double) (default 0 for never)")
+		("short-read-batch", boost::program_options::value<size_t>(), "take arg reads from the input at a time and align the reads up to 256bp with a single seed together (int) (default 0 for no batching)")
+		("score-only", "don't keep DP tables or traces, only write the alignment ends and scores to a .tsv alignment output")
 	;
 	boost::program_options::options_description hidden("hidden");
 	hidden.add_options()
@@ -84,6 +90,7 @@ int main(int argc, char** argv)
 		("seeds-file,s", boost::program_options::value<std::vector<std::string>>()->multitoken(), "external seeds (.gam)")
 		("seedless-DP", "no seeding, instead use DP alignment algorithm for the entire first row. VERY SLOW except on tiny graphs")
 		("DP-restart-stride", boost::program_options::value<size_t>(), "if --seedless-DP doesn't span the entire read, restart after arg base pairs (int)")
+		("DP-checkpoint-interval", boost::program_options::value<size_t>(), "store only every arg'th DP slice and recalculate the rest during backtrace, trading time for memory (int) (default 0, store all)")
 		("seeds-mxm-cache-prefix", boost::program_options::value<std::string>(), "store the mum/mem seeding index to the disk for reuse, or reuse it if it exists (filename prefix)")
 		("hpc-collapse-reads", "Collapse homopolymer runs in input reads")
 	;
@@ -125,8 +132,10 @@ int main(int argc, char** argv)
 	params.outputCorrectedClippedFile = "";
 	params.numThreads = 1;
 	params.alignmentBandwidth = 0;
+	params.rampBandwidth = 0;
 	params.dynamicRowStart = false;
 	params.maxCellsPerSlice = std::numeric_limits<decltype(params.maxCellsPerSlice)>::max();
+	params.parallelBandMinNodes = 0;
 	params.verboseMode = false;
 	params.tryAllSeeds = false;
 	params.mxmLength = 20;
@@ -141,10 +150,21 @@ int main(int argc, char** argv)
 	params.minimizerWindowSize = 30;
 	params.seedClusterMinSize = 1;
 	params.minimizerDiscardMostNumerousFraction = 0.0002;
+	params.prescreenMinHitFraction = 0;
+	params.minimizerMaximalMatches = false;
 	params.seedExtendDensity = 0.002;
 	params.preciseClippingIdentityCutoff = 0.66;
 	params.Xdropcutoff = 50;
 	params.DPRestartStride = 0;
+	params.DPCheckpointInterval = 0;
+	params.readTimeBudget = 0;
+	params.readCellBudget = 0;
+	params.windowSplitLength = 0;
+	params.windowSize = 50000;
+	params.windowOverlap = 5000;
+	params.wavefrontMaxDivergence = 0;
+	params.shortReadBatchSize = 0;
+	params.scoreOnly = false;
 	params.multiseedDP = false;
 	params.multimapScoreFraction = 0.9;
 	params.cigarMatchMismatchMerge = false;
@@ -189,9 +209,12 @@ int main(int argc, char** argv)
 	if (vm.count("corrected-clipped-out")) params.outputCorrectedClippedFile = vm["corrected-clipped-out"].as<std::string>();
 	if (vm.count("threads")) params.numThreads = vm["threads"].as<size_t>();
 	if (vm.count("bandwidth")) params.alignmentBandwidth = vm["bandwidth"].as<size_t>();
+	if (vm.count("ramp-bandwidth")) params.rampBandwidth = vm["ramp-bandwidth"].as<size_t>();
 
 	if (vm.count("seeds-extend-density")) params.seedExtendDensity = vm["seeds-extend-density"].as<double>();
 	if (vm.count("seeds-minimizer-ignore-frequent")) params.minimizerDiscardMostNumerousFraction = vm["seeds-minimizer-ignore-frequent"].as<double>();
+	if (vm.count("seeds-minimizer-mem")) params.minimizerMaximalMatches = true;
+	if (vm.count("seeds-minimizer-prescreen")) params.prescreenMinHitFraction = vm["seeds-minimizer-prescreen"].as<double>();
 	if (vm.count("seeds-clustersize")) params.seedClusterMinSize = vm["seeds-clustersize"].as<size_t>();
 	if (vm.count("seeds-minimizer-density")) params.minimizerSeedDensity = vm["seeds-minimizer-density"].as<double>();
 	if (vm.count("seeds-minimizer-length")) params.minimizerLength = vm["seeds-minimizer-length"].as<size_t>();
@@ -203,10 +226,20 @@ int main(int argc, char** argv)
 	if (vm.count("seeds-mxm-cache-prefix")) params.seederCachePrefix = vm["seeds-mxm-cache-prefix"].as<std::string>();
 	if (vm.count("seedless-DP")) params.dynamicRowStart = true;
 	if (vm.count("DP-restart-stride")) params.DPRestartStride = vm["DP-restart-stride"].as<size_t>();
+	if (vm.count("DP-checkpoint-interval")) params.DPCheckpointInterval = vm["DP-checkpoint-interval"].as<size_t>();
 	if (vm.count("multiseed-DP")) params.multiseedDP = vm["multiseed-DP"].as<bool>();
 	if (vm.count("multimap-score-fraction")) params.multimapScoreFraction = vm["multimap-score-fraction"].as<double>();
 
 	if (vm.count("tangle-effort")) params.maxCellsPerSlice = vm["tangle-effort"].as<size_t>();
+	if (vm.count("parallel-band")) params.parallelBandMinNodes = vm["parallel-band"].as<size_t>();
+	if (vm.count("read-time-budget")) params.readTimeBudget = vm["read-time-budget"].as<double>();
+	if (vm.count("read-cell-budget")) params.readCellBudget = vm["read-cell-budget"].as<size_t>();
+	if (vm.count("window-split-length")) params.windowSplitLength = vm["window-split-length"].as<size_t>();
+	if (vm.count("window-size")) params.windowSize = vm["window-size"].as<size_t>();
+	if (vm.count("window-overlap")) params.windowOverlap = vm["window-overlap"].as<size_t>();
+	if (vm.count("wavefront-divergence")) params.wavefrontMaxDivergence = vm["wavefront-divergence"].as<double>();
+	if (vm.count("short-read-batch")) params.shortReadBatchSize = vm["short-read-batch"].as<size_t>();
+	if (vm.count("score-only")) params.scoreOnly = true;
 	if (vm.count("verbose")) params.verboseMode = true;
 	if (vm.count("try-all-seeds")) params.tryAllSeeds = true;
 	if (vm.count("cigar-match-mismatch")) params.cigarMatchMismatchMerge = true;
@@ -258,9 +291,36 @@ int main(int argc, char** argv)
 		{
 			params.outputGAFFile = file;
 		}
+		else if (file.size() >= 4 && file.substr(file.size()-4) == ".tsv")
+		{
+			params.outputScoresFile = file;
+		}
 		else
 		{
-			std::cerr << "unknown output alignment format (" << file << "), must be either .gaf, .gam or .json" << std::endl;
+			std::cerr << "unknown output alignment format (" << file << "), must be either .gaf, .gam, .json or .tsv" << std::endl;
+			paramError = true;
+		}
+	}
+	if (params.outputScoresFile != "" && !params.scoreOnly)
+	{
+		std::cerr << "score-only output (.tsv) must be enabled with --score-only" << std::endl;
+		paramError = true;
+	}
+	if (params.scoreOnly && params.outputScoresFile == "")
+	{
+		std::cerr << "--score-only needs a .tsv alignment output" << std::endl;
+		paramError = true;
+	}
+	if (params.scoreOnly)
+	{
+		if (params.outputGAMFile != "" || params.outputJSONFile != "" || params.outputGAFFile != "" || params.outputCorrectedFile != "" || params.outputCorrectedClippedFile != "")
+		{
+			std::cerr << "score-only output (.tsv) can't be combined with other outputs" << std::endl;
+			paramError = true;
+		}
+		if (params.dynamicRowStart || params.multiseedDP || params.windowSplitLength != 0)
+		{
+			std::cerr << "score-only output (.tsv) can't be used with seedless DP, multiseed DP or window splitting" << std::endl;
 			paramError = true;
 		}
 	}
@@ -284,6 +344,31 @@ int main(int argc, char** argv)
 		std::cerr << "alignment bandwidth must be >= 1" << std::endl;
 		paramError = true;
 	}
+	if (params.readTimeBudget < 0)
+	{
+		std::cerr << "read time budget must be >= 0" << std::endl;
+		paramError = true;
+	}
+	if (params.rampBandwidth != 0 && params.rampBandwidth <= params.alignmentBandwidth)
+	{
+		std::cerr << "ramp bandwidth must be > alignment bandwidth" << std::endl;
+		paramError = true;
+	}
+	if (params.windowSplitLength != 0 && params.windowOverlap >= params.windowSize)
+	{
+		std::cerr << "window overlap must be < window size" << std::endl;
+		paramError = true;
+	}
+	if (params.wavefrontMaxDivergence < 0 || params.wavefrontMaxDivergence >= 1)
+	{
+		std::cerr << "wavefront divergence must be >= 0 and < 1" << std::endl;
+		paramError = true;
+	}
+	if (params.shortReadBatchSize != 0 && (params.multiseedDP || params.scoreOnly))
+	{
+		std::cerr << "short read batches can't be used with multiseed DP or --score-only" << std::endl;
+		paramError = true;
+	}
 	if (params.mxmLength < 2)
 	{
 		std::cerr << "mum/mem minimum length must be >= 2" << std::endl;
@@ -299,6 +384,21 @@ int main(int argc, char** argv)
 		std::cerr << "Minimizer discard fraction must be 0 <= x < 1" << std::endl;
 		paramError = true;
 	}
+	if (params.prescreenMinHitFraction < 0 || params.prescreenMinHitFraction > 1)
+	{
+		std::cerr << "Minimizer prescreen fraction must be 0 <= x <= 1" << std::endl;
+		paramError = true;
+	}
+	if (params.prescreenMinHitFraction != 0 && params.minimizerSeedDensity == 0)
+	{
+		std::cerr << "--seeds-minimizer-prescreen requires minimizer seeding" << std::endl;
+		paramError = true;
+	}
+	if (params.minimizerMaximalMatches && params.minimizerSeedDensity == 0)
+	{
+		std::cerr << "--seeds-minimizer-mem requires minimizer seeding" << std::endl;
+		paramError = true;
+	}
 	if (params.minimizerSeedDensity < 0 && params.minimizerSeedDensity != -1)
 	{
 		std::cerr << "Minimizer density can't be negative" << std::endl;
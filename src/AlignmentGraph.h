@@ -151,6 +151,10 @@ private:
 	friend class GraphAlignerBitvectorCommon;
 	template <typename LengthType, typename ScoreType, typename Word>
 	friend class GraphAlignerBitvectorDijkstra;
+	template <typename LengthType, typename ScoreType, typename Word>
+	friend class GraphAlignerWavefront;
+	template <typename LengthType, typename ScoreType, typename Word>
+	friend class GraphAlignerBatch;
 	friend class DirectedGraph;
 	friend class MinimizerSeeder;
 };
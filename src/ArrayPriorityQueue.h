@@ -1,7 +1,8 @@
 #ifndef ArrayPriorityQueue_h
 #define ArrayPriorityQueue_h
 
-#include <queue>
+#include <cstdint>
+#include <vector>
 #include <phmap.h>
 #include "ThreadReadAssertion.h"
 
@@ -11,7 +12,9 @@ class ArrayPriorityQueue
 public:
 	constexpr bool IsComponentPriorityQueue() { return false; }
 	ArrayPriorityQueue(size_t maxPriority, size_t maxExtras) :
-	activeQueues(),
+	occupied(),
+	occupiedSummary(),
+	lowestSummaryWord(0),
 	extras(),
 	queues(),
 	numItems(0)
@@ -19,7 +22,9 @@ public:
 		initialize(maxPriority, maxExtras);
 	}
 	ArrayPriorityQueue() :
-	activeQueues(),
+	occupied(),
+	occupiedSummary(),
+	lowestSummaryWord(0),
 	extras(),
 	queues(),
 	numItems(0)
@@ -29,20 +34,26 @@ public:
 	typename std::enable_if<Sparse>::type initialize(size_t maxPriority, size_t maxExtras)
 	{
 		queues.resize(maxPriority);
+		occupied.resize((maxPriority + 63) / 64, 0);
+		occupiedSummary.resize((occupied.size() + 63) / 64, 0);
+		lowestSummaryWord = occupiedSummary.size();
 	}
 	template <bool Sparse = SparseStorage>
 	typename std::enable_if<!Sparse>::type initialize(size_t maxPriority, size_t maxExtras)
 	{
 		extras.resize(maxExtras, std::vector<T>{});
 		queues.resize(maxPriority);
+		occupied.resize((maxPriority + 63) / 64, 0);
+		occupiedSummary.resize((occupied.size() + 63) / 64, 0);
+		lowestSummaryWord = occupiedSummary.size();
 	}
 #ifdef NDEBUG
 	__attribute__((always_inline))
 #endif
 	T& top()
 	{
-		assert(activeQueues.size() > 0);
-		size_t queue = activeQueues.top();
+		assert(numItems > 0);
+		size_t queue = lowestActive();
 		assert(queues[queue].size() > 0);
 		return queues[queue].back();
 	}
@@ -51,10 +62,10 @@ public:
 #endif
 	void pop()
 	{
-		size_t queue = activeQueues.top();
+		size_t queue = lowestActive();
 		assert(queues[queue].size() > 0);
 		queues[queue].pop_back();
-		if (queues[queue].size() == 0) activeQueues.pop();
+		if (queues[queue].size() == 0) setInactive(queue);
 		numItems--;
 	}
 #ifdef NDEBUG
@@ -68,6 +79,11 @@ public:
 	{
 		assert(false);
 	}
+	size_t currentComponentSize()
+	{
+		assert(false);
+		return 0;
+	}
 #ifdef NDEBUG
 	__attribute__((always_inline))
 #endif
@@ -77,20 +93,21 @@ public:
 		queues[priority].push_back(item);
 		assert(SparseStorage || getId(item) < extras.size());
 		extras[getId(item)].push_back(item);
-		if (queues[priority].size() == 1) activeQueues.emplace(priority);
+		if (queues[priority].size() == 1) setActive(priority);
 		numItems++;
 	}
 	void clear()
 	{
-		while (activeQueues.size() > 0)
+		while (numItems > 0)
 		{
-			size_t queue = activeQueues.top();
+			size_t queue = lowestActive();
 			for (auto item : queues[queue])
 			{
 				removeExtras(getId(item));
 			}
+			numItems -= queues[queue].size();
 			queues[queue].clear();
-			activeQueues.pop();
+			setInactive(queue);
 		}
 		numItems = 0;
 		sparsify();
@@ -122,6 +139,35 @@ public:
 		return getVec(extras, index).size();
 	}
 private:
+	//two-level occupancy bitmap over the priorities, the lowest active priority is found with two tzcnts
+#ifdef NDEBUG
+	__attribute__((always_inline))
+#endif
+	size_t lowestActive()
+	{
+		assert(lowestSummaryWord < occupiedSummary.size());
+		while (occupiedSummary[lowestSummaryWord] == 0)
+		{
+			lowestSummaryWord++;
+			assert(lowestSummaryWord < occupiedSummary.size());
+		}
+		size_t word = lowestSummaryWord * 64 + __builtin_ctzll(occupiedSummary[lowestSummaryWord]);
+		assert(occupied[word] != 0);
+		return word * 64 + __builtin_ctzll(occupied[word]);
+	}
+	void setActive(size_t priority)
+	{
+		size_t word = priority / 64;
+		occupied[word] |= (uint64_t)1 << (priority % 64);
+		occupiedSummary[word / 64] |= (uint64_t)1 << (word % 64);
+		if (word / 64 < lowestSummaryWord) lowestSummaryWord = word / 64;
+	}
+	void setInactive(size_t priority)
+	{
+		size_t word = priority / 64;
+		occupied[word] &= ~((uint64_t)1 << (priority % 64));
+		if (occupied[word] == 0) occupiedSummary[word / 64] &= ~((uint64_t)1 << (word % 64));
+	}
 	const std::vector<T>& getVec(const std::vector<std::vector<T>>& list, size_t index) const
 	{
 		return list[index];
@@ -137,7 +183,9 @@ private:
 	{
 		return item.target;
 	}
-	std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> activeQueues;
+	std::vector<uint64_t> occupied;
+	std::vector<uint64_t> occupiedSummary;
+	size_t lowestSummaryWord;
 	typename std::conditional<SparseStorage, phmap::flat_hash_map<size_t, std::vector<T>>, std::vector<std::vector<T>>>::type extras;
 	std::vector<std::vector<T>> queues;
 	size_t numItems;
@@ -1,9 +1,14 @@
 #ifndef ComponentPriorityQueue_h
 #define ComponentPriorityQueue_h
 
-#include <queue>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
 #include <phmap.h>
 #include "ThreadReadAssertion.h"
+#include "EpochBitvector.h"
 
 template <typename T, bool SparseStorage>
 class ComponentPriorityQueue
@@ -20,14 +25,22 @@ class ComponentPriorityQueue
 public:
 	constexpr bool IsComponentPriorityQueue() { return true; }
 	ComponentPriorityQueue(size_t maxNode) :
-	activeQueues(),
+	currentComponent(),
+	componentBuckets(),
+	occupiedBuckets(0),
+	lastComponent(0),
+	numItems(0),
 	active(),
 	extras()
 	{
 		initialize(maxNode);
 	}
 	ComponentPriorityQueue() :
-	activeQueues(),
+	currentComponent(),
+	componentBuckets(),
+	occupiedBuckets(0),
+	lastComponent(0),
+	numItems(0),
 	active(),
 	extras()
 	{
@@ -35,21 +48,22 @@ public:
 	template <bool Sparse = SparseStorage>
 	typename std::enable_if<Sparse>::type initialize(size_t maxNode)
 	{
-		active.resize(maxNode, false);
+		active.resize(maxNode);
 	}
 	template <bool Sparse = SparseStorage>
 	typename std::enable_if<!Sparse>::type initialize(size_t maxNode)
 	{
 		extras.resize(maxNode);
-		active.resize(maxNode, false);
+		active.resize(maxNode);
 	}
 #ifdef NDEBUG
 	__attribute__((always_inline))
 #endif
 	T& top()
 	{
-		assert(activeQueues.size() > 0);
-		auto index = activeQueues.top().index;
+		assert(numItems > 0);
+		if (currentComponent.size() == 0) advanceComponent();
+		auto index = currentComponent[0].index;
 		assert(active[index]);
 		assert(extras[index].size() > 0);
 		return extras[index][0];
@@ -59,20 +73,23 @@ public:
 #endif
 	void pop()
 	{
-		assert(activeQueues.size() > 0);
-		size_t index = activeQueues.top().index;
+		assert(numItems > 0);
+		if (currentComponent.size() == 0) advanceComponent();
+		size_t index = currentComponent[0].index;
 		assert(active[index]);
 		assert(extras[index].size() > 0);
 		extras[index].clear();
 		active[index] = false;
-		activeQueues.pop();
+		std::pop_heap(currentComponent.begin(), currentComponent.end(), std::greater<PrioritizedItem>{});
+		currentComponent.pop_back();
+		numItems--;
 	}
 #ifdef NDEBUG
 	__attribute__((always_inline))
 #endif
 	size_t size() const
 	{
-		return activeQueues.size();
+		return numItems;
 	}
 	void insert(size_t component, const T& item)
 	{
@@ -88,21 +105,35 @@ public:
 		if (!active[index])
 		{
 			assert(extras[index].size() == 0);
-			activeQueues.emplace(component, score, index);
+			pushItem(PrioritizedItem { component, score, index });
+			numItems++;
 			active[index] = true;
 		}
 		extras[index].push_back(item);
 	}
 	void clear()
 	{
-		while (activeQueues.size() > 0)
+		for (auto item : currentComponent)
 		{
-			size_t index = activeQueues.top().index;
-			assert(active[index]);
-			removeExtras(index);
-			active[index] = false;
-			activeQueues.pop();
+			assert(active[item.index]);
+			removeExtras(item.index);
+			active[item.index] = false;
 		}
+		currentComponent.clear();
+		while (occupiedBuckets != 0)
+		{
+			size_t bucket = __builtin_ctzll(occupiedBuckets);
+			for (auto item : componentBuckets[bucket])
+			{
+				assert(active[item.index]);
+				removeExtras(item.index);
+				active[item.index] = false;
+			}
+			componentBuckets[bucket].clear();
+			occupiedBuckets &= occupiedBuckets - 1;
+		}
+		lastComponent = 0;
+		numItems = 0;
 		sparsify();
 	}
 	template<bool Sparse = SparseStorage>
@@ -130,11 +161,55 @@ public:
 		assert(SparseStorage ||index < extras.size());
 		return getVec(extras, index).size();
 	}
+	//items queued in the lowest component, these can be popped without the queue moving on to a later component
+	size_t currentComponentSize()
+	{
+		if (numItems > 0 && currentComponent.size() == 0) advanceComponent();
+		return currentComponent.size();
+	}
 	bool valid() const
 	{
 		return active.size() > 0;
 	}
 private:
+	//radix heap keyed by component, which only grows within a slice since edges never go to an earlier component
+	//items of the current component are kept in a small heap ordered by score
+	//componentBuckets[b] holds the items whose component differs from lastComponent first at bit b
+	void pushItem(const PrioritizedItem& item)
+	{
+		assert(item.component >= lastComponent);
+		if (item.component == lastComponent)
+		{
+			currentComponent.push_back(item);
+			std::push_heap(currentComponent.begin(), currentComponent.end(), std::greater<PrioritizedItem>{});
+			return;
+		}
+		size_t bucket = 63 - __builtin_clzll((uint64_t)(item.component ^ lastComponent));
+		componentBuckets[bucket].push_back(item);
+		occupiedBuckets |= (uint64_t)1 << bucket;
+	}
+	void advanceComponent()
+	{
+		assert(currentComponent.size() == 0);
+		assert(occupiedBuckets != 0);
+		size_t bucket = __builtin_ctzll(occupiedBuckets);
+		std::vector<PrioritizedItem> items;
+		std::swap(items, componentBuckets[bucket]);
+		occupiedBuckets &= ~((uint64_t)1 << bucket);
+		assert(items.size() > 0);
+		lastComponent = items[0].component;
+		for (auto item : items)
+		{
+			lastComponent = std::min(lastComponent, item.component);
+		}
+		for (auto item : items)
+		{
+			pushItem(item);
+		}
+		items.clear();
+		if (componentBuckets[bucket].capacity() == 0) std::swap(items, componentBuckets[bucket]);
+		assert(currentComponent.size() > 0);
+	}
 	const std::vector<T>& getVec(const std::vector<std::vector<T>>& list, size_t index) const
 	{
 		return list[index];
@@ -150,8 +225,12 @@ private:
 	{
 		return item.target;
 	}
-	std::priority_queue<PrioritizedItem, std::vector<PrioritizedItem>, std::greater<PrioritizedItem>> activeQueues;
-	std::vector<bool> active;
+	std::vector<PrioritizedItem> currentComponent;
+	std::array<std::vector<PrioritizedItem>, 64> componentBuckets;
+	uint64_t occupiedBuckets;
+	size_t lastComponent;
+	size_t numItems;
+	EpochBitvector active;
 	typename std::conditional<SparseStorage, phmap::flat_hash_map<size_t, std::vector<T>>, std::vector<std::vector<T>>>::type extras;
 };
 
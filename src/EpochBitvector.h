@@ -0,0 +1,158 @@
+#ifndef EpochBitvector_h
+#define EpochBitvector_h
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "ThreadReadAssertion.h"
+
+//bitvector over the graph nodes where only the pages containing set bits are stored
+//memory is proportional to the number of set bits (the band) instead of the graph,
+//empty pages are recycled as soon as their last bit is unset and clear() is O(1)
+class EpochBitvector
+{
+	static constexpr size_t PageBits = 1024;
+	static constexpr size_t WordsInPage = PageBits / 64;
+	struct DirectoryEntry
+	{
+		uint32_t epoch;
+		uint32_t page;
+	};
+public:
+	class reference
+	{
+	public:
+		reference(EpochBitvector& vec, size_t index) : vec(vec), index(index) {}
+		operator bool() const { return vec.get(index); }
+		reference& operator=(bool value) { vec.set(index, value); return *this; }
+	private:
+		EpochBitvector& vec;
+		size_t index;
+	};
+	EpochBitvector() :
+	directory(),
+	pages(),
+	pageCounts(),
+	freePages(),
+	usedPages(0),
+	numSet(0),
+	numBits(0),
+	epoch(1)
+	{
+	}
+	EpochBitvector(size_t size) :
+	EpochBitvector()
+	{
+		resize(size);
+	}
+	void resize(size_t size)
+	{
+		numBits = size;
+		directory.resize((size + PageBits - 1) / PageBits, DirectoryEntry { 0, 0 });
+	}
+	size_t size() const
+	{
+		return numBits;
+	}
+	bool none() const
+	{
+		return numSet == 0;
+	}
+#ifdef NDEBUG
+	__attribute__((always_inline))
+#endif
+	bool get(size_t index) const
+	{
+		assert(index < numBits);
+		const DirectoryEntry& entry = directory[index / PageBits];
+		if (entry.epoch != epoch) return false;
+		return (pages[entry.page * WordsInPage + (index % PageBits) / 64] >> (index % 64)) & 1;
+	}
+#ifdef NDEBUG
+	__attribute__((always_inline))
+#endif
+	void set(size_t index, bool value)
+	{
+		assert(index < numBits);
+		DirectoryEntry& entry = directory[index / PageBits];
+		if (entry.epoch != epoch)
+		{
+			if (!value) return;
+			entry.epoch = epoch;
+			entry.page = allocatePage();
+		}
+		uint64_t& word = pages[entry.page * WordsInPage + (index % PageBits) / 64];
+		uint64_t mask = (uint64_t)1 << (index % 64);
+		if (((word & mask) != 0) == value) return;
+		word ^= mask;
+		if (value)
+		{
+			pageCounts[entry.page]++;
+			numSet++;
+			return;
+		}
+		assert(pageCounts[entry.page] > 0);
+		pageCounts[entry.page]--;
+		numSet--;
+		if (pageCounts[entry.page] == 0)
+		{
+			freePages.push_back(entry.page);
+			entry.epoch = 0;
+		}
+	}
+	bool operator[](size_t index) const
+	{
+		return get(index);
+	}
+	reference operator[](size_t index)
+	{
+		return reference { *this, index };
+	}
+	void clear()
+	{
+		epoch++;
+		if (epoch == 0)
+		{
+			for (auto& entry : directory) entry.epoch = 0;
+			epoch = 1;
+		}
+		freePages.clear();
+		usedPages = 0;
+		numSet = 0;
+	}
+private:
+	friend class EpochBitvectorTest;
+	uint32_t allocatePage()
+	{
+		if (freePages.size() > 0)
+		{
+			uint32_t result = freePages.back();
+			freePages.pop_back();
+			return result;
+		}
+		if (usedPages == pageCounts.size())
+		{
+			assert(pageCounts.size() < std::numeric_limits<uint32_t>::max());
+			pages.resize(pages.size() + WordsInPage, 0);
+			pageCounts.push_back(0);
+		}
+		else
+		{
+			//stale page from before the last clear()
+			std::fill(pages.begin() + usedPages * WordsInPage, pages.begin() + (usedPages + 1) * WordsInPage, 0);
+			pageCounts[usedPages] = 0;
+		}
+		return usedPages++;
+	}
+	std::vector<DirectoryEntry> directory;
+	std::vector<uint64_t> pages;
+	std::vector<uint32_t> pageCounts;
+	std::vector<uint32_t> freePages;
+	uint32_t usedPages;
+	size_t numSet;
+	size_t numBits;
+	uint32_t epoch;
+};
+
+#endif
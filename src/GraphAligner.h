@@ -6,6 +6,7 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <functional>
 #include "AlignmentGraph.h"
 #include "CommonUtils.h"
 #include "GraphAlignerWrapper.h"
@@ -14,6 +15,9 @@
 #include "GraphAlignerVGAlignment.h"
 #include "GraphAlignerGAFAlignment.h"
 #include "GraphAlignerBitvectorBanded.h"
+#include "GraphAlignerWavefront.h"
+#include "GraphAlignerBatch.h"
+#include "AlignmentSelection.h"
 
 template <typename LengthType, typename ScoreType, typename Word>
 class GraphAligner
@@ -22,6 +26,8 @@ private:
 	using VGAlignment = GraphAlignerVGAlignment<LengthType, ScoreType, Word>;
 	using GAFAlignment = GraphAlignerGAFAlignment<LengthType, ScoreType, Word>;
 	using BitvectorAligner = GraphAlignerBitvectorBanded<LengthType, ScoreType, Word>;
+	using WavefrontAligner = GraphAlignerWavefront<LengthType, ScoreType, Word>;
+	using BatchAligner = GraphAlignerBatch<LengthType, ScoreType, Word>;
 	using Common = GraphAlignerCommon<LengthType, ScoreType, Word>;
 	using Params = typename Common::Params;
 	using MatrixPosition = typename Common::MatrixPosition;
@@ -29,14 +35,37 @@ private:
 	using OnewayTrace = typename Common::OnewayTrace;
 	using AlignerGraphsizedState = typename Common::AlignerGraphsizedState;
 	using TraceItem = typename Common::TraceItem;
+	using OnewayEnd = typename Common::OnewayEnd;
+	using CompactTrace = typename Common::CompactTrace;
+	using TraceChunk = typename Common::TraceChunk;
+	using TraceEdit = typename Common::TraceEdit;
+	//direct walk: exact matches checked this far ahead when picking a branch or an edit
+	static constexpr size_t DirectWalkLookahead = 32;
+	//direct walk: an edit must be followed by at least this many exact matches, otherwise fall back to DP
+	static constexpr size_t DirectWalkMinExactRun = 16;
+	static constexpr double DirectWalkMaxEditFraction = 0.01;
+	//seed prefilter: greedy extension in both directions with sloppy optimizations, seeds whose extensions drop by SeedPrefilterXdrop within SeedPrefilterWindow bp are not extended with DP
+	static constexpr size_t SeedPrefilterWindow = 200;
+	static constexpr int SeedPrefilterXdrop = 30;
+	static constexpr int SeedPrefilterEditCost = 3;
+	//score bound: alignments may extend this far outside of their seed cluster
+	static constexpr size_t SeedClusterSpanSlack = 500;
+	//score-only seed skipping: seeds this far plus the alignment's edits from the chain diagonal of an alignment end are on that alignment, same as the seed clustering distance
+	static constexpr int64_t ScoreOnlyDiagonalSlack = 100;
+	//batched reads are aligned normally if their batch alignment isn't end to end with at most this fraction of edits
+	static constexpr double BatchMaxEditFraction = 0.1;
 	const Params& params;
 	BitvectorAligner bvAligner;
+	WavefrontAligner wfAligner;
+	BatchAligner batchAligner;
 	mutable BufferedWriter logger;
 public:
 
 	GraphAligner(const Params& params) :
 	params(params),
 	bvAligner(params),
+	wfAligner(params),
+	batchAligner(params),
 	logger()
 	{
 		if (!params.quietMode) logger = { std::cerr };
@@ -56,6 +85,7 @@ public:
 			if (result.alignments.size() > 0) lastEnd = result.alignments.back().alignmentEnd;
 			while (start < sequence.size())
 			{
+				if (reusableState.budget.exhausted()) break;
 				start = lastEnd + DPRestartStride;
 				if (start >= sequence.size()-1) break;
 				auto aln = fullstartOneWay(seq_id, reusableState, sequence, bwSequence, start);
@@ -71,6 +101,7 @@ public:
 				}
 			}
 		}
+		markBudgetExhausted(result, reusableState);
 		return result;
 	}
 
@@ -87,94 +118,108 @@ public:
 		{
 			assert(!item.alignmentFailed());
 		}
+		markBudgetExhausted(result, reusableState);
 		assertSetNoRead(seq_id);
 		return result;
 	}
 
-	AlignmentResult AlignOneWay(const std::string& seq_id, const std::string& sequence, const std::vector<SeedHit>& seedHits, AlignerGraphsizedState& reusableState) const
+	AlignmentResult AlignOneWay(const std::string& seq_id, const std::string& sequence, const std::vector<SeedHit>& inputSeedHits, AlignerGraphsizedState& reusableState) const
 	{
 		assert(params.graph.finalized);
 		AlignmentResult result;
 		result.readName = seq_id;
-		assert(seedHits.size() > 0);
-		size_t seedScoreForEndToEndAln = 0;
-		size_t extendSeeds = params.seedExtendDensity * sequence.size() + 1;
-		if (params.seedExtendDensity == -1) extendSeeds = seedHits.size();
-		size_t worstExtendedSeedScore = 0;
+		assert(inputSeedHits.size() > 0);
 		std::string revSequence = CommonUtils::ReverseComplement(sequence);
-		for (size_t i = 0; i < seedHits.size(); i++)
+		SeedLoopState loop;
+		std::vector<SeedHit> seedHits = inputSeedHits;
+		loop.collapses.assign(seedHits.size(), false);
+		loop.prefilteredEnd = 0;
+		loop.seedScoreForEndToEndAln = 0;
+		loop.extendSeeds = params.seedExtendDensity * sequence.size() + 1;
+		if (params.seedExtendDensity == -1) loop.extendSeeds = seedHits.size();
+		loop.worstExtendedSeedScore = 0;
+		size_t i = 0;
+		bool stop = false;
+		while (i < seedHits.size() && !stop)
 		{
-			if (params.sloppyOptimizations && (seedHits[i].seedGoodness == seedScoreForEndToEndAln || seedHits[i].seedGoodness < seedScoreForEndToEndAln))
-			{
-				logger << "Read " << seq_id << " aligned end-to-end, skip rest of the seeds" << BufferedWriter::Flush;
-				break;
-			}
-			if (result.seedsExtended >= extendSeeds && (seedHits[i].seedGoodness < worstExtendedSeedScore))
-			{
-				logger << "Read " << seq_id << " enough seeds extended, skip rest" << BufferedWriter::Flush;
-				break;
-			}
-			assertSetRead(seq_id, seedHits[i].nodeID, seedHits[i].reverse, seedHits[i].seqPos, seedHits[i].matchLen, seedHits[i].nodeOffset);
-			if (!logger.inputDiscarded()) logger << seq_id << " seed " << i << "/" << seedHits.size() << " " << ThreadReadAssertion::assertGetSeedInfo();
-			if (seedHits[i].seedClusterSize < params.minSeedClusterSize)
+			//idle workers speculatively extend the next seeds which currently pass the filters
+			//the seeds are then accepted in order exactly as if they had been extended one by one
+			size_t waveSize = 1;
+			if (reusableState.taskPool != nullptr) waveSize += reusableState.taskPool->idleWorkers();
+			std::vector<size_t> wave;
+			size_t waveEnd = i;
+			bool waveStopped = false;
+			while (waveEnd < seedHits.size() && wave.size() < waveSize)
 			{
-				logger << " skipped (cluster size)";
-				logger << BufferedWriter::Flush;
-				continue;
+				auto decision = checkSeed(seq_id, sequence, revSequence, seedHits, waveEnd, result, loop, reusableState, false);
+				if (decision == SeedDecision::Stop)
+				{
+					waveStopped = true;
+					break;
+				}
+				if (decision == SeedDecision::Extend) wave.push_back(waveEnd);
+				waveEnd++;
 			}
-			if (params.sloppyOptimizations)
+			std::vector<AlignmentResult::AlignmentItem> items;
+			items.resize(wave.size());
+			std::vector<std::function<void(AlignerGraphsizedState&)>> tasks;
+			for (size_t j = 0; j < wave.size(); j++)
 			{
-				bool found = false;
-				for (const auto& aln : result.alignments)
+				tasks.emplace_back([this, &seq_id, &sequence, &revSequence, &seedHits, &wave, &items, j](AlignerGraphsizedState& state)
 				{
-					if (aln.alignmentStart <= seedHits[i].seqPos && aln.alignmentEnd >= seedHits[i].seqPos && aln.seedGoodness > seedHits[i].seedGoodness)
-					{
-						logger << " skipped (overlap)";
-						logger << BufferedWriter::Flush;
-						found = true;
-						break;
-					}
-				}
-				if (found) continue;
+					const SeedHit& seedHit = seedHits[wave[j]];
+					assertSetRead(seq_id, seedHit.nodeID, seedHit.reverse, seedHit.seqPos, seedHit.matchLen, seedHit.nodeOffset);
+					items[j] = getAlignmentFromSeed(seq_id, sequence, revSequence, seedHit, state);
+				});
 			}
-			bool found = false;
-			for (const auto& aln : result.alignments)
+			reusableState.runTasks(tasks);
+			size_t waveItem = 0;
+			size_t mergeEnd = waveEnd + (waveStopped ? 1 : 0);
+			for (; i < mergeEnd; i++)
 			{
-				if (exactAlignmentPart(aln, seedHits[i]))
+				auto decision = checkSeed(seq_id, sequence, revSequence, seedHits, i, result, loop, reusableState, true);
+				if (decision == SeedDecision::Stop)
 				{
-					logger << " skipped (existing alignment)";
-					logger << BufferedWriter::Flush;
-					found = true;
+					stop = true;
 					break;
 				}
-			}
-			if (found) continue;
-			logger << BufferedWriter::Flush;
-			worstExtendedSeedScore = seedHits[i].seedGoodness;
-			result.seedsExtended += 1;
-			auto item = getAlignmentFromSeed(seq_id, sequence, revSequence, seedHits[i], reusableState);
-			if (item.alignmentFailed()) continue;
-			item.seedGoodness = seedHits[i].seedGoodness;
-			result.alignments.emplace_back(std::move(item));
-			if (params.sloppyOptimizations)
-			{
-				std::sort(result.alignments.begin(), result.alignments.end(), [](const AlignmentResult::AlignmentItem& left, const AlignmentResult::AlignmentItem& right) { return left.alignmentStart < right.alignmentStart; });
-				if (result.alignments[0].alignmentStart == 0)
+				if (decision == SeedDecision::Skip) continue;
+				loop.worstExtendedSeedScore = seedHits[i].seedGoodness;
+				result.seedsExtended += 1;
+				while (waveItem < wave.size() && wave[waveItem] < i) waveItem++;
+				AlignmentResult::AlignmentItem item;
+				if (waveItem < wave.size() && wave[waveItem] == i)
+				{
+					item = std::move(items[waveItem]);
+				}
+				else
 				{
-					size_t minSeedGoodness = result.alignments[0].seedGoodness;
-					size_t contiguousEnd = result.alignments[0].alignmentEnd;
-					for (size_t i = 1; i < result.alignments.size(); i++)
+					item = getAlignmentFromSeed(seq_id, sequence, revSequence, seedHits[i], reusableState);
+				}
+				if (item.alignmentFailed()) continue;
+				item.seedGoodness = seedHits[i].seedGoodness;
+				result.alignments.emplace_back(std::move(item));
+				if (params.sloppyOptimizations)
+				{
+					std::sort(result.alignments.begin(), result.alignments.end(), [](const AlignmentResult::AlignmentItem& left, const AlignmentResult::AlignmentItem& right) { return left.alignmentStart < right.alignmentStart; });
+					if (result.alignments[0].alignmentStart == 0)
 					{
-						if (result.alignments[i].alignmentStart <= contiguousEnd)
+						size_t minSeedGoodness = result.alignments[0].seedGoodness;
+						size_t contiguousEnd = result.alignments[0].alignmentEnd;
+						for (size_t k = 1; k < result.alignments.size(); k++)
 						{
-							minSeedGoodness = std::min(minSeedGoodness, result.alignments[i].seedGoodness);
-							contiguousEnd = std::max(contiguousEnd, result.alignments[i].alignmentEnd);
+							if (result.alignments[k].alignmentStart <= contiguousEnd)
+							{
+								minSeedGoodness = std::min(minSeedGoodness, result.alignments[k].seedGoodness);
+								contiguousEnd = std::max(contiguousEnd, result.alignments[k].alignmentEnd);
+							}
 						}
+						if (contiguousEnd == sequence.size()) loop.seedScoreForEndToEndAln = minSeedGoodness;
 					}
-					if (contiguousEnd == sequence.size()) seedScoreForEndToEndAln = minSeedGoodness;
 				}
 			}
 		}
+		markBudgetExhausted(result, reusableState);
 		assertSetNoRead(seq_id);
 
 		return result;
@@ -182,30 +227,40 @@ public:
 
 	void AddAlignment(const std::string& seq_id, const std::string& sequence, AlignmentResult::AlignmentItem& alignment) const
 	{
-		assert(alignment.trace->trace.size() > 0);
-		auto vgAln = VGAlignment::traceToAlignment(seq_id, sequence, alignment.trace->score, alignment.trace->trace, 0, false);
+		assert(alignment.trace->cells > 0);
+		auto vgAln = VGAlignment::traceToAlignment(seq_id, sequence, alignment.trace->score, *alignment.trace, 0, false);
 		alignment.alignment = vgAln;
 		alignment.alignment->set_sequence(sequence.substr(alignment.alignmentStart, alignment.alignmentEnd - alignment.alignmentStart));
 		alignment.alignment->set_query_position(alignment.alignmentStart);
+		if (alignment.budgetExhausted) (*alignment.alignment->mutable_annotation()->mutable_fields())["budget_exhausted"].set_bool_value(true);
 	}
 
 	void AddGAFLine(const std::string& seq_id, const std::string& sequence, AlignmentResult::AlignmentItem& alignment, bool cigarMatchMismatchMerge) const
 	{
-		assert(alignment.trace->trace.size() > 0);
+		assert(alignment.trace->cells > 0);
 		alignment.GAFline = GAFAlignment::traceToAlignment(seq_id, sequence, *alignment.trace, alignment.alignmentXScore, alignment.mappingQuality, params, cigarMatchMismatchMerge);
+		if (alignment.budgetExhausted) alignment.GAFline += "\tbe:i:1";
 	}
 
 	void AddCorrected(AlignmentResult::AlignmentItem& alignment) const
 	{
 		assert(alignment.trace != nullptr);
-		assert(alignment.trace->trace.size() > 0);
-		alignment.corrected.reserve(alignment.trace->trace.back().DPposition.seqPos - alignment.trace->trace[0].DPposition.seqPos);
-		alignment.corrected = alignment.trace->trace[0].graphCharacter;
-		for (size_t i = 1; i < alignment.trace->trace.size(); i++)
+		assert(alignment.trace->cells > 0);
+		const CompactTrace& trace = *alignment.trace;
+		alignment.corrected.clear();
+		alignment.corrected.reserve(trace.readEnd - trace.readStart);
+		trace.forEachChunk([this, &trace, &alignment](const TraceChunk& chunk)
 		{
-			if (!alignment.trace->trace[i-1].nodeSwitch && alignment.trace->trace[i].DPposition.nodeOffset == alignment.trace->trace[i-1].DPposition.nodeOffset && alignment.trace->trace[i].DPposition.node == alignment.trace->trace[i-1].DPposition.node) continue;
-			alignment.corrected += alignment.trace->trace[i].graphCharacter;
-		}
+			if (chunk.edit == TraceEdit::Insertion) return true;
+			int nodeId = trace.path[chunk.pathIndex].nodeId;
+			size_t unitigNode = params.graph.GetUnitigNode(nodeId, chunk.nodeOffset);
+			for (size_t offset = chunk.nodeOffset; offset < chunk.nodeOffset + chunk.length; offset++)
+			{
+				if (offset >= params.graph.nodeOffset[unitigNode] + params.graph.NodeLength(unitigNode)) unitigNode = params.graph.GetUnitigNode(nodeId, offset);
+				alignment.corrected += params.graph.NodeSequences(unitigNode, offset - params.graph.nodeOffset[unitigNode]);
+			}
+			return true;
+		});
 	}
 
 	std::vector<SeedHit> prepareSeedsForMultiseeding(const std::vector<SeedHit>& seedHits, const size_t seqLen) const
@@ -289,6 +344,7 @@ public:
 				std::sort(pair.second.begin()+clusterStart, pair.second.begin()+i, [&seedHits](std::pair<size_t, size_t> left, std::pair<size_t, size_t> right) { return seedHits[left.first].seqPos < seedHits[right.first].seqPos; });
 				size_t matchingBps = 0;
 				int lastEnd = std::numeric_limits<int>::min();
+				int firstStart = std::numeric_limits<int>::max();
 				for (size_t j = clusterStart; j < i; j++)
 				{
 					int thisStart = (int)seedHits[pair.second[j].first].seqPos - (int)seedHits[pair.second[j].first].matchLen + 1;
@@ -298,11 +354,14 @@ public:
 					matchingBps += (thisEnd - std::max(thisStart, lastEnd));
 					// matchingBps += seedHits[pair.second[j].first].rawSeedGoodness;
 					lastEnd = thisEnd;
+					firstStart = std::min(firstStart, thisStart);
 				}
 				for (size_t j = clusterStart; j < i; j++)
 				{
 					seedHits[pair.second[j].first].seedGoodness = matchingBps + seedHits[pair.second[j].first].rawSeedGoodness;
 					seedHits[pair.second[j].first].seedClusterSize = i - clusterStart;
+					seedHits[pair.second[j].first].seedClusterStart = std::max(firstStart, 0);
+					seedHits[pair.second[j].first].seedClusterEnd = lastEnd;
 				}
 				clusterStart = i;
 			}
@@ -311,8 +370,210 @@ public:
 		std::reverse(seedHits.begin(), seedHits.end());
 	}
 
+	//aligns short reads together, one read per bitvector lane, from their first seeds
+	//reads without an end to end alignment close to the seed have no alignments in the result and should be aligned normally
+	std::vector<AlignmentResult> AlignShortReadBatch(const std::vector<std::string>& seq_ids, const std::vector<std::string>& sequences, const std::vector<SeedHit>& seedHits, AlignerGraphsizedState& reusableState) const
+	{
+		assert(params.graph.finalized);
+		assert(seq_ids.size() == sequences.size());
+		assert(seedHits.size() == sequences.size());
+		auto timeStart = std::chrono::system_clock::now();
+		std::vector<typename BatchAligner::BatchRead> reads;
+		for (size_t i = 0; i < sequences.size(); i++)
+		{
+			int forwardNodeId = seedHits[i].nodeID * 2 + (seedHits[i].reverse ? 1 : 0);
+			reads.push_back(typename BatchAligner::BatchRead { std::string_view { sequences[i].data(), sequences[i].size() }, forwardNodeId, seedHits[i].nodeOffset, seedHits[i].seqPos });
+		}
+		auto traces = batchAligner.getTraces(reads);
+		auto timeEnd = std::chrono::system_clock::now();
+		size_t time = std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - timeStart).count();
+		std::vector<AlignmentResult> result;
+		result.resize(sequences.size());
+		for (size_t i = 0; i < sequences.size(); i++)
+		{
+			result[i].readName = seq_ids[i];
+			if (traces[i].failed()) continue;
+#ifndef NDEBUG
+			verifyTrace(traces[i].trace, sequences[i], traces[i].score);
+#endif
+			std::string revSequence = CommonUtils::ReverseComplement(sequences[i]);
+			auto mergedTrace = clipAndAddBackwardTrace(seq_ids[i], std::move(traces[i]), reusableState, sequences[i], revSequence, 0);
+			if (mergedTrace.failed() || mergedTrace.trace.size() == 0) continue;
+			AlignmentResult::AlignmentItem item { compactTrace(mergedTrace), 0, std::numeric_limits<size_t>::max() };
+			assert(item.trace->cells > 0);
+			item.alignmentScore = item.trace->score;
+			item.alignmentStart = item.trace->readStart;
+			item.alignmentEnd = item.trace->readEnd;
+			if (item.alignmentStart != 0 || item.alignmentEnd != sequences[i].size()) continue;
+			if (item.alignmentScore > BatchMaxEditFraction * sequences[i].size()) continue;
+			item.elapsedMilliseconds = time / sequences.size();
+			item.alignmentXScore = (ScoreType)item.alignmentLength()*100 - params.XscoreErrorCost * (ScoreType)item.alignmentScore;
+			item.alignmentXScore /= 100.0;
+			item.seedGoodness = seedHits[i].seedGoodness;
+			result[i].seedsExtended = 1;
+			result[i].alignments.emplace_back(std::move(item));
+		}
+		return result;
+	}
+
+	//joins the alignments of overlapping read windows, windowResults are in window coordinates
+	//an alignment is continued by an alignment of the next window if they pass through the same cell in the overlap
+	AlignmentResult StitchWindows(const std::string& seq_id, const std::string& sequence, const std::vector<size_t>& windowStarts, std::vector<AlignmentResult>& windowResults) const
+	{
+		assert(windowStarts.size() == windowResults.size());
+		AlignmentResult result;
+		result.readName = seq_id;
+		std::vector<AlignmentResult::AlignmentItem> open;
+		for (size_t window = 0; window < windowResults.size(); window++)
+		{
+			assert(window == 0 || windowStarts[window] > windowStarts[window-1]);
+			result.seedsExtended += windowResults[window].seedsExtended;
+			if (windowResults[window].budgetExhausted) result.budgetExhausted = true;
+			std::vector<AlignmentResult::AlignmentItem> current;
+			for (auto& aln : windowResults[window].alignments)
+			{
+				if (aln.alignmentFailed()) continue;
+				shiftWindowAlignment(aln, windowStarts[window]);
+				current.push_back(std::move(aln));
+			}
+			std::sort(current.begin(), current.end(), [](const AlignmentResult::AlignmentItem& left, const AlignmentResult::AlignmentItem& right) { return left.alignmentStart < right.alignmentStart; });
+			std::vector<bool> continued;
+			continued.resize(open.size(), false);
+			std::vector<AlignmentResult::AlignmentItem> nextOpen;
+			for (auto& aln : current)
+			{
+				bool stitched = false;
+				for (size_t i = 0; i < open.size(); i++)
+				{
+					if (continued[i]) continue;
+					if (!tryStitchWindowAlignments(open[i], aln)) continue;
+					continued[i] = true;
+					nextOpen.push_back(std::move(open[i]));
+					stitched = true;
+					break;
+				}
+				if (!stitched) nextOpen.push_back(std::move(aln));
+			}
+			for (size_t i = 0; i < open.size(); i++)
+			{
+				if (!continued[i]) result.alignments.push_back(std::move(open[i]));
+			}
+			open = std::move(nextOpen);
+		}
+		for (auto& aln : open)
+		{
+			result.alignments.push_back(std::move(aln));
+		}
+		if (result.budgetExhausted)
+		{
+			for (auto& aln : result.alignments)
+			{
+				aln.budgetExhausted = true;
+			}
+		}
+		return result;
+	}
+
 private:
 
+	void shiftWindowAlignment(AlignmentResult::AlignmentItem& aln, size_t windowStart) const
+	{
+		assert(aln.trace != nullptr);
+		aln.trace->readStart += windowStart;
+		aln.trace->readEnd += windowStart;
+		aln.alignmentStart += windowStart;
+		aln.alignmentEnd += windowStart;
+	}
+
+	//positions and cell indices of the cells whose seqPos is in [start, end)
+	static std::vector<std::pair<MatrixPosition, size_t>> traceCellsInRange(const CompactTrace& trace, size_t start, size_t end)
+	{
+		std::vector<std::pair<MatrixPosition, size_t>> result;
+		trace.forEachChunkFrom(start, [&trace, &result, start, end](const TraceChunk& chunk)
+		{
+			if (chunk.seqPos >= end) return false;
+			size_t lastSeqPos = chunk.seqPos + (chunk.edit == TraceEdit::Deletion ? 0 : chunk.length - 1);
+			if (lastSeqPos < start) return true;
+			for (size_t i = 0; i < chunk.length; i++)
+			{
+				size_t seqPos = chunk.seqPos + (chunk.edit == TraceEdit::Deletion ? 0 : i);
+				if (seqPos < start || seqPos >= end) continue;
+				size_t nodeOffset = chunk.nodeOffset + (chunk.edit == TraceEdit::Insertion ? 0 : i);
+				result.emplace_back(MatrixPosition { (size_t)trace.path[chunk.pathIndex].nodeId, nodeOffset, seqPos }, chunk.firstCell + i);
+			}
+			return true;
+		});
+		return result;
+	}
+
+	//continues left with right if they share a cell in the overlap, joining at the shared cell closest to the middle of the overlap
+	bool tryStitchWindowAlignments(AlignmentResult::AlignmentItem& left, const AlignmentResult::AlignmentItem& right) const
+	{
+		if (right.alignmentStart <= left.alignmentStart) return false;
+		if (right.alignmentStart >= left.alignmentEnd) return false;
+		if (right.alignmentEnd <= left.alignmentEnd) return false;
+		const CompactTrace& leftTrace = *left.trace;
+		const CompactTrace& rightTrace = *right.trace;
+		size_t middle = (right.alignmentStart + left.alignmentEnd) / 2;
+		auto leftCells = traceCellsInRange(leftTrace, right.alignmentStart, left.alignmentEnd);
+		auto rightCells = traceCellsInRange(rightTrace, right.alignmentStart, left.alignmentEnd);
+		size_t bestLeft = leftTrace.cells;
+		size_t bestRight = rightTrace.cells;
+		size_t bestDistance = std::numeric_limits<size_t>::max();
+		size_t leftIndex = 0;
+		for (size_t rightIndex = 0; rightIndex < rightCells.size(); rightIndex++)
+		{
+			auto pos = rightCells[rightIndex].first;
+			while (leftIndex < leftCells.size() && leftCells[leftIndex].first.seqPos < pos.seqPos) leftIndex++;
+			for (size_t i = leftIndex; i < leftCells.size() && leftCells[i].first.seqPos == pos.seqPos; i++)
+			{
+				if (!(leftCells[i].first == pos)) continue;
+				size_t distance = pos.seqPos > middle ? pos.seqPos - middle : middle - pos.seqPos;
+				if (distance >= bestDistance) continue;
+				bestDistance = distance;
+				bestLeft = leftCells[i].second;
+				bestRight = rightCells[rightIndex].second;
+			}
+		}
+		if (bestLeft == leftTrace.cells) return false;
+		//left side up to and including the shared cell, then the right side after it
+		auto stitched = std::make_shared<CompactTrace>();
+		leftTrace.forEachChunk([&leftTrace, &stitched, bestLeft](const TraceChunk& chunk)
+		{
+			if (chunk.firstCell > bestLeft) return false;
+			size_t length = std::min(chunk.length, bestLeft - chunk.firstCell + 1);
+			stitched->append(chunk.edit, length, chunk.newNode, leftTrace.path[chunk.pathIndex].nodeId, chunk.nodeOffset, chunk.seqPos);
+			return true;
+		});
+		rightTrace.forEachChunk([&rightTrace, &stitched, bestRight](const TraceChunk& chunk)
+		{
+			if (chunk.firstCell + chunk.length <= bestRight + 1) return true;
+			size_t skip = chunk.firstCell > bestRight ? 0 : bestRight + 1 - chunk.firstCell;
+			size_t nodeOffset = chunk.nodeOffset + (chunk.edit == TraceEdit::Insertion ? 0 : skip);
+			size_t seqPos = chunk.seqPos + (chunk.edit == TraceEdit::Deletion ? 0 : skip);
+			stitched->append(chunk.edit, chunk.length - skip, chunk.newNode && skip == 0, rightTrace.path[chunk.pathIndex].nodeId, nodeOffset, seqPos);
+			return true;
+		});
+		ScoreType score = 0;
+		for (auto run : stitched->edits)
+		{
+			if (run.edit != TraceEdit::Match) score += run.length;
+		}
+		stitched->score = score;
+		assert(stitched->readEnd == right.alignmentEnd);
+		left.trace = stitched;
+		left.alignmentEnd = right.alignmentEnd;
+		left.alignmentScore = score;
+		left.alignmentXScore = (ScoreType)left.alignmentLength()*100 - params.XscoreErrorCost * (ScoreType)left.alignmentScore;
+		left.alignmentXScore /= 100.0;
+		left.seedGoodness = std::max(left.seedGoodness, right.seedGoodness);
+		left.cellsProcessed += right.cellsProcessed;
+		left.elapsedMilliseconds += right.elapsedMilliseconds;
+		left.mappingQuality = std::min(left.mappingQuality, right.mappingQuality);
+		left.budgetExhausted = left.budgetExhausted || right.budgetExhausted;
+		return true;
+	}
+
 	OnewayTrace mergeTraces(OnewayTrace&& bwTrace, OnewayTrace&& fwTrace) const
 	{
 		assert(!fwTrace.failed() || !bwTrace.failed());
@@ -388,11 +649,11 @@ private:
 		OnewayTrace mergedTrace = clipAndAddBackwardTrace(seq_id, std::move(fwTrace), reusableState, fwSequence, bwSequence, offset);
 		if (mergedTrace.trace.size() == 0) return AlignmentResult::AlignmentItem {};
 
-		AlignmentResult::AlignmentItem alnItem { std::move(mergedTrace), 0, std::numeric_limits<size_t>::max() };
+		AlignmentResult::AlignmentItem alnItem { compactTrace(mergedTrace), 0, std::numeric_limits<size_t>::max() };
 
 		alnItem.alignmentScore = alnItem.trace->score;
-		alnItem.alignmentStart = alnItem.trace->trace[0].DPposition.seqPos;
-		alnItem.alignmentEnd = alnItem.trace->trace.back().DPposition.seqPos + 1;
+		alnItem.alignmentStart = alnItem.trace->readStart;
+		alnItem.alignmentEnd = alnItem.trace->readEnd;
 		timeEnd = std::chrono::system_clock::now();
 		auto time = std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - timeStart).count();
 		alnItem.elapsedMilliseconds = time;
@@ -402,60 +663,62 @@ private:
 
 	bool exactAlignmentPart(const AlignmentResult::AlignmentItem& aln, const SeedHit& seedHit) const
 	{
-		assert(aln.trace != nullptr);
-		const std::vector<TraceItem>& trace = aln.trace->trace;
-		assert(trace.size() > 0);
-		assert(trace.back().DPposition.seqPos > trace[0].DPposition.seqPos);
-		if (trace.back().DPposition.seqPos < seedHit.seqPos) return false;
-		if (trace[0].DPposition.seqPos > seedHit.seqPos) return false;
-		size_t high = trace.size();
-		size_t low = 0;
-		size_t mid = (seedHit.seqPos - trace[0].DPposition.seqPos) / (trace.back().DPposition.seqPos - trace[0].DPposition.seqPos);
-		while (trace[mid].DPposition.seqPos != seedHit.seqPos)
-		{
-			if (trace[mid].DPposition.seqPos < seedHit.seqPos)
-			{
-				low = mid;
-				mid = (high + low) / 2;
-				if (mid == low) mid += 1;
-				assert(mid < trace.size());
-			}
-			if (trace[mid].DPposition.seqPos > seedHit.seqPos)
-			{
-				high = mid;
-				mid = (high + low) / 2;
-				assert(mid < trace.size());
-			}
-			assert(low < mid);
-			assert(mid < high);
-		}
-		assert(mid < trace.size());
-		assert(trace[mid].DPposition.seqPos == seedHit.seqPos);
-		size_t down = mid;
-		size_t compareNode = seedHit.nodeID * 2;
+		if (aln.trace == nullptr) return scoreOnlyAlignmentPart(aln, seedHit);
+		const CompactTrace& trace = *aln.trace;
+		assert(trace.cells > 0);
+		if (trace.readEnd <= seedHit.seqPos) return false;
+		if (trace.readStart > seedHit.seqPos) return false;
+		int compareNode = seedHit.nodeID * 2;
 		if (seedHit.reverse) compareNode += 1;
-		while (trace[down].DPposition.seqPos == seedHit.seqPos)
+		bool found = false;
+		trace.forEachChunkFrom(seedHit.seqPos, [&trace, &seedHit, compareNode, &found](const TraceChunk& chunk)
 		{
-			if (compareNode == trace[down].DPposition.node && seedHit.nodeOffset == trace[down].DPposition.nodeOffset)
+			if (chunk.seqPos > seedHit.seqPos) return false;
+			if (trace.path[chunk.pathIndex].nodeId != compareNode) return true;
+			switch(chunk.edit)
 			{
-				return true;
+				case TraceEdit::Insertion:
+					found = chunk.nodeOffset == seedHit.nodeOffset && chunk.seqPos <= seedHit.seqPos && chunk.seqPos + chunk.length > seedHit.seqPos;
+					break;
+				case TraceEdit::Deletion:
+					found = chunk.seqPos == seedHit.seqPos && chunk.nodeOffset <= seedHit.nodeOffset && chunk.nodeOffset + chunk.length > seedHit.nodeOffset;
+					break;
+				default:
+					found = chunk.seqPos <= seedHit.seqPos && chunk.seqPos + chunk.length > seedHit.seqPos && seedHit.nodeOffset - chunk.nodeOffset == seedHit.seqPos - chunk.seqPos;
+					break;
 			}
-			if (down == 0) break;
-			down -= 1;
-		}
-		size_t up = mid;
-		while (trace[up].DPposition.seqPos == seedHit.seqPos)
+			return !found;
+		});
+		return found;
+	}
+
+	//score-only alignments don't know their path, only the graph positions of their ends
+	//a seed inside the read span is part of the alignment if it is on the same graph chain and near the diagonal of the ends, so seeds on other repeat copies are still extended
+	bool scoreOnlyAlignmentPart(const AlignmentResult::AlignmentItem& aln, const SeedHit& seedHit) const
+	{
+		if (aln.alignmentStart > seedHit.seqPos || aln.alignmentEnd <= seedHit.seqPos) return false;
+		auto seed = chainDiagonal(seedHit.nodeID * 2 + (seedHit.reverse ? 1 : 0), seedHit.nodeOffset, seedHit.seqPos);
+		auto start = chainDiagonal(aln.alignmentStartPos.node, aln.alignmentStartPos.nodeOffset, aln.alignmentStartPos.seqPos);
+		auto end = chainDiagonal(aln.alignmentEndPos.node, aln.alignmentEndPos.nodeOffset, aln.alignmentEndPos.seqPos);
+		int64_t slack = (int64_t)aln.alignmentScore + ScoreOnlyDiagonalSlack;
+		if (seed.first == start.first && seed.first == end.first)
 		{
-			if (compareNode == trace[up].DPposition.node && seedHit.nodeOffset == trace[up].DPposition.nodeOffset)
-			{
-				return true;
-			}
-			up += 1;
-			if (up == trace.size()) break;
+			return seed.second >= std::min(start.second, end.second) - slack && seed.second <= std::max(start.second, end.second) + slack;
 		}
+		if (seed.first == start.first && std::abs(seed.second - start.second) <= slack) return true;
+		if (seed.first == end.first && std::abs(seed.second - end.second) <= slack) return true;
 		return false;
 	}
 
+	//chain and approximate diagonal of a cell, like in orderSeedsByChaining
+	std::pair<size_t, int64_t> chainDiagonal(int bigraphNodeId, size_t nodeOffset, size_t seqPos) const
+	{
+		size_t nodeIndex = params.graph.GetUnitigNode(bigraphNodeId, nodeOffset);
+		assert(nodeOffset >= params.graph.nodeOffset[nodeIndex]);
+		size_t realOffset = nodeOffset - params.graph.nodeOffset[nodeIndex];
+		return std::make_pair(params.graph.chainNumber[nodeIndex], (int64_t)(params.graph.chainApproxPos[nodeIndex] + realOffset) - (int64_t)seqPos);
+	}
+
 	OnewayTrace getBacktraceFullStart(const std::string& sequence, AlignerGraphsizedState& reusableState) const
 	{
 		std::string_view seq { sequence.data(), sequence.size() };
@@ -491,31 +754,422 @@ private:
 		Trace result;
 		result.backward.score = std::numeric_limits<ScoreType>::max();
 		result.forward.score = std::numeric_limits<ScoreType>::max();
+		//the halves are independent so idle workers can take one of them
+		std::vector<std::function<void(AlignerGraphsizedState&)>> halves;
 		if (seedHit.seqPos > 0)
 		{
-			std::string_view backwardPart { revSequence.data() + revSequence.size() - seedHit.seqPos, seedHit.seqPos };
-			auto reversePos = params.graph.GetReversePosition(forwardNodeId, seedHit.nodeOffset);
-			assert(reversePos.first == backwardNodeId);
-			result.backward = bvAligner.getReverseTraceFromSeed(backwardPart, backwardNodeId, reversePos.second, params.Xdropcutoff, reusableState);
+			halves.emplace_back([this, &result, &revSequence, &seedHit, forwardNodeId, backwardNodeId](AlignerGraphsizedState& state)
+			{
+				std::string_view backwardPart { revSequence.data() + revSequence.size() - seedHit.seqPos, seedHit.seqPos };
+				auto reversePos = params.graph.GetReversePosition(forwardNodeId, seedHit.nodeOffset);
+				assert(reversePos.first == backwardNodeId);
+				if (params.sloppyOptimizations) result.backward = getDirectWalkTrace(backwardPart, backwardNodeId, reversePos.second);
+				if (result.backward.failed() && params.wavefrontMaxDivergence > 0)
+				{
+					result.backward = wfAligner.getTraceFromSeed(backwardPart, backwardNodeId, reversePos.second, params.wavefrontMaxDivergence, state);
+				}
+				if (result.backward.failed())
+				{
+					result.backward = bvAligner.getReverseTraceFromSeed(backwardPart, backwardNodeId, reversePos.second, params.Xdropcutoff, state);
+					if (!result.backward.failed())
+					{
+						assert(result.backward.trace.back().DPposition.seqPos == (size_t)-1 && params.graph.nodeIDs[result.backward.trace.back().DPposition.node] == backwardNodeId && params.graph.nodeOffset[result.backward.trace.back().DPposition.node] + result.backward.trace.back().DPposition.nodeOffset == reversePos.second);
+						std::reverse(result.backward.trace.begin(), result.backward.trace.end());
+					}
+				}
+			});
 		}
 		if (seedHit.seqPos < sequence.size()-1)
 		{
-			std::string_view forwardPart { sequence.data() + seedHit.seqPos + 1, sequence.size() - seedHit.seqPos - 1 };
-			size_t offset = seedHit.nodeOffset;
-			result.forward = bvAligner.getReverseTraceFromSeed(forwardPart, forwardNodeId, offset, params.Xdropcutoff, reusableState);
+			halves.emplace_back([this, &result, &sequence, &seedHit, forwardNodeId](AlignerGraphsizedState& state)
+			{
+				std::string_view forwardPart { sequence.data() + seedHit.seqPos + 1, sequence.size() - seedHit.seqPos - 1 };
+				size_t offset = seedHit.nodeOffset;
+				if (params.sloppyOptimizations) result.forward = getDirectWalkTrace(forwardPart, forwardNodeId, offset);
+				if (result.forward.failed() && params.wavefrontMaxDivergence > 0)
+				{
+					result.forward = wfAligner.getTraceFromSeed(forwardPart, forwardNodeId, offset, params.wavefrontMaxDivergence, state);
+				}
+				if (result.forward.failed())
+				{
+					result.forward = bvAligner.getReverseTraceFromSeed(forwardPart, forwardNodeId, offset, params.Xdropcutoff, state);
+					if (!result.forward.failed())
+					{
+						assert(result.forward.trace.back().DPposition.seqPos == (size_t)-1 && params.graph.nodeIDs[result.forward.trace.back().DPposition.node] == forwardNodeId && params.graph.nodeOffset[result.forward.trace.back().DPposition.node] + result.forward.trace.back().DPposition.nodeOffset == seedHit.nodeOffset);
+						std::reverse(result.forward.trace.begin(), result.forward.trace.end());
+					}
+				}
+			});
+		}
+		reusableState.runTasks(halves);
+		return result;
+	}
+
+	//bound the alignment from a seed by its cluster's read span plus slack on both sides, with no errors
+	//false if that alignment would still be removed by the selection filters
+	bool seedCanPassSelection(size_t readLength, const SeedHit& seedHit, const std::vector<AlignmentResult::AlignmentItem>& alignments) const
+	{
+		if (seedHit.seedClusterEnd == std::numeric_limits<size_t>::max()) return true;
+		AlignmentResult::AlignmentItem cluster;
+		cluster.alignmentStart = seedHit.seedClusterStart;
+		cluster.alignmentEnd = seedHit.seedClusterEnd + 1;
+		size_t boundStart = 0;
+		if (seedHit.seedClusterStart > SeedClusterSpanSlack) boundStart = seedHit.seedClusterStart - SeedClusterSpanSlack;
+		size_t boundEnd = std::min(readLength, seedHit.seedClusterEnd + 1 + SeedClusterSpanSlack);
+		double boundXScore = boundEnd - boundStart;
+		if (boundXScore < params.minAlignmentScore) return false;
+		if (params.ECutoff != -1 && params.EValueCalc.getEValue(params.graph.SizeInBP(), readLength, boundEnd - boundStart, 0) > params.ECutoff) return false;
+		for (const auto& aln : alignments)
+		{
+			if (boundXScore >= aln.alignmentXScore * params.multimapScoreFraction) continue;
+			if (AlignmentSelection::alignmentIncompatible(cluster, aln)) return false;
+		}
+		return true;
+	}
+
+	//with sloppy optimizations, greedy-extends the next run of seeds with the same seed goodness once the seed loop reaches it
+	//marks the seeds whose extensions collapse in both directions, and reorders the run by extension score so the locally best matching seeds are extended first
+	//only within the run, the seed loop heuristics depend on the goodness order
+	//returns the end of the run
+	size_t prefilterSeedRun(const std::string& sequence, const std::string& revSequence, std::vector<SeedHit>& seedHits, std::vector<bool>& collapses, size_t runStart) const
+	{
+		assert(runStart < seedHits.size());
+		size_t runEnd = runStart + 1;
+		while (runEnd < seedHits.size() && seedHits[runEnd].seedGoodness == seedHits[runStart].seedGoodness) runEnd++;
+		std::vector<int> scores;
+		std::vector<bool> collapsed;
+		std::vector<size_t> order;
+		for (size_t i = runStart; i < runEnd; i++)
+		{
+			bool seedCollapsed;
+			scores.push_back(seedExtensionScore(sequence, revSequence, seedHits[i], seedCollapsed));
+			collapsed.push_back(seedCollapsed);
+			order.push_back(order.size());
+		}
+		std::stable_sort(order.begin(), order.end(), [&scores](size_t left, size_t right) { return scores[left] > scores[right]; });
+		std::vector<SeedHit> run { seedHits.begin() + runStart, seedHits.begin() + runEnd };
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			seedHits[runStart + i] = run[order[i]];
+			collapses[runStart + i] = collapsed[order[i]];
+		}
+		return runEnd;
+	}
+
+	//local match quality of a seed, the sum of the best scores of its greedy extensions in both directions
+	//collapsed is set if both extensions drop off
+	int seedExtensionScore(const std::string& sequence, const std::string& revSequence, const SeedHit& seedHit, bool& collapsed) const
+	{
+		int forwardNodeId = seedHit.nodeID * 2;
+		if (seedHit.reverse) forwardNodeId += 1;
+		std::string_view forwardPart { sequence.data() + seedHit.seqPos + 1, sequence.size() - seedHit.seqPos - 1 };
+		bool forwardCollapsed;
+		int score = greedyExtensionScore(forwardPart, forwardNodeId, seedHit.nodeOffset, forwardCollapsed);
+		collapsed = forwardCollapsed;
+		if (seedHit.seqPos == 0) return score;
+		std::string_view backwardPart { revSequence.data() + revSequence.size() - seedHit.seqPos, seedHit.seqPos };
+		auto reversePos = params.graph.GetReversePosition(forwardNodeId, seedHit.nodeOffset);
+		bool backwardCollapsed;
+		score += greedyExtensionScore(backwardPart, reversePos.first, reversePos.second, backwardCollapsed);
+		collapsed = forwardCollapsed && backwardCollapsed;
+		return score;
+	}
+
+	//cheap X-drop extension along the graph, single base edits are picked by the exact match following them
+	//returns the best score reached, collapsed is set if the extension drops before SeedPrefilterWindow bp or the end of the sequence
+	int greedyExtensionScore(const std::string_view& sequence, int bigraphNodeId, size_t nodeOffset, bool& collapsed) const
+	{
+		collapsed = false;
+		LengthType node = params.graph.GetUnitigNode(bigraphNodeId, nodeOffset);
+		LengthType offset = nodeOffset - params.graph.nodeOffset[node];
+		size_t maxLength = std::min(SeedPrefilterWindow, sequence.size());
+		size_t seqPos = 0;
+		int score = 0;
+		int maxScore = 0;
+		std::vector<LengthType> nextNodes;
+		while (seqPos < maxLength)
+		{
+			if (score < maxScore - SeedPrefilterXdrop)
+			{
+				collapsed = true;
+				return maxScore;
+			}
+			LengthType nextOffset = getNextCells(node, offset, nextNodes);
+			//tip, let the DP decide
+			if (nextNodes.size() == 0) return maxScore;
+			LengthType bestNode = std::numeric_limits<LengthType>::max();
+			size_t bestLength = 0;
+			for (auto next : nextNodes)
+			{
+				if (!Common::characterMatch(sequence[seqPos], params.graph.NodeSequences(next, nextOffset))) continue;
+				if (nextNodes.size() == 1)
+				{
+					bestNode = next;
+					break;
+				}
+				size_t length = directWalkExactLength(next, nextOffset, sequence, seqPos+1);
+				if (bestNode == std::numeric_limits<LengthType>::max() || length > bestLength)
+				{
+					bestNode = next;
+					bestLength = length;
+				}
+			}
+			if (bestNode != std::numeric_limits<LengthType>::max())
+			{
+				node = bestNode;
+				offset = nextOffset;
+				seqPos += 1;
+				score += 1;
+				maxScore = std::max(maxScore, score);
+				continue;
+			}
+			score -= SeedPrefilterEditCost;
+			bool insertion = true;
+			bool deletion = false;
+			bestLength = directWalkExactLength(node, offset, sequence, seqPos+1);
+			for (auto next : nextNodes)
+			{
+				size_t length = directWalkExactLength(next, nextOffset, sequence, seqPos+1);
+				if (length >= bestLength)
+				{
+					bestLength = length;
+					bestNode = next;
+					insertion = false;
+				}
+			}
+			for (auto next : nextNodes)
+			{
+				size_t length = directWalkExactLength(next, nextOffset, sequence, seqPos);
+				if (length > bestLength)
+				{
+					bestLength = length;
+					bestNode = next;
+					insertion = false;
+					deletion = true;
+				}
+			}
+			if (!insertion)
+			{
+				node = bestNode;
+				offset = nextOffset;
+			}
+			if (!deletion) seqPos += 1;
+		}
+		return maxScore;
+	}
+
+	//cells following (node, nodeOffset): the next offset in the same node, or offset 0 in each out-neighbor
+	LengthType getNextCells(LengthType node, LengthType nodeOffset, std::vector<LengthType>& nextNodes) const
+	{
+		nextNodes.clear();
+		if (nodeOffset + 1 < params.graph.NodeLength(node))
+		{
+			nextNodes.push_back(node);
+			return nodeOffset + 1;
 		}
+		nextNodes.insert(nextNodes.end(), params.graph.outNeighbors[node].begin(), params.graph.outNeighbors[node].end());
+		return 0;
+	}
 
-		if (!result.backward.failed())
+	//number of exact matches when walking forward from the cell (node, nodeOffset), taking the first matching out-neighbor at node ends
+	size_t directWalkExactLength(LengthType node, LengthType nodeOffset, const std::string_view& sequence, size_t seqPos) const
+	{
+		size_t maxLength = std::min(DirectWalkLookahead, sequence.size() - seqPos);
+		size_t result = 0;
+		while (result < maxLength)
 		{
-			auto reversePos = params.graph.GetReversePosition(forwardNodeId, seedHit.nodeOffset);
-			assert(result.backward.trace.back().DPposition.seqPos == (size_t)-1 && params.graph.nodeIDs[result.backward.trace.back().DPposition.node] == backwardNodeId && params.graph.nodeOffset[result.backward.trace.back().DPposition.node] + result.backward.trace.back().DPposition.nodeOffset == reversePos.second);
-			std::reverse(result.backward.trace.begin(), result.backward.trace.end());
+			char readChar = sequence[seqPos + result];
+			if (nodeOffset + 1 < params.graph.NodeLength(node))
+			{
+				nodeOffset += 1;
+				if (!Common::characterMatch(readChar, params.graph.NodeSequences(node, nodeOffset))) break;
+			}
+			else
+			{
+				bool found = false;
+				for (auto neighbor : params.graph.outNeighbors[node])
+				{
+					if (Common::characterMatch(readChar, params.graph.NodeSequences(neighbor, 0)))
+					{
+						node = neighbor;
+						nodeOffset = 0;
+						found = true;
+						break;
+					}
+				}
+				if (!found) break;
+			}
+			result += 1;
 		}
-		if (!result.forward.failed())
+		return result;
+	}
+
+	//greedy walk along the graph which allows sparse edits, used instead of DP when the read follows one path with high identity
+	//it can pick a different path than the DP between equally good alignments, so it's only used with sloppy optimizations
+	//returns the trace in the same form as the DP, starting from the seed cell at seqPos -1, or TraceFailed if the walk can't be verified
+	OnewayTrace getDirectWalkTrace(const std::string_view& sequence, int bigraphNodeId, size_t nodeOffset) const
+	{
+		LengthType node = params.graph.GetUnitigNode(bigraphNodeId, nodeOffset);
+		LengthType offset = nodeOffset - params.graph.nodeOffset[node];
+		size_t maxEdits = sequence.size() * DirectWalkMaxEditFraction;
+		size_t seqPos = 0;
+		ScoreType edits = 0;
+		ScoreType bestXScore = 0;
+		ScoreType bestXScoreEdits = 0;
+		size_t bestXScoreIndex = 0;
+		OnewayTrace result;
+		result.trace.emplace_back(MatrixPosition { node, offset, (size_t)-1 }, false, sequence, params.graph);
+		std::vector<LengthType> nextNodes;
+		while (seqPos < sequence.size())
 		{
-			assert(result.forward.trace.back().DPposition.seqPos == (size_t)-1 && params.graph.nodeIDs[result.forward.trace.back().DPposition.node] == forwardNodeId && params.graph.nodeOffset[result.forward.trace.back().DPposition.node] + result.forward.trace.back().DPposition.nodeOffset == seedHit.nodeOffset);
-			std::reverse(result.forward.trace.begin(), result.forward.trace.end());
+			LengthType nextOffset = getNextCells(node, offset, nextNodes);
+			if (nextNodes.size() == 0) return OnewayTrace::TraceFailed();
+			LengthType matchNode = std::numeric_limits<LengthType>::max();
+			if (nextNodes.size() == 1)
+			{
+				if (Common::characterMatch(sequence[seqPos], params.graph.NodeSequences(nextNodes[0], nextOffset))) matchNode = nextNodes[0];
+			}
+			else
+			{
+				size_t bestLength = 0;
+				bool ambiguous = false;
+				for (auto next : nextNodes)
+				{
+					if (!Common::characterMatch(sequence[seqPos], params.graph.NodeSequences(next, nextOffset))) continue;
+					size_t length = directWalkExactLength(next, nextOffset, sequence, seqPos+1);
+					if (matchNode == std::numeric_limits<LengthType>::max() || length > bestLength)
+					{
+						matchNode = next;
+						bestLength = length;
+						ambiguous = false;
+					}
+					else if (length == bestLength)
+					{
+						ambiguous = true;
+					}
+				}
+				if (matchNode != std::numeric_limits<LengthType>::max())
+				{
+					size_t maxLength = std::min(DirectWalkLookahead, sequence.size() - seqPos - 1);
+					if (ambiguous && bestLength < maxLength) return OnewayTrace::TraceFailed();
+					if (bestLength < std::min(DirectWalkMinExactRun, maxLength)) return OnewayTrace::TraceFailed();
+				}
+			}
+			if (matchNode != std::numeric_limits<LengthType>::max())
+			{
+				if (matchNode != node || nextOffset != offset + 1) result.trace.back().nodeSwitch = true;
+				node = matchNode;
+				offset = nextOffset;
+				result.trace.emplace_back(MatrixPosition { node, offset, seqPos }, false, sequence, params.graph);
+				seqPos += 1;
+			}
+			else
+			{
+				edits += 1;
+				if ((size_t)edits > maxEdits) return OnewayTrace::TraceFailed();
+				//candidate edits in order of preference, picked by the length of the exact match following them
+				size_t bestLength = 0;
+				bool ambiguous = false;
+				bool bestIsInsertion = false;
+				bool bestIsDeletion = false;
+				LengthType bestNode = std::numeric_limits<LengthType>::max();
+				auto checkEdit = [&](size_t length, size_t maxLength, LengthType next, bool insertion, bool deletion)
+				{
+					if (bestNode == std::numeric_limits<LengthType>::max() || length > bestLength)
+					{
+						bestLength = length;
+						ambiguous = false;
+						bestIsInsertion = insertion;
+						bestIsDeletion = deletion;
+						bestNode = next;
+					}
+					else if (length == bestLength && length < maxLength)
+					{
+						ambiguous = true;
+					}
+				};
+				for (auto next : nextNodes)
+				{
+					checkEdit(directWalkExactLength(next, nextOffset, sequence, seqPos+1), std::min(DirectWalkLookahead, sequence.size() - seqPos - 1), next, false, false);
+				}
+				checkEdit(directWalkExactLength(node, offset, sequence, seqPos+1), std::min(DirectWalkLookahead, sequence.size() - seqPos - 1), node, true, false);
+				for (auto next : nextNodes)
+				{
+					checkEdit(directWalkExactLength(next, nextOffset, sequence, seqPos), std::min(DirectWalkLookahead, sequence.size() - seqPos), next, false, true);
+				}
+				if (ambiguous) return OnewayTrace::TraceFailed();
+				if (bestLength < std::min(DirectWalkMinExactRun, sequence.size() - seqPos - (bestIsDeletion ? 0 : 1))) return OnewayTrace::TraceFailed();
+				if (bestIsInsertion)
+				{
+					result.trace.emplace_back(MatrixPosition { node, offset, seqPos }, false, sequence, params.graph);
+					seqPos += 1;
+				}
+				else
+				{
+					if (bestNode != node || nextOffset != offset + 1) result.trace.back().nodeSwitch = true;
+					node = bestNode;
+					offset = nextOffset;
+					result.trace.emplace_back(MatrixPosition { node, offset, bestIsDeletion ? seqPos-1 : seqPos }, false, sequence, params.graph);
+					if (!bestIsDeletion) seqPos += 1;
+				}
+			}
+			ScoreType XScore = (ScoreType)seqPos * 100 - edits * params.XscoreErrorCost;
+			if (XScore > bestXScore)
+			{
+				bestXScore = XScore;
+				bestXScoreEdits = edits;
+				bestXScoreIndex = result.trace.size()-1;
+			}
 		}
+		if (bestXScoreIndex == 0) return OnewayTrace::TraceFailed();
+		//clip trailing edits like the exact end position of the DP does
+		result.trace.erase(result.trace.begin() + bestXScoreIndex + 1, result.trace.end());
+		result.trace.back().nodeSwitch = false;
+		result.score = bestXScoreEdits;
+		return result;
+	}
+
+	//alignments store their traces in run-length form, with the cells classified the same way as in the GAF and GAM output
+	CompactTrace compactTrace(const OnewayTrace& trace) const
+	{
+		CompactTrace result;
+		result.score = trace.score;
+		for (size_t i = 0; i < trace.trace.size(); i++)
+		{
+			const MatrixPosition& pos = trace.trace[i].DPposition;
+			bool insideNode = i > 0 && (!trace.trace[i-1].nodeSwitch || ((int)pos.node == result.path.back().nodeId && pos.nodeOffset > result.path.back().startOffset));
+			TraceEdit edit;
+			if (i > 0 && pos.seqPos == trace.trace[i-1].DPposition.seqPos)
+			{
+				edit = TraceEdit::Deletion;
+			}
+			else if (insideNode && pos.nodeOffset == trace.trace[i-1].DPposition.nodeOffset)
+			{
+				edit = TraceEdit::Insertion;
+			}
+			else if (Common::characterMatch(trace.trace[i].sequenceCharacter, trace.trace[i].graphCharacter))
+			{
+				edit = TraceEdit::Match;
+			}
+			else
+			{
+				edit = TraceEdit::Mismatch;
+			}
+			result.append(edit, 1, !insideNode, pos.node, pos.nodeOffset, pos.seqPos);
+		}
+#ifndef NDEBUG
+		result.forEachChunk([&trace, &result](const TraceChunk& chunk)
+		{
+			for (size_t i = 0; i < chunk.length; i++)
+			{
+				const MatrixPosition& pos = trace.trace[chunk.firstCell + i].DPposition;
+				assert((int)pos.node == result.path[chunk.pathIndex].nodeId);
+				assert(pos.nodeOffset == chunk.nodeOffset + (chunk.edit == TraceEdit::Insertion ? 0 : i));
+				assert(pos.seqPos == chunk.seqPos + (chunk.edit == TraceEdit::Deletion ? 0 : i));
+			}
+			return true;
+		});
+#endif
 		return result;
 	}
 
@@ -611,12 +1265,12 @@ private:
 			if (mergedTrace.failed()) continue;
 			ScoreType alignmentXScore = (ScoreType)(mergedTrace.trace.back().DPposition.seqPos - mergedTrace.trace[0].DPposition.seqPos + 1)*100 - params.XscoreErrorCost * (ScoreType)mergedTrace.score;
 			if (alignmentXScore <= 0) continue;
-			result.emplace_back(std::move(mergedTrace), 0, std::numeric_limits<size_t>::max());
+			result.emplace_back(compactTrace(mergedTrace), 0, std::numeric_limits<size_t>::max());
 			LengthType seqstart = 0;
 			LengthType seqend = 0;
-			assert(result.back().trace->trace.size() > 0);
-			seqstart = result.back().trace->trace[0].DPposition.seqPos;
-			seqend = result.back().trace->trace.back().DPposition.seqPos;
+			assert(result.back().trace->cells > 0);
+			seqstart = result.back().trace->readStart;
+			seqend = result.back().trace->readEnd - 1;
 			assert(seqend < sequence.size());
 			result.back().alignmentScore = result.back().trace->score;
 			result.back().alignmentStart = seqstart;
@@ -631,6 +1285,7 @@ private:
 	AlignmentResult::AlignmentItem getAlignmentFromSeed(const std::string& seq_id, const std::string& sequence, const std::string& revSequence, SeedHit seedHit, AlignerGraphsizedState& reusableState) const
 	{
 		assert(params.graph.finalized);
+		if (params.scoreOnly) return getAlignmentEndsFromSeed(sequence, revSequence, seedHit, reusableState);
 		auto timeStart = std::chrono::system_clock::now();
 
 		auto trace = getTwoDirectionalTrace(sequence, revSequence, seedHit, reusableState);
@@ -671,13 +1326,13 @@ private:
 			mergedTrace.score += trace.forward.score;
 		}
 
-		AlignmentResult::AlignmentItem result { std::move(mergedTrace), 0, std::numeric_limits<size_t>::max() };
+		AlignmentResult::AlignmentItem result { compactTrace(mergedTrace), 0, std::numeric_limits<size_t>::max() };
 
 		LengthType seqstart = 0;
 		LengthType seqend = 0;
-		assert(result.trace->trace.size() > 0);
-		seqstart = result.trace->trace[0].DPposition.seqPos;
-		seqend = result.trace->trace.back().DPposition.seqPos;
+		assert(result.trace->cells > 0);
+		seqstart = result.trace->readStart;
+		seqend = result.trace->readEnd - 1;
 		assert(seqend < sequence.size());
 		// result.trace = traceVector;
 		result.alignmentScore = result.trace->score;
@@ -691,6 +1346,175 @@ private:
 		return result;
 	}
 
+	//score-only counterpart of getAlignmentFromSeed, the alignment has the graph positions of its ends but no trace
+	AlignmentResult::AlignmentItem getAlignmentEndsFromSeed(const std::string& sequence, const std::string& revSequence, SeedHit seedHit, AlignerGraphsizedState& reusableState) const
+	{
+		assert(seedHit.seqPos < sequence.size());
+		auto timeStart = std::chrono::system_clock::now();
+		int forwardNodeId = seedHit.nodeID * 2 + (seedHit.reverse ? 1 : 0);
+		int backwardNodeId = seedHit.nodeID * 2 + (seedHit.reverse ? 0 : 1);
+		auto reversePos = params.graph.GetReversePosition(forwardNodeId, seedHit.nodeOffset);
+		assert(reversePos.first == backwardNodeId);
+		OnewayEnd backward = OnewayEnd::EndFailed();
+		OnewayEnd forward = OnewayEnd::EndFailed();
+		std::vector<std::function<void(AlignerGraphsizedState&)>> halves;
+		if (seedHit.seqPos > 0)
+		{
+			halves.emplace_back([this, &backward, &revSequence, &seedHit, &reversePos](AlignerGraphsizedState& state)
+			{
+				std::string_view backwardPart { revSequence.data() + revSequence.size() - seedHit.seqPos, seedHit.seqPos };
+				backward = getOnewayEnd(backwardPart, reversePos.first, reversePos.second, state);
+			});
+		}
+		if (seedHit.seqPos < sequence.size()-1)
+		{
+			halves.emplace_back([this, &forward, &sequence, &seedHit, forwardNodeId](AlignerGraphsizedState& state)
+			{
+				std::string_view forwardPart { sequence.data() + seedHit.seqPos + 1, sequence.size() - seedHit.seqPos - 1 };
+				forward = getOnewayEnd(forwardPart, forwardNodeId, seedHit.nodeOffset, state);
+			});
+		}
+		reusableState.runTasks(halves);
+		if (forward.failed() && backward.failed()) return emptyAlignment(0, 0);
+		//a failed half ends at the seed
+		AlignmentResult::AlignmentItem result;
+		result.alignmentStartPos = MatrixPosition { (size_t)forwardNodeId, seedHit.nodeOffset, seedHit.seqPos };
+		result.alignmentEndPos = result.alignmentStartPos;
+		result.alignmentScore = 0;
+		if (!backward.failed())
+		{
+			auto pos = backward.position;
+			auto startPos = params.graph.GetReversePosition(params.graph.nodeIDs[pos.node], params.graph.nodeOffset[pos.node] + pos.nodeOffset);
+			assert(pos.seqPos < seedHit.seqPos);
+			result.alignmentStartPos = MatrixPosition { (size_t)startPos.first, startPos.second, seedHit.seqPos - 1 - pos.seqPos };
+			result.alignmentScore += backward.score;
+		}
+		if (!forward.failed())
+		{
+			auto pos = forward.position;
+			result.alignmentEndPos = MatrixPosition { (size_t)params.graph.nodeIDs[pos.node], params.graph.nodeOffset[pos.node] + pos.nodeOffset, seedHit.seqPos + 1 + pos.seqPos };
+			assert(result.alignmentEndPos.seqPos < sequence.size());
+			result.alignmentScore += forward.score;
+		}
+		result.alignmentStart = result.alignmentStartPos.seqPos;
+		result.alignmentEnd = result.alignmentEndPos.seqPos + 1;
+		auto timeEnd = std::chrono::system_clock::now();
+		result.elapsedMilliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - timeStart).count();
+		result.alignmentXScore = (ScoreType)result.alignmentLength()*100 - params.XscoreErrorCost * (ScoreType)result.alignmentScore;
+		result.alignmentXScore /= 100.0;
+		return result;
+	}
+
+	//end of a one-way extension from the seed cell, tried with the same engines as getTwoDirectionalTrace
+	OnewayEnd getOnewayEnd(const std::string_view& sequence, int bigraphNodeId, size_t nodeOffset, AlignerGraphsizedState& reusableState) const
+	{
+		OnewayTrace trace = OnewayTrace::TraceFailed();
+		if (params.sloppyOptimizations) trace = getDirectWalkTrace(sequence, bigraphNodeId, nodeOffset);
+		if (trace.failed() && params.wavefrontMaxDivergence > 0) trace = wfAligner.getTraceFromSeed(sequence, bigraphNodeId, nodeOffset, params.wavefrontMaxDivergence, reusableState);
+		if (trace.failed()) return bvAligner.getEndFromSeed(sequence, bigraphNodeId, nodeOffset, params.Xdropcutoff, reusableState);
+		OnewayEnd result;
+		result.position = trace.trace.back().DPposition;
+		result.score = trace.score;
+		return result;
+	}
+
+	enum class SeedDecision
+	{
+		Stop,
+		Skip,
+		Extend
+	};
+
+	//running state of the seed loop in AlignOneWay
+	struct SeedLoopState
+	{
+		size_t extendSeeds;
+		size_t worstExtendedSeedScore;
+		size_t seedScoreForEndToEndAln;
+		//seeds whose prefilter extensions collapsed
+		std::vector<bool> collapses;
+		//seeds before this have been prefiltered
+		size_t prefilteredEnd;
+	};
+
+	//whether seed i would be extended given the alignments so far, logging the reason only if log is set
+	//the first call reaching a run of equal seed goodness prefilters and reorders it, the stop checks before that only depend on the goodness
+	SeedDecision checkSeed(const std::string& seq_id, const std::string& sequence, const std::string& revSequence, std::vector<SeedHit>& seedHits, size_t i, const AlignmentResult& result, SeedLoopState& loop, AlignerGraphsizedState& reusableState, bool log) const
+	{
+		if (reusableState.budget.exhausted())
+		{
+			if (log) logger << "Read " << seq_id << " out of budget, skip rest of the seeds" << BufferedWriter::Flush;
+			return SeedDecision::Stop;
+		}
+		if (params.sloppyOptimizations && (seedHits[i].seedGoodness == loop.seedScoreForEndToEndAln || seedHits[i].seedGoodness < loop.seedScoreForEndToEndAln))
+		{
+			if (log) logger << "Read " << seq_id << " aligned end-to-end, skip rest of the seeds" << BufferedWriter::Flush;
+			return SeedDecision::Stop;
+		}
+		if (result.seedsExtended >= loop.extendSeeds && (seedHits[i].seedGoodness < loop.worstExtendedSeedScore))
+		{
+			if (log) logger << "Read " << seq_id << " enough seeds extended, skip rest" << BufferedWriter::Flush;
+			return SeedDecision::Stop;
+		}
+		if (params.sloppyOptimizations)
+		{
+			while (loop.prefilteredEnd <= i) loop.prefilteredEnd = prefilterSeedRun(sequence, revSequence, seedHits, loop.collapses, loop.prefilteredEnd);
+		}
+		if (log)
+		{
+			assertSetRead(seq_id, seedHits[i].nodeID, seedHits[i].reverse, seedHits[i].seqPos, seedHits[i].matchLen, seedHits[i].nodeOffset);
+			if (!logger.inputDiscarded()) logger << seq_id << " seed " << i << "/" << seedHits.size() << " " << ThreadReadAssertion::assertGetSeedInfo();
+		}
+		if (seedHits[i].seedClusterSize < params.minSeedClusterSize)
+		{
+			if (log) logger << " skipped (cluster size)" << BufferedWriter::Flush;
+			return SeedDecision::Skip;
+		}
+		if (params.sloppyOptimizations)
+		{
+			for (const auto& aln : result.alignments)
+			{
+				if (aln.alignmentStart <= seedHits[i].seqPos && aln.alignmentEnd >= seedHits[i].seqPos && aln.seedGoodness > seedHits[i].seedGoodness)
+				{
+					if (log) logger << " skipped (overlap)" << BufferedWriter::Flush;
+					return SeedDecision::Skip;
+				}
+			}
+		}
+		for (const auto& aln : result.alignments)
+		{
+			if (exactAlignmentPart(aln, seedHits[i]))
+			{
+				if (log) logger << " skipped (existing alignment)" << BufferedWriter::Flush;
+				return SeedDecision::Skip;
+			}
+		}
+		if (params.sloppyOptimizations && !seedCanPassSelection(sequence.size(), seedHits[i], result.alignments))
+		{
+			if (log) logger << " skipped (score bound)" << BufferedWriter::Flush;
+			return SeedDecision::Skip;
+		}
+		if (loop.collapses[i])
+		{
+			if (log) logger << " skipped (collapsed prefilter extension)" << BufferedWriter::Flush;
+			return SeedDecision::Skip;
+		}
+		if (log) logger << BufferedWriter::Flush;
+		return SeedDecision::Extend;
+	}
+
+	//once the budget has stopped some extension all of the read's alignments are marked as possibly partial
+	//doesn't recheck the limits, a read that finished right at the deadline is complete
+	void markBudgetExhausted(AlignmentResult& result, const AlignerGraphsizedState& reusableState) const
+	{
+		if (!reusableState.budget.stoppedWork()) return;
+		result.budgetExhausted = true;
+		for (auto& aln : result.alignments)
+		{
+			aln.budgetExhausted = true;
+		}
+	}
+
 	static AlignmentResult::AlignmentItem emptyAlignment(size_t elapsedMilliseconds, size_t cellsProcessed)
 	{
 		AlignmentResult::AlignmentItem result;
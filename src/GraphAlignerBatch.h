@@ -0,0 +1,531 @@
+#ifndef GraphAlignerBatch_h
+#define GraphAlignerBatch_h
+
+#include <algorithm>
+#include <string_view>
+#include <vector>
+#include <limits>
+#include <phmap.h>
+#include "AlignmentGraph.h"
+#include "ThreadReadAssertion.h"
+#include "GraphAlignerCommon.h"
+#include "GraphAlignerBitvectorCommon.h"
+
+//aligns short reads to the graph region around their seeds, with one read per lane of the bitvector recurrence
+//reads whose seeds are in the same region share the region and are calculated together, so there is no band, queue or per-read state to set up
+//each read is aligned from end to end with a free start and end in the region, and the trace is clipped like the DP trace
+template <typename LengthType, typename ScoreType, typename Word>
+class GraphAlignerBatch
+{
+private:
+	using Common = GraphAlignerCommon<LengthType, ScoreType, Word>;
+	using BV = GraphAlignerBitvectorCommon<LengthType, ScoreType, Word>;
+	using WordSlice = typename BV::WordSlice;
+	using EqVector = typename BV::EqVector;
+	using Params = typename Common::Params;
+	using MatrixPosition = typename Common::MatrixPosition;
+	using OnewayTrace = typename Common::OnewayTrace;
+	static constexpr size_t Lanes = BV::SliceLanes;
+	//the region of a read reaches this far past the read in both directions from its seed
+	static constexpr size_t RegionSlack = 32;
+	//reads whose region is larger than this many bp are not batched, and a batch region doesn't grow past it
+	static constexpr size_t MaxRegionSize = 20000;
+	struct BatchRegion
+	{
+		//in calculation order, predecessors first where the region has no cycles
+		std::vector<LengthType> nodes;
+		//first column of each node, the last item is the number of columns
+		std::vector<size_t> columnStart;
+		std::vector<size_t> columnNode;
+		//region indices of the in-neighbors and out-neighbors inside the region
+		std::vector<std::vector<size_t>> predecessors;
+		std::vector<std::vector<size_t>> successors;
+	};
+	struct TraceCell
+	{
+		size_t row;
+		size_t column;
+		bool insertion;
+	};
+	const Params& params;
+public:
+	//reads longer than this many words are not batched
+	static constexpr size_t MaxReadWords = 4;
+	struct BatchRead
+	{
+		std::string_view sequence;
+		int bigraphNodeId;
+		size_t nodeOffset;
+		size_t seqPos;
+	};
+
+	GraphAlignerBatch(const Params& params) :
+	params(params)
+	{
+	}
+
+	//one trace per read starting from seqPos 0 of the read if possible, TraceFailed for reads which can't be batched
+	std::vector<OnewayTrace> getTraces(const std::vector<BatchRead>& reads) const
+	{
+		std::vector<OnewayTrace> result;
+		result.reserve(reads.size());
+		for (size_t i = 0; i < reads.size(); i++)
+		{
+			result.emplace_back(OnewayTrace::TraceFailed());
+		}
+		std::vector<std::vector<size_t>> groupReads;
+		std::vector<phmap::flat_hash_set<LengthType>> groupNodes;
+		std::vector<size_t> groupSize;
+		for (size_t i = 0; i < reads.size(); i++)
+		{
+			if (reads[i].sequence.size() == 0 || reads[i].sequence.size() > MaxReadWords * WordConfiguration<Word>::WordSize) continue;
+			assert(reads[i].seqPos < reads[i].sequence.size());
+			LengthType seedNode = params.graph.GetUnitigNode(reads[i].bigraphNodeId, reads[i].nodeOffset);
+			std::vector<LengthType> nodes = getReadRegion(reads[i], seedNode);
+			if (nodes.size() == 0) continue;
+			size_t group = groupReads.size();
+			for (size_t j = 0; j < groupReads.size(); j++)
+			{
+				if (groupReads[j].size() == Lanes) continue;
+				if (groupNodes[j].count(seedNode) == 0) continue;
+				size_t addedSize = 0;
+				for (auto node : nodes)
+				{
+					if (groupNodes[j].count(node) == 0) addedSize += params.graph.NodeLength(node);
+				}
+				if (groupSize[j] + addedSize > MaxRegionSize) continue;
+				group = j;
+				break;
+			}
+			if (group == groupReads.size())
+			{
+				groupReads.emplace_back();
+				groupNodes.emplace_back();
+				groupSize.push_back(0);
+			}
+			groupReads[group].push_back(i);
+			for (auto node : nodes)
+			{
+				if (groupNodes[group].insert(node).second) groupSize[group] += params.graph.NodeLength(node);
+			}
+		}
+		for (size_t i = 0; i < groupReads.size(); i++)
+		{
+			BatchRegion region = getBatchRegion(groupNodes[i]);
+			alignGroup(reads, groupReads[i], region, result);
+		}
+		return result;
+	}
+
+private:
+
+	//nodes the read can reach from its seed with a few edits, empty if there are too many
+	std::vector<LengthType> getReadRegion(const BatchRead& read, LengthType seedNode) const
+	{
+		assert(read.nodeOffset >= params.graph.nodeOffset[seedNode]);
+		size_t seedOffset = read.nodeOffset - params.graph.nodeOffset[seedNode];
+		assert(seedOffset < params.graph.NodeLength(seedNode));
+		size_t forwardReach = read.sequence.size() - read.seqPos + RegionSlack;
+		size_t backwardReach = read.seqPos + RegionSlack;
+		phmap::flat_hash_set<LengthType> region;
+		size_t regionSize = 0;
+		region.insert(seedNode);
+		regionSize += params.graph.NodeLength(seedNode);
+		//bp between the seed and the start of each node forwards, and the end of each node backwards
+		phmap::flat_hash_map<LengthType, size_t> forwardDistance;
+		phmap::flat_hash_map<LengthType, size_t> backwardDistance;
+		std::vector<std::pair<LengthType, size_t>> stack;
+		stack.emplace_back(seedNode, params.graph.NodeLength(seedNode) - seedOffset);
+		while (stack.size() > 0)
+		{
+			auto top = stack.back();
+			stack.pop_back();
+			if (top.second >= forwardReach) continue;
+			for (auto neighbor : params.graph.outNeighbors[top.first])
+			{
+				auto found = forwardDistance.find(neighbor);
+				if (found != forwardDistance.end() && found->second <= top.second) continue;
+				forwardDistance[neighbor] = top.second;
+				if (region.insert(neighbor).second) regionSize += params.graph.NodeLength(neighbor);
+				if (regionSize > MaxRegionSize) return std::vector<LengthType>{};
+				stack.emplace_back(neighbor, top.second + params.graph.NodeLength(neighbor));
+			}
+		}
+		stack.emplace_back(seedNode, seedOffset);
+		while (stack.size() > 0)
+		{
+			auto top = stack.back();
+			stack.pop_back();
+			if (top.second >= backwardReach) continue;
+			for (auto neighbor : params.graph.inNeighbors[top.first])
+			{
+				auto found = backwardDistance.find(neighbor);
+				if (found != backwardDistance.end() && found->second <= top.second) continue;
+				backwardDistance[neighbor] = top.second;
+				if (region.insert(neighbor).second) regionSize += params.graph.NodeLength(neighbor);
+				if (regionSize > MaxRegionSize) return std::vector<LengthType>{};
+				stack.emplace_back(neighbor, top.second + params.graph.NodeLength(neighbor));
+			}
+		}
+		std::vector<LengthType> result { region.begin(), region.end() };
+		std::sort(result.begin(), result.end());
+		return result;
+	}
+
+	BatchRegion getBatchRegion(const phmap::flat_hash_set<LengthType>& nodeSet) const
+	{
+		std::vector<LengthType> nodes { nodeSet.begin(), nodeSet.end() };
+		std::sort(nodes.begin(), nodes.end());
+		phmap::flat_hash_map<LengthType, size_t> index;
+		for (size_t i = 0; i < nodes.size(); i++)
+		{
+			index[nodes[i]] = i;
+		}
+		//topological order, cycles are broken at their smallest node
+		std::vector<size_t> inDegree;
+		inDegree.resize(nodes.size(), 0);
+		for (size_t i = 0; i < nodes.size(); i++)
+		{
+			for (auto neighbor : params.graph.inNeighbors[nodes[i]])
+			{
+				if (index.count(neighbor) == 1) inDegree[i] += 1;
+			}
+		}
+		std::vector<size_t> order;
+		std::vector<bool> placed;
+		placed.resize(nodes.size(), false);
+		std::vector<size_t> ready;
+		for (size_t i = nodes.size()-1; i < nodes.size(); i--)
+		{
+			if (inDegree[i] == 0) ready.push_back(i);
+		}
+		size_t nextForced = 0;
+		while (order.size() < nodes.size())
+		{
+			if (ready.size() == 0)
+			{
+				while (placed[nextForced]) nextForced++;
+				ready.push_back(nextForced);
+			}
+			size_t i = ready.back();
+			ready.pop_back();
+			if (placed[i]) continue;
+			placed[i] = true;
+			order.push_back(i);
+			for (auto neighbor : params.graph.outNeighbors[nodes[i]])
+			{
+				auto found = index.find(neighbor);
+				if (found == index.end() || placed[found->second]) continue;
+				assert(inDegree[found->second] > 0);
+				inDegree[found->second] -= 1;
+				if (inDegree[found->second] == 0) ready.push_back(found->second);
+			}
+		}
+		BatchRegion result;
+		result.nodes.reserve(nodes.size());
+		for (auto i : order)
+		{
+			result.nodes.push_back(nodes[i]);
+		}
+		for (size_t i = 0; i < result.nodes.size(); i++)
+		{
+			index[result.nodes[i]] = i;
+		}
+		result.predecessors.resize(result.nodes.size());
+		result.successors.resize(result.nodes.size());
+		result.columnStart.push_back(0);
+		for (size_t i = 0; i < result.nodes.size(); i++)
+		{
+			for (auto neighbor : params.graph.inNeighbors[result.nodes[i]])
+			{
+				auto found = index.find(neighbor);
+				if (found == index.end()) continue;
+				result.predecessors[i].push_back(found->second);
+				result.successors[found->second].push_back(i);
+			}
+			size_t length = params.graph.NodeLength(result.nodes[i]);
+			result.columnStart.push_back(result.columnStart.back() + length);
+			for (size_t j = 0; j < length; j++)
+			{
+				result.columnNode.push_back(i);
+			}
+		}
+		return result;
+	}
+
+	static EqVector getLaneEqVector(const std::string_view& sequence, size_t j)
+	{
+		if (j >= sequence.size()) return EqVector { WordConfiguration<Word>::AllZeros, WordConfiguration<Word>::AllZeros, WordConfiguration<Word>::AllZeros, WordConfiguration<Word>::AllZeros };
+		return BV::getEqVector(sequence, j);
+	}
+
+	void alignGroup(const std::vector<BatchRead>& reads, const std::vector<size_t>& lanes, const BatchRegion& region, std::vector<OnewayTrace>& result) const
+	{
+		assert(lanes.size() > 0);
+		assert(lanes.size() <= Lanes);
+		size_t numColumns = region.columnStart.back();
+		size_t numBlocks = 0;
+		for (auto read : lanes)
+		{
+			numBlocks = std::max(numBlocks, (reads[read].sequence.size() + WordConfiguration<Word>::WordSize - 1) / WordConfiguration<Word>::WordSize);
+		}
+		//unused lanes align an empty read
+		std::vector<EqVector> EqV;
+		EqV.reserve(numBlocks * Lanes);
+		for (size_t block = 0; block < numBlocks; block++)
+		{
+			for (size_t lane = 0; lane < Lanes; lane++)
+			{
+				std::string_view sequence;
+				if (lane < lanes.size()) sequence = reads[lanes[lane]].sequence;
+				EqV.push_back(getLaneEqVector(sequence, block * WordConfiguration<Word>::WordSize));
+			}
+		}
+		std::vector<WordSlice> columns;
+		columns.resize(numBlocks * numColumns * Lanes);
+		std::vector<bool> dirty;
+		for (size_t block = 0; block < numBlocks; block++)
+		{
+			WordSlice* current = columns.data() + block * numColumns * Lanes;
+			const WordSlice* previousBlock = block == 0 ? nullptr : current - numColumns * Lanes;
+			//until a node is calculated its end column only moves down from the row before the block
+			for (size_t i = 0; i < region.nodes.size(); i++)
+			{
+				size_t endColumn = region.columnStart[i+1]-1;
+				for (size_t lane = 0; lane < Lanes; lane++)
+				{
+					current[endColumn * Lanes + lane] = BV::getSourceSliceFromScore(getBoundaryScore(previousBlock, endColumn, lane));
+				}
+			}
+			//nodes are recalculated until the end columns don't change, which takes one pass if the region has no cycles
+			dirty.assign(region.nodes.size(), true);
+			bool anyDirty = true;
+			while (anyDirty)
+			{
+				anyDirty = false;
+				for (size_t i = 0; i < region.nodes.size(); i++)
+				{
+					if (!dirty[i]) continue;
+					dirty[i] = false;
+					if (!calculateNode(region, i, block, current, previousBlock, EqV.data() + block * Lanes)) continue;
+					for (auto successor : region.successors[i])
+					{
+						dirty[successor] = true;
+						if (successor <= i) anyDirty = true;
+					}
+				}
+			}
+		}
+		for (size_t lane = 0; lane < lanes.size(); lane++)
+		{
+			const std::string_view& sequence = reads[lanes[lane]].sequence;
+			size_t lastRow = sequence.size()-1;
+			ScoreType bestScore = std::numeric_limits<ScoreType>::max();
+			size_t bestColumn = 0;
+			for (size_t column = 0; column < numColumns; column++)
+			{
+				ScoreType score = getScore(columns, numColumns, lastRow, column, lane);
+				if (score < bestScore)
+				{
+					bestScore = score;
+					bestColumn = column;
+				}
+			}
+			result[lanes[lane]] = getTrace(region, columns, numColumns, lane, sequence, bestColumn, bestScore);
+		}
+	}
+
+	//score at the row before the block, the read may start anywhere so the row before the read is 0
+	static ScoreType getBoundaryScore(const WordSlice* previousBlock, size_t column, size_t lane)
+	{
+		if (previousBlock == nullptr) return 0;
+		return previousBlock[column * Lanes + lane].scoreEnd;
+	}
+
+	//returns whether the end column of the node changed in any lane
+	bool calculateNode(const BatchRegion& region, size_t regionIndex, size_t block, WordSlice* current, const WordSlice* previousBlock, const EqVector* EqV) const
+	{
+		LengthType node = region.nodes[regionIndex];
+		size_t start = region.columnStart[regionIndex];
+		size_t length = region.columnStart[regionIndex+1] - start;
+		WordSlice slices[Lanes];
+		Word hinP[Lanes];
+		Word hinN[Lanes];
+		Word Eq[Lanes];
+		for (size_t lane = 0; lane < Lanes; lane++)
+		{
+			ScoreType before = getBoundaryScore(previousBlock, start, lane);
+			//the column left of the node is the cellwise minimum of the in-neighbors' end columns
+			//nodes entered from outside the region can only start the read
+			WordSlice previous;
+			if (region.predecessors[regionIndex].size() == 0)
+			{
+				previous = BV::getSourceSliceFromScore(block == 0 ? 0 : before + 1);
+			}
+			else
+			{
+				previous = current[(region.columnStart[region.predecessors[regionIndex][0]+1]-1) * Lanes + lane];
+				for (size_t i = 1; i < region.predecessors[regionIndex].size(); i++)
+				{
+					previous = previous.mergeWith(current[(region.columnStart[region.predecessors[regionIndex][i]+1]-1) * Lanes + lane]);
+				}
+			}
+			ScoreType hin = before - previous.getScoreBeforeStart();
+			assert(hin >= -1 && hin <= 1);
+			hinP[lane] = hin > 0 ? 1 : 0;
+			hinN[lane] = hin < 0 ? 1 : 0;
+			slices[lane] = previous;
+		}
+		for (size_t offset = 0; offset < length; offset++)
+		{
+			char graphChar = params.graph.NodeSequences(node, offset);
+			for (size_t lane = 0; lane < Lanes; lane++)
+			{
+				Eq[lane] = EqV[lane].getEqC(graphChar);
+			}
+			if (offset > 0)
+			{
+				for (size_t lane = 0; lane < Lanes; lane++)
+				{
+					ScoreType hin = getBoundaryScore(previousBlock, start + offset, lane) - getBoundaryScore(previousBlock, start + offset - 1, lane);
+					assert(hin >= -1 && hin <= 1);
+					hinP[lane] = hin > 0 ? 1 : 0;
+					hinN[lane] = hin < 0 ? 1 : 0;
+				}
+			}
+			BV::getNextSlices(Eq, slices, hinP, hinN);
+			if (offset+1 < length)
+			{
+				for (size_t lane = 0; lane < Lanes; lane++)
+				{
+					current[(start + offset) * Lanes + lane] = slices[lane];
+				}
+			}
+		}
+		bool changed = false;
+		WordSlice* end = current + (start + length - 1) * Lanes;
+		for (size_t lane = 0; lane < Lanes; lane++)
+		{
+			if (end[lane].VP != slices[lane].VP || end[lane].VN != slices[lane].VN || end[lane].scoreEnd != slices[lane].scoreEnd) changed = true;
+			end[lane] = slices[lane];
+		}
+		return changed;
+	}
+
+	static ScoreType getScore(const std::vector<WordSlice>& columns, size_t numColumns, size_t row, size_t column, size_t lane)
+	{
+		size_t block = row / WordConfiguration<Word>::WordSize;
+		return columns[(block * numColumns + column) * Lanes + lane].getValue(row % WordConfiguration<Word>::WordSize);
+	}
+
+	static ScoreType getScoreAbove(const std::vector<WordSlice>& columns, size_t numColumns, size_t row, size_t column, size_t lane)
+	{
+		if (row == 0) return 0;
+		return getScore(columns, numColumns, row-1, column, lane);
+	}
+
+	OnewayTrace getTrace(const BatchRegion& region, const std::vector<WordSlice>& columns, size_t numColumns, size_t lane, const std::string_view& sequence, size_t endColumn, ScoreType endScore) const
+	{
+		std::vector<TraceCell> cells;
+		size_t row = sequence.size()-1;
+		size_t column = endColumn;
+		ScoreType score = endScore;
+		while (true)
+		{
+			cells.push_back(TraceCell { row, column, false });
+			//the row before the read is free so the trace starts at the first row
+			if (row == 0) break;
+			size_t regionIndex = region.columnNode[column];
+			size_t offset = column - region.columnStart[regionIndex];
+			ScoreType mismatch = Common::characterMatch(sequence[row], params.graph.NodeSequences(region.nodes[regionIndex], offset)) ? 0 : 1;
+			std::vector<size_t> previousColumns;
+			if (offset > 0)
+			{
+				previousColumns.push_back(column-1);
+			}
+			else
+			{
+				for (auto predecessor : region.predecessors[regionIndex])
+				{
+					previousColumns.push_back(region.columnStart[predecessor+1]-1);
+				}
+			}
+			bool moved = false;
+			for (auto previous : previousColumns)
+			{
+				if (getScore(columns, numColumns, row-1, previous, lane) + mismatch == score)
+				{
+					row -= 1;
+					column = previous;
+					score -= mismatch;
+					moved = true;
+					break;
+				}
+			}
+			if (moved) continue;
+			if (getScore(columns, numColumns, row-1, column, lane) + 1 == score)
+			{
+				cells.back().insertion = true;
+				row -= 1;
+				score -= 1;
+				continue;
+			}
+			for (auto previous : previousColumns)
+			{
+				if (getScore(columns, numColumns, row, previous, lane) + 1 == score)
+				{
+					column = previous;
+					score -= 1;
+					moved = true;
+					break;
+				}
+			}
+			if (moved) continue;
+			//entered the region from outside in the middle of the read, the caller aligns the rest of the start
+			assert(offset == 0 && region.predecessors[regionIndex].size() == 0);
+			break;
+		}
+		std::reverse(cells.begin(), cells.end());
+		OnewayTrace result;
+		ScoreType edits = 0;
+		ScoreType bestXScore = std::numeric_limits<ScoreType>::min();
+		ScoreType bestXScoreEdits = 0;
+		size_t bestXScoreIndex = 0;
+		for (size_t i = 0; i < cells.size(); i++)
+		{
+			size_t regionIndex = region.columnNode[cells[i].column];
+			LengthType node = region.nodes[regionIndex];
+			LengthType offset = cells[i].column - region.columnStart[regionIndex];
+			if (i > 0 && !cells[i].insertion)
+			{
+				const MatrixPosition& previous = result.trace.back().DPposition;
+				if (node != previous.node || offset != previous.nodeOffset + 1) result.trace.back().nodeSwitch = true;
+			}
+			result.trace.emplace_back(MatrixPosition { node, offset, cells[i].row }, false, sequence, params.graph);
+			if (i > 0 && (cells[i].insertion || cells[i].row == cells[i-1].row))
+			{
+				edits += 1;
+			}
+			else if (!Common::characterMatch(result.trace.back().sequenceCharacter, result.trace.back().graphCharacter))
+			{
+				edits += 1;
+			}
+			ScoreType XScore = (ScoreType)(cells[i].row - cells[0].row + 1) * 100 - edits * params.XscoreErrorCost;
+			if (XScore > bestXScore)
+			{
+				bestXScore = XScore;
+				bestXScoreEdits = edits;
+				bestXScoreIndex = i;
+			}
+		}
+		if (bestXScore <= 0) return OnewayTrace::TraceFailed();
+		//clip trailing edits like the exact end position of the DP does
+		result.trace.erase(result.trace.begin() + bestXScoreIndex + 1, result.trace.end());
+		result.trace.back().nodeSwitch = false;
+		result.score = bestXScoreEdits;
+		return result;
+	}
+
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <string>
 #include <vector>
+#include <deque>
 #include <cmath>
 #include <iostream>
 #include <string_view>
@@ -28,25 +29,37 @@ private:
 	using MatrixPosition = typename Common::MatrixPosition;
 	using Trace = typename Common::Trace;
 	using OnewayTrace = typename Common::OnewayTrace;
+	using OnewayEnd = typename Common::OnewayEnd;
 	using WordSlice = typename BV::WordSlice;
 	using EqVector = typename BV::EqVector;
 	using EdgeWithPriority = typename Common::EdgeWithPriority;
 	using DPSlice = typename BV::DPSlice;
 	using DPTable = typename BV::DPTable;
+	using FullStartSliceCache = typename Common::FullStartSliceCache;
 	using NodeCalculationResult = typename BV::NodeCalculationResult;
+	//how many slices are rewound when the alignment bandwidth fails, and how far the ramp bandwidth continues past the failure
+	static constexpr size_t RampRewindSlices = 3;
+	//a slice whose minimum score grows by more than this has probably lost the correct alignment
+	static constexpr ScoreType RampScoreJump = WordConfiguration<Word>::WordSize / 4;
 	const Params& params;
+	//node calculation kernels for this CPU
+	typename BV::template NodeCalculationFunction<AlignmentGraph::NodeChunkSequence> calculateNode;
+	typename BV::template NodeCalculationFunction<AlignmentGraph::AmbiguousChunkSequence> calculateAmbiguousNode;
 public:
 
 	GraphAlignerBitvectorBanded(const Params& params) :
-	params(params)
+	params(params),
+	calculateNode(BV::template selectNodeCalculation<AlignmentGraph::NodeChunkSequence>()),
+	calculateAmbiguousNode(BV::template selectNodeCalculation<AlignmentGraph::AmbiguousChunkSequence>())
 	{
 	}
 
 	std::vector<OnewayTrace> getMultiseedTraces(const std::string_view& sequence, const std::vector<SeedHit>& seedHits, AlignerGraphsizedState& reusableState) const
 	{
 		size_t numSlices = (sequence.size() + WordConfiguration<Word>::WordSize - 1) / WordConfiguration<Word>::WordSize;
-		auto initialSlice = BV::getInitialEmptySlice();
+		auto initialSlice = BV::getInitialEmptySlice(&reusableState.sliceArena);
 		auto slice = getMultiseedSlices(sequence, initialSlice, numSlices, reusableState, seedHits);
+		if (slice.slices.size() <= 1) return {};
 		std::vector<OnewayTrace> results = BV::getLocalMaximaTracesFromTable(params, sequence, slice, reusableState, true, true);
 		removeDuplicateTraces(results);
 		for (size_t i = 0; i < results.size(); i++)
@@ -59,8 +72,8 @@ public:
 	OnewayTrace getReverseTraceFromSeed(const std::string_view& sequence, int bigraphNodeId, size_t nodeOffset, int Xdropcutoff, AlignerGraphsizedState& reusableState) const
 	{
 		size_t numSlices = (sequence.size() + WordConfiguration<Word>::WordSize - 1) / WordConfiguration<Word>::WordSize;
-		auto alignmentBandwidth = BV::getInitialSliceExactPosition(params, bigraphNodeId, nodeOffset);
-		auto slice = getSlices(sequence, alignmentBandwidth, numSlices, Xdropcutoff, reusableState);
+		auto alignmentBandwidth = BV::getInitialSliceExactPosition(params, bigraphNodeId, nodeOffset, &reusableState.sliceArena);
+		auto slice = getSlices(sequence, alignmentBandwidth, numSlices, Xdropcutoff, false, reusableState);
 		if (slice.slices.size() <= 1)
 		{
 			return OnewayTrace::TraceFailed();
@@ -75,24 +88,80 @@ public:
 		return result;
 	}
 
+	//same end position and score as the trace from getReverseTraceFromSeed, but only two slices are kept in memory at a time
+	OnewayEnd getEndFromSeed(const std::string_view& sequence, int bigraphNodeId, size_t nodeOffset, int Xdropcutoff, AlignerGraphsizedState& reusableState) const
+	{
+		size_t numSlices = (sequence.size() + WordConfiguration<Word>::WordSize - 1) / WordConfiguration<Word>::WordSize;
+		auto initialSlice = BV::getInitialSliceExactPosition(params, bigraphNodeId, nodeOffset, &reusableState.sliceArena);
+		auto slice = getSlices(sequence, initialSlice, numSlices, Xdropcutoff, true, reusableState);
+		if (slice.slices.size() <= 1)
+		{
+			return OnewayEnd::EndFailed();
+		}
+		size_t bestIndex = 1;
+		for (size_t i = 1; i < slice.slices.size(); i++)
+		{
+			if (slice.slices[i].maxExactEndposScore > slice.slices[bestIndex].maxExactEndposScore)
+			{
+				bestIndex = i;
+			}
+		}
+		assert(slice.slices[bestIndex].exactEndScore != std::numeric_limits<ScoreType>::max());
+		OnewayEnd result;
+		result.position = slice.slices[bestIndex].exactEndPos;
+		result.score = slice.slices[bestIndex].exactEndScore;
+		return result;
+	}
+
 	OnewayTrace getBacktraceFullStart(const std::string_view& originalSequence, int Xdropcutoff, AlignerGraphsizedState& reusableState) const
 	{
 		assert(originalSequence.size() > 1);
 		DPSlice startSlice;
 		startSlice.j = -WordConfiguration<Word>::WordSize;
-		startSlice.scores.addEmptyNodeMap(params.graph.NodeSize());
+		char firstChar = originalSequence[0];
+		auto firstRow = reusableState.fullStartSlices->get(Common::matchedBases(firstChar), [this, firstChar]() { return getFullStartRow(firstChar); });
+		startSlice.scores.shareNodeMap(firstRow->scores, &reusableState.sliceArena);
 		startSlice.bandwidth = 1;
 		startSlice.minScore = 0;
 		startSlice.minScoreNode = 0;
 		startSlice.minScoreNodeOffset = 0;
-		startSlice.maxExactEndposScore = -params.XscoreErrorCost;
-		startSlice.maxExactEndposNode = 0;
-		char firstChar = originalSequence[0];
+		startSlice.maxExactEndposScore = firstRow->hasExactMatch ? 0 : -params.XscoreErrorCost;
+		startSlice.maxExactEndposNode = firstRow->hasExactMatch ? firstRow->exactMatchNode : 0;
+		std::string_view alignableSequence { originalSequence.data()+1, originalSequence.size() - 1 };
+		assert(alignableSequence.size() > 0);
+		size_t numSlices = (alignableSequence.size() + WordConfiguration<Word>::WordSize - 1) / WordConfiguration<Word>::WordSize;
+		auto slice = getSlices(alignableSequence, startSlice, numSlices, Xdropcutoff, false, reusableState);
+		if (slice.slices.size() <= 1)
+		{
+			return OnewayTrace::TraceFailed();
+		}
+
+		OnewayTrace result;
+		result = BV::getReverseTraceFromTableExactEndPos(params, alignableSequence, slice, reusableState, true, false);
+		for (size_t i = 0; i < result.trace.size(); i++)
+		{
+			result.trace[i].DPposition.seqPos += 1;
+		}
+		std::reverse(result.trace.begin(), result.trace.end());
+		result.trace[0].sequenceCharacter = originalSequence[0];
+		assert(result.trace[0].DPposition.seqPos == 0);
+		return result;
+	}
+
+private:
+
+	//first row of seedless DP over the whole graph, not allocated from a thread's arena since it is shared
+	typename FullStartSliceCache::Row getFullStartRow(char firstChar) const
+	{
+		typename FullStartSliceCache::Row result;
+		result.hasExactMatch = false;
+		result.exactMatchNode = 0;
+		result.scores.addEmptyNodeMap(params.graph.NodeSize(), nullptr);
 		for (size_t i = 0; i < params.graph.NodeSize(); i++)
 		{
-			startSlice.scores.addNodeToMap(i);
-			startSlice.scores.setMinScore(i, 0);
-			auto& node = startSlice.scores.node(i);
+			result.scores.addNodeToMap(i);
+			result.scores.setMinScore(i, 0);
+			auto& node = result.scores.node(i);
 			bool match = Common::characterMatch(firstChar, params.graph.NodeSequences(i, 0));
 			node.startSlice = {0, 0, match ? 0 : 1};
 			node.minScore = match ? 0 : 1;
@@ -112,35 +181,15 @@ public:
 			}
 			if (node.minScore == 0)
 			{
-				startSlice.maxExactEndposScore = 0;
-				startSlice.maxExactEndposNode = i;
+				result.hasExactMatch = true;
+				result.exactMatchNode = i;
 			}
 			node.endSlice = {0, 0, match ? 0 : 1};
 			node.exists = true;
 		}
-		std::string_view alignableSequence { originalSequence.data()+1, originalSequence.size() - 1 };
-		assert(alignableSequence.size() > 0);
-		size_t numSlices = (alignableSequence.size() + WordConfiguration<Word>::WordSize - 1) / WordConfiguration<Word>::WordSize;
-		auto slice = getSlices(alignableSequence, startSlice, numSlices, Xdropcutoff, reusableState);
-		if (slice.slices.size() <= 1)
-		{
-			return OnewayTrace::TraceFailed();
-		}
-
-		OnewayTrace result;
-		result = BV::getReverseTraceFromTableExactEndPos(params, alignableSequence, slice, reusableState, true, false);
-		for (size_t i = 0; i < result.trace.size(); i++)
-		{
-			result.trace[i].DPposition.seqPos += 1;
-		}
-		std::reverse(result.trace.begin(), result.trace.end());
-		result.trace[0].sequenceCharacter = originalSequence[0];
-		assert(result.trace[0].DPposition.seqPos == 0);
 		return result;
 	}
 
-private:
-
 	void removeDuplicateTraces(std::vector<OnewayTrace>& traces) const
 	{
 		if (traces.size() == 0) return;
@@ -168,7 +217,7 @@ private:
 
 #ifdef EXTRACORRECTNESSASSERTIONS
 	template <bool HasVectorMap, bool PreviousHasVectorMap>
-	void checkNodeBoundaryCorrectness(const NodeSlice<LengthType, ScoreType, Word, HasVectorMap>& currentSlice, const NodeSlice<LengthType, ScoreType, Word, PreviousHasVectorMap>& previousSlice, const std::string_view& sequence, size_t j, ScoreType maxScore, ScoreType previousMaxScore, const std::vector<bool>& hasSeedStart, const WordSlice seedstartSlice, const WordSlice fakeSlice) const
+	void checkNodeBoundaryCorrectness(const NodeSlice<LengthType, ScoreType, Word, HasVectorMap>& currentSlice, const NodeSlice<LengthType, ScoreType, Word, PreviousHasVectorMap>& previousSlice, const std::string_view& sequence, size_t j, ScoreType maxScore, ScoreType previousMaxScore, const EpochBitvector& hasSeedStart, const WordSlice seedstartSlice, const WordSlice fakeSlice) const
 	{
 		assert(previousMaxScore <= maxScore || seedstartSlice.getScoreBeforeStart() <= maxScore);
 		for (auto pair : currentSlice)
@@ -227,7 +276,7 @@ private:
 #endif
 
 	template <bool HasVectorMap, bool PreviousHasVectorMap, typename PriorityQueue>
-	void addSeedHitToScoresAndQueue(const SeedHit& seedHit, NodeSlice<LengthType, ScoreType, Word, HasVectorMap>& currentSlice, const NodeSlice<LengthType, ScoreType, Word, PreviousHasVectorMap>& previousSlice, std::vector<bool>& currentBand, const std::vector<bool>& previousBand, PriorityQueue& calculableQueue, const WordSlice extraSlice, phmap::flat_hash_map<size_t, ScoreType>& nodeMaxExactEndposScore, bool storeNodeExactEndposScores) const
+	void addSeedHitToScoresAndQueue(const SeedHit& seedHit, NodeSlice<LengthType, ScoreType, Word, HasVectorMap>& currentSlice, const NodeSlice<LengthType, ScoreType, Word, PreviousHasVectorMap>& previousSlice, EpochBitvector& currentBand, const EpochBitvector& previousBand, PriorityQueue& calculableQueue, const WordSlice extraSlice, phmap::flat_hash_map<size_t, ScoreType>& nodeMaxExactEndposScore, bool storeNodeExactEndposScores) const
 	{
 #ifdef SLICEVERBOSE
 		std::cerr << " " << seedHit.alignmentGraphNodeId << "(" << seedHit.nodeID << ")";
@@ -251,8 +300,64 @@ private:
 		}
 	}
 
+	template <typename PriorityQueue>
+	void queueOutNeighbors(PriorityQueue& calculableQueue, LengthType node, const WordSlice newEnd, const WordSlice oldEnd, ScoreType newEndMinScore, ScoreType previousMinScore, size_t j, double priorityMismatchPenalty, ScoreType zeroScore) const
+	{
+		for (auto neighbor : params.graph.outNeighbors[node])
+		{
+			if (calculableQueue.IsComponentPriorityQueue())
+			{
+				calculableQueue.insert(params.graph.componentNumber[neighbor], newEndMinScore, EdgeWithPriority { neighbor, newEndMinScore - previousMinScore, newEnd, false });
+			}
+			else
+			{
+				ScoreType newEndPriorityScore = newEnd.getChangedPriorityScore(oldEnd, j, priorityMismatchPenalty);
+				assert(newEndPriorityScore != std::numeric_limits<ScoreType>::max());
+				assert(newEndPriorityScore >= zeroScore);
+				calculableQueue.insert(newEndPriorityScore - zeroScore, EdgeWithPriority { neighbor, newEndMinScore - previousMinScore, newEnd, false });
+			}
+		}
+	}
+
+	//calculates one node of the band from its queued incoming edges, oldEnd is set to the end slice before the calculation
+	template <bool HasVectorMap, bool PreviousHasVectorMap>
+	NodeCalculationResult calculateBandNode(LengthType i, typename NodeSlice<LengthType, ScoreType, Word, HasVectorMap>::NodeSliceMapItem& thisNode, const NodeSlice<LengthType, ScoreType, Word, PreviousHasVectorMap>& previousSlice, const EpochBitvector& previousBand, const std::vector<EdgeWithPriority>& extras, const EqVector& EqV, const WordSlice extraSlice, size_t j, WordSlice& oldEnd) const
+	{
+		oldEnd = thisNode.endSlice;
+		if (!thisNode.exists) oldEnd = { 0, 0, std::numeric_limits<ScoreType>::max() };
+		if (extraSlice.scoreEnd != std::numeric_limits<ScoreType>::max()) oldEnd = oldEnd.mergeWith(extraSlice);
+		typename NodeSlice<LengthType, ScoreType, Word, HasVectorMap>::NodeSliceMapItem previousThisNode;
+
+		if (previousBand[i])
+		{
+			previousThisNode = previousSlice.node(i);
+			assert(previousThisNode.exists);
+		}
+		else
+		{
+			for (size_t chunk = 0; chunk < previousThisNode.NUM_CHUNKS; chunk++)
+			{
+				previousThisNode.HP[chunk] = WordConfiguration<Word>::AllOnes;
+				previousThisNode.HN[chunk] = WordConfiguration<Word>::AllZeros;
+			}
+			previousThisNode.exists = false;
+		}
+		NodeCalculationResult nodeCalc;
+		if (i < params.graph.firstAmbiguous)
+		{
+			nodeCalc = calculateNode(params, i, thisNode, EqV, previousThisNode, extras, previousBand, params.graph.NodeChunks(i), extraSlice, j);
+			assert(nodeCalc.maxExactEndposScore != std::numeric_limits<ScoreType>::min());
+		}
+		else
+		{
+			nodeCalc = calculateAmbiguousNode(params, i, thisNode, EqV, previousThisNode, extras, previousBand, params.graph.AmbiguousNodeChunks(i), extraSlice, j);
+			assert(nodeCalc.maxExactEndposScore != std::numeric_limits<ScoreType>::min());
+		}
+		return nodeCalc;
+	}
+
 	template <bool HasVectorMap, bool PreviousHasVectorMap, typename PriorityQueue>
-	NodeCalculationResult calculateSlice(const std::string_view& sequence, const size_t j, NodeSlice<LengthType, ScoreType, Word, HasVectorMap>& currentSlice, const NodeSlice<LengthType, ScoreType, Word, PreviousHasVectorMap>& previousSlice, std::vector<bool>& currentBand, const std::vector<bool>& previousBand, PriorityQueue& calculableQueue, ScoreType previousQuitScore, int bandwidth, ScoreType previousMinScore, const std::vector<SeedHit>& seedHits, size_t seedhitStart, size_t seedhitEnd, const WordSlice seedstartSlice, std::vector<bool>& hasSeedStart, std::unordered_set<size_t>& seedstartNodes, phmap::flat_hash_map<size_t, ScoreType>& nodeMaxExactEndposScore, bool storeNodeExactEndposScores) const
+	NodeCalculationResult calculateSlice(const std::string_view& sequence, const size_t j, NodeSlice<LengthType, ScoreType, Word, HasVectorMap>& currentSlice, const NodeSlice<LengthType, ScoreType, Word, PreviousHasVectorMap>& previousSlice, EpochBitvector& currentBand, const EpochBitvector& previousBand, PriorityQueue& calculableQueue, ScoreType previousQuitScore, int bandwidth, ScoreType previousMinScore, const std::vector<SeedHit>& seedHits, size_t seedhitStart, size_t seedhitEnd, const WordSlice seedstartSlice, EpochBitvector& hasSeedStart, std::unordered_set<size_t>& seedstartNodes, phmap::flat_hash_map<size_t, ScoreType>& nodeMaxExactEndposScore, bool storeNodeExactEndposScores, AlignerGraphsizedState& reusableState) const
 	{
 		if (previousMinScore == std::numeric_limits<ScoreType>::max() - bandwidth - 1)
 		{
@@ -368,61 +473,148 @@ private:
 
 		WordSlice fakeSlice { WordConfiguration<Word>::AllZeros, WordConfiguration<Word>::AllZeros, std::numeric_limits<ScoreType>::max() };
 		ScoreType currentMinScoreAtEndRow = result.minScore;
-		while (calculableQueue.size() > 0)
+		//the only successor of a node in a linearizable chain is calculated right after it instead of going through the queue
+		std::vector<EdgeWithPriority> chainIncoming;
+		LengthType chainNode = std::numeric_limits<LengthType>::max();
+		std::vector<LengthType> roundNodes;
+		std::vector<std::vector<EdgeWithPriority>> roundIncoming;
+		std::vector<NodeCalculationResult> roundCalcs;
+		std::vector<WordSlice> roundOldEnds;
+		while (calculableQueue.size() > 0 || chainNode != std::numeric_limits<LengthType>::max())
 		{
-			auto pair = calculableQueue.top();
-			if (!calculableQueue.IsComponentPriorityQueue())
-			{
-				if (pair.priority > currentMinScoreAtEndRow + bandwidth) break;
-			}
-			if (calculableQueue.extraSize(pair.target) == 0)
+			if (chainNode == std::numeric_limits<LengthType>::max() && reusableState.parallelBandMinNodes > 0 && calculableQueue.size() >= reusableState.parallelBandMinNodes)
 			{
-				calculableQueue.pop();
+				//dense tangle, calculate a round of queued nodes at once with the idle threads
+				//the outgoing edges are queued in round order afterwards so the slice doesn't depend on the number of threads
+				roundNodes.clear();
+				roundIncoming.clear();
+				if (calculableQueue.IsComponentPriorityQueue())
+				{
+					//the queued nodes of the lowest component, edges between them are propagated in the next round
+					size_t roundSize = calculableQueue.currentComponentSize();
+					for (size_t k = 0; k < roundSize; k++)
+					{
+						auto pair = calculableQueue.top();
+						roundNodes.push_back(pair.target);
+						roundIncoming.push_back(calculableQueue.getExtras(pair.target));
+						calculableQueue.pop();
+					}
+				}
+				else
+				{
+					while (calculableQueue.size() > 0)
+					{
+						auto pair = calculableQueue.top();
+						if (pair.priority > currentMinScoreAtEndRow + bandwidth) break;
+						if (calculableQueue.extraSize(pair.target) > 0)
+						{
+							roundNodes.push_back(pair.target);
+							roundIncoming.push_back(calculableQueue.getExtras(pair.target));
+							calculableQueue.removeExtras(pair.target);
+						}
+						calculableQueue.pop();
+					}
+					if (roundNodes.size() == 0) break;
+				}
+				for (auto node : roundNodes)
+				{
+					if (currentBand[node]) continue;
+					assert(!currentSlice.hasNode(node));
+					currentSlice.addNode(node);
+					currentBand[node] = true;
+				}
+				roundCalcs.resize(roundNodes.size());
+				roundOldEnds.resize(roundNodes.size());
+				size_t numChunks = 1;
+				if (reusableState.taskPool != nullptr) numChunks = std::min(roundNodes.size(), reusableState.taskPool->idleWorkers() + 1);
+				std::vector<std::function<void(AlignerGraphsizedState&)>> tasks;
+				for (size_t chunk = 0; chunk < numChunks; chunk++)
+				{
+					tasks.emplace_back([&, chunk, numChunks](AlignerGraphsizedState&)
+					{
+						for (size_t k = chunk; k < roundNodes.size(); k += numChunks)
+						{
+							LengthType node = roundNodes[k];
+							roundCalcs[k] = calculateBandNode<HasVectorMap, PreviousHasVectorMap>(node, currentSlice.node(node), previousSlice, previousBand, roundIncoming[k], EqV, hasSeedStart[node] ? seedstartSlice : fakeSlice, j, roundOldEnds[k]);
+						}
+					});
+				}
+				reusableState.runTasks(tasks);
+				for (size_t k = 0; k < roundNodes.size(); k++)
+				{
+					LengthType node = roundNodes[k];
+					const NodeCalculationResult& nodeCalc = roundCalcs[k];
+					if (storeNodeExactEndposScores)
+					{
+						nodeMaxExactEndposScore[node] = std::max(nodeCalc.maxExactEndposScore, nodeMaxExactEndposScore[node]);
+					}
+					assert(nodeCalc.minScore <= (ScoreType)j + bandwidth + (ScoreType)WordConfiguration<Word>::WordSize + (ScoreType)WordConfiguration<Word>::WordSize);
+					currentMinScoreAtEndRow = std::min(currentMinScoreAtEndRow, nodeCalc.minScore);
+					currentSlice.setMinScoreIfSmaller(node, nodeCalc.minScore);
+					auto newEnd = currentSlice.node(node).endSlice;
+					auto oldEnd = roundOldEnds[k];
+					if (newEnd.scoreEnd != oldEnd.scoreEnd || newEnd.VP != oldEnd.VP || newEnd.VN != oldEnd.VN)
+					{
+						ScoreType newEndMinScore = newEnd.changedMinScore(oldEnd);
+						assert(newEndMinScore != std::numeric_limits<ScoreType>::max());
+						if (newEndMinScore <= currentMinScoreAtEndRow + bandwidth)
+						{
+							queueOutNeighbors(calculableQueue, node, newEnd, oldEnd, newEndMinScore, previousMinScore, j, priorityMismatchPenalty, zeroScore);
+						}
+					}
+					if (nodeCalc.minScore < result.minScore)
+					{
+						result.minScore = nodeCalc.minScore;
+						result.minScoreNode = nodeCalc.minScoreNode;
+						result.minScoreNodeOffset = nodeCalc.minScoreNodeOffset;
+					}
+					if (nodeCalc.maxExactEndposScore > result.maxExactEndposScore)
+					{
+						result.maxExactEndposScore = nodeCalc.maxExactEndposScore;
+						result.maxExactEndposNode = nodeCalc.maxExactEndposNode;
+					}
+					assert(result.minScore == currentMinScoreAtEndRow);
+					result.cellsProcessed += nodeCalc.cellsProcessed;
+					assert(nodeCalc.cellsProcessed > 0);
+				}
+				if (result.cellsProcessed > params.maxCellsPerSlice) break;
 				continue;
 			}
-			auto i = pair.target;
-			if (!currentBand[i])
-			{
-				assert(!currentSlice.hasNode(i));
-				currentSlice.addNode(i);
-				currentBand[i] = true;
-			}
-			assert(currentBand[i]);
+			LengthType i;
 			const std::vector<EdgeWithPriority>* extras;
-			extras = &calculableQueue.getExtras(i);
-			auto& thisNode = currentSlice.node(i);
-			auto oldEnd = thisNode.endSlice;
-			if (!thisNode.exists) oldEnd = { 0, 0, std::numeric_limits<ScoreType>::max() };
-			WordSlice extraSlice = hasSeedStart[i] ? seedstartSlice : fakeSlice;
-			if (extraSlice.scoreEnd != std::numeric_limits<ScoreType>::max()) oldEnd = oldEnd.mergeWith(extraSlice);
-			typename NodeSlice<LengthType, ScoreType, Word, HasVectorMap>::NodeSliceMapItem previousThisNode;
-
-			if (previousBand[i])
-			{
-				previousThisNode = previousSlice.node(i);
-				assert(previousThisNode.exists);
-			}
-			else
+			bool fromQueue = chainNode == std::numeric_limits<LengthType>::max();
+			if (fromQueue)
 			{
-				for (size_t chunk = 0; chunk < previousThisNode.NUM_CHUNKS; chunk++)
+				auto pair = calculableQueue.top();
+				if (!calculableQueue.IsComponentPriorityQueue())
 				{
-					previousThisNode.HP[chunk] = WordConfiguration<Word>::AllOnes;
-					previousThisNode.HN[chunk] = WordConfiguration<Word>::AllZeros;
+					if (pair.priority > currentMinScoreAtEndRow + bandwidth) break;
 				}
-				previousThisNode.exists = false;
+				if (calculableQueue.extraSize(pair.target) == 0)
+				{
+					calculableQueue.pop();
+					continue;
+				}
+				i = pair.target;
+				extras = &calculableQueue.getExtras(i);
 			}
-			NodeCalculationResult nodeCalc;
-			if (i < params.graph.firstAmbiguous)
+			else
 			{
-				nodeCalc = BV::calculateNodeClipPrecise(params, i, thisNode, EqV, previousThisNode, *extras, previousBand, params.graph.NodeChunks(i), extraSlice, j);
-				assert(nodeCalc.maxExactEndposScore != std::numeric_limits<ScoreType>::min());
+				i = chainNode;
+				chainNode = std::numeric_limits<LengthType>::max();
+				extras = &chainIncoming;
 			}
-			else
+			if (!currentBand[i])
 			{
-				nodeCalc = BV::calculateNodeClipPrecise(params, i, thisNode, EqV, previousThisNode, *extras, previousBand, params.graph.AmbiguousNodeChunks(i), extraSlice, j);
-				assert(nodeCalc.maxExactEndposScore != std::numeric_limits<ScoreType>::min());
+				assert(!currentSlice.hasNode(i));
+				currentSlice.addNode(i);
+				currentBand[i] = true;
 			}
-			calculableQueue.pop();
+			assert(currentBand[i]);
+			auto& thisNode = currentSlice.node(i);
+			WordSlice oldEnd;
+			NodeCalculationResult nodeCalc = calculateBandNode<HasVectorMap, PreviousHasVectorMap>(i, thisNode, previousSlice, previousBand, *extras, EqV, hasSeedStart[i] ? seedstartSlice : fakeSlice, j, oldEnd);
+			if (fromQueue) calculableQueue.pop();
 			if (!calculableQueue.IsComponentPriorityQueue())
 			{
 				calculableQueue.removeExtras(i);
@@ -451,22 +643,28 @@ private:
 				ScoreType newEndMinScore = newEnd.changedMinScore(oldEnd);
 				// assert(newEndMinScore >= previousMinScore || newEndMinScore >= seedstartSlice.getScoreBeforeStart());
 				assert(newEndMinScore != std::numeric_limits<ScoreType>::max());
-				if (newEndMinScore <= currentMinScoreAtEndRow + bandwidth)
+				if (newEndMinScore <= currentMinScoreAtEndRow + bandwidth && !calculableQueue.IsComponentPriorityQueue() && params.graph.outNeighbors[i].size() == 1 && params.graph.linearizable[params.graph.outNeighbors[i][0]])
 				{
-					for (auto neighbor : params.graph.outNeighbors[i])
+					auto neighbor = params.graph.outNeighbors[i][0];
+					assert(params.graph.inNeighbors[neighbor].size() == 1);
+					ScoreType newEndPriorityScore = newEnd.getChangedPriorityScore(oldEnd, j, priorityMismatchPenalty);
+					assert(newEndPriorityScore != std::numeric_limits<ScoreType>::max());
+					assert(newEndPriorityScore >= zeroScore);
+					if (newEndPriorityScore - zeroScore <= currentMinScoreAtEndRow + bandwidth)
 					{
-						if (calculableQueue.IsComponentPriorityQueue())
-						{
-							calculableQueue.insert(params.graph.componentNumber[neighbor], newEndMinScore, EdgeWithPriority { neighbor, newEndMinScore - previousMinScore, newEnd, false });
-						}
-						else
-						{
-							ScoreType newEndPriorityScore = newEnd.getChangedPriorityScore(oldEnd, j, priorityMismatchPenalty);
-							assert(newEndPriorityScore != std::numeric_limits<ScoreType>::max());
-							assert(newEndPriorityScore >= zeroScore);
-							calculableQueue.insert(newEndPriorityScore - zeroScore, EdgeWithPriority { neighbor, newEndMinScore - previousMinScore, newEnd, false });
-						}
+						const auto& queued = calculableQueue.getExtras(neighbor);
+						chainIncoming.assign(queued.begin(), queued.end());
+						chainIncoming.emplace_back(neighbor, newEndMinScore - previousMinScore, newEnd, false);
+						chainNode = neighbor;
 					}
+					else
+					{
+						calculableQueue.insert(newEndPriorityScore - zeroScore, EdgeWithPriority { neighbor, newEndMinScore - previousMinScore, newEnd, false });
+					}
+				}
+				else if (newEndMinScore <= currentMinScoreAtEndRow + bandwidth)
+				{
+					queueOutNeighbors(calculableQueue, i, newEnd, oldEnd, newEndMinScore, previousMinScore, j, priorityMismatchPenalty, zeroScore);
 				}
 			}
 			if (nodeCalc.minScore < result.minScore)
@@ -511,7 +709,7 @@ private:
 	}
 
 	template <typename PriorityQueue>
-	void fillDPSlice(const std::string_view& sequence, DPSlice& slice, const DPSlice& previousSlice, const std::vector<bool>& previousBand, std::vector<bool>& currentBand, PriorityQueue& calculableQueue, int bandwidth, const std::vector<SeedHit>& seedHits, size_t seedhitStart, size_t seedhitEnd, const WordSlice extraSlice, std::vector<bool>& hasSeedStart, bool storeNodeExactEndposScores) const
+	void fillDPSlice(const std::string_view& sequence, DPSlice& slice, const DPSlice& previousSlice, const EpochBitvector& previousBand, EpochBitvector& currentBand, PriorityQueue& calculableQueue, int bandwidth, const std::vector<SeedHit>& seedHits, size_t seedhitStart, size_t seedhitEnd, const WordSlice extraSlice, EpochBitvector& hasSeedStart, bool storeNodeExactEndposScores, AlignerGraphsizedState& reusableState) const
 	{
 		NodeCalculationResult sliceResult;
 		assert((ScoreType)previousSlice.bandwidth < std::numeric_limits<ScoreType>::max());
@@ -521,18 +719,18 @@ private:
 		{
 			if (previousSlice.scoresVectorMap.hasVectorMapCurrently())
 			{
-				sliceResult = calculateSlice<true, true>(sequence, slice.j, slice.scoresVectorMap, previousSlice.scoresVectorMap, currentBand, previousBand, calculableQueue, previousSlice.minScore + previousSlice.bandwidth, bandwidth, previousSlice.minScore, seedHits, seedhitStart, seedhitEnd, extraSlice, hasSeedStart, slice.seedstartNodes, slice.nodeMaxExactEndposScore, storeNodeExactEndposScores);
+				sliceResult = calculateSlice<true, true>(sequence, slice.j, slice.scoresVectorMap, previousSlice.scoresVectorMap, currentBand, previousBand, calculableQueue, previousSlice.minScore + previousSlice.bandwidth, bandwidth, previousSlice.minScore, seedHits, seedhitStart, seedhitEnd, extraSlice, hasSeedStart, slice.seedstartNodes, slice.nodeMaxExactEndposScore, storeNodeExactEndposScores, reusableState);
 			}
 			else
 			{
-				sliceResult = calculateSlice<true, false>(sequence, slice.j, slice.scoresVectorMap, previousSlice.scores, currentBand, previousBand, calculableQueue, previousSlice.minScore + previousSlice.bandwidth, bandwidth, previousSlice.minScore, seedHits, seedhitStart, seedhitEnd, extraSlice, hasSeedStart, slice.seedstartNodes, slice.nodeMaxExactEndposScore, storeNodeExactEndposScores);
+				sliceResult = calculateSlice<true, false>(sequence, slice.j, slice.scoresVectorMap, previousSlice.scores, currentBand, previousBand, calculableQueue, previousSlice.minScore + previousSlice.bandwidth, bandwidth, previousSlice.minScore, seedHits, seedhitStart, seedhitEnd, extraSlice, hasSeedStart, slice.seedstartNodes, slice.nodeMaxExactEndposScore, storeNodeExactEndposScores, reusableState);
 			}
 			slice.scores = slice.scoresVectorMap.getMapSlice();
 		}
 		else
 		{
 			assert(!previousSlice.scoresVectorMap.hasVectorMapCurrently());
-			sliceResult = calculateSlice<false, false>(sequence, slice.j, slice.scores, previousSlice.scores, currentBand, previousBand, calculableQueue, previousSlice.minScore + previousSlice.bandwidth, bandwidth, previousSlice.minScore, seedHits, seedhitStart, seedhitEnd, extraSlice, hasSeedStart, slice.seedstartNodes, slice.nodeMaxExactEndposScore, storeNodeExactEndposScores);
+			sliceResult = calculateSlice<false, false>(sequence, slice.j, slice.scores, previousSlice.scores, currentBand, previousBand, calculableQueue, previousSlice.minScore + previousSlice.bandwidth, bandwidth, previousSlice.minScore, seedHits, seedhitStart, seedhitEnd, extraSlice, hasSeedStart, slice.seedstartNodes, slice.nodeMaxExactEndposScore, storeNodeExactEndposScores, reusableState);
 		}
 		slice.cellsProcessed = sliceResult.cellsProcessed;
 		slice.minScoreNode = sliceResult.minScoreNode;
@@ -563,26 +761,32 @@ private:
 	}
 
 	template <typename PriorityQueue>
-	DPSlice pickMethodAndExtendFill(const std::string_view& sequence, const DPSlice& previous, const std::vector<bool>& previousBand, std::vector<bool>& currentBand, PriorityQueue& calculableQueue, int bandwidth, const std::vector<SeedHit>& seedHits, size_t seedhitStart, size_t seedhitEnd, const WordSlice extraSlice, std::vector<bool>& hasSeedStart, bool storeNodeExactEndposScores) const
+	DPSlice pickMethodAndExtendFill(const std::string_view& sequence, const DPSlice& previous, const EpochBitvector& previousBand, EpochBitvector& currentBand, PriorityQueue& calculableQueue, int bandwidth, const std::vector<SeedHit>& seedHits, size_t seedhitStart, size_t seedhitEnd, const WordSlice extraSlice, EpochBitvector& hasSeedStart, bool storeNodeExactEndposScores, AlignerGraphsizedState& reusableState) const
 	{
 		DPSlice bandTest;
-		bandTest.scores.addEmptyNodeMap(previous.scores.size());
+		bandTest.scores.addEmptyNodeMap(previous.scores.size(), previous.scores.getArena());
 		bandTest.j = previous.j + WordConfiguration<Word>::WordSize;
-		fillDPSlice(sequence, bandTest, previous, previousBand, currentBand, calculableQueue, bandwidth, seedHits, seedhitStart, seedhitEnd, extraSlice, hasSeedStart, storeNodeExactEndposScores);
+		fillDPSlice(sequence, bandTest, previous, previousBand, currentBand, calculableQueue, bandwidth, seedHits, seedhitStart, seedhitEnd, extraSlice, hasSeedStart, storeNodeExactEndposScores, reusableState);
 		return bandTest;
 	}
 
-	DPTable getSlices(const std::string_view& sequence, const DPSlice& initialSlice, size_t numSlices, int Xdropcutoff, AlignerGraphsizedState& reusableState) const
+	DPTable getSlices(const std::string_view& sequence, const DPSlice& initialSlice, size_t numSlices, int Xdropcutoff, bool scoreOnly, AlignerGraphsizedState& reusableState) const
 	{
-		return getXdropSlices(sequence, initialSlice, numSlices, Xdropcutoff, reusableState);
+		return getXdropSlices(sequence, initialSlice, numSlices, Xdropcutoff, scoreOnly, reusableState);
 	}
 
-	DPTable getXdropSlices(const std::string_view& sequence, const DPSlice& initialSlice, size_t numSlices, double Xdropcutoff, AlignerGraphsizedState& reusableState) const
+	//with scoreOnly the table keeps only the metadata and exact end position of each slice, and can't be backtraced
+	DPTable getXdropSlices(const std::string_view& sequence, const DPSlice& initialSlice, size_t numSlices, double Xdropcutoff, bool scoreOnly, AlignerGraphsizedState& reusableState) const
 	{
 		assert(initialSlice.j == (size_t)-WordConfiguration<Word>::WordSize);
 		assert(initialSlice.j + numSlices * WordConfiguration<Word>::WordSize <= sequence.size() + WordConfiguration<Word>::WordSize);
 		DPTable result;
 		result.slices.reserve(numSlices + 1);
+		if (params.DPCheckpointInterval > 1 && !scoreOnly)
+		{
+			result.checkpointInterval = params.DPCheckpointInterval;
+			result.recalculate = [this, sequence, &reusableState](std::vector<DPSlice>& slices, size_t start, size_t end) { recalculateSlices(sequence, slices, start, end, reusableState); };
+		}
 		size_t cellsProcessed = 0;
 		std::vector<size_t> partOfComponent;
 		{
@@ -606,9 +810,13 @@ private:
 #endif
 		std::vector<SeedHit> fakeSeeds;
 		WordSlice fakeSlice { WordConfiguration<Word>::AllZeros, WordConfiguration<Word>::AllZeros, std::numeric_limits<ScoreType>::max() };
-		for (size_t slice = 0; slice < numSlices; slice++)
+		const bool ramp = params.rampBandwidth > params.alignmentBandwidth;
+		size_t rampUntil = 0;
+		std::deque<DPSlice> rampHistory;
+		size_t slice = 0;
+		while (slice < numSlices)
 		{
-			int bandwidth = params.alignmentBandwidth;
+			int bandwidth = slice < rampUntil ? params.rampBandwidth : params.alignmentBandwidth;
 #ifndef NDEBUG
 			debugLastProcessedSlice = slice;
 			debugLastRowMinScore = lastSlice.minScore;
@@ -619,11 +827,11 @@ private:
 			DPSlice newSlice;
 			if (reusableState.componentQueue.valid())
 			{
-				newSlice = pickMethodAndExtendFill(sequence, lastSlice, reusableState.previousBand, reusableState.currentBand, reusableState.componentQueue, bandwidth, fakeSeeds, std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::max(), fakeSlice, reusableState.hasSeedStart, false);
+				newSlice = pickMethodAndExtendFill(sequence, lastSlice, reusableState.previousBand, reusableState.currentBand, reusableState.componentQueue, bandwidth, fakeSeeds, std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::max(), fakeSlice, reusableState.hasSeedStart, false, reusableState);
 			}
 			else
 			{
-				newSlice = pickMethodAndExtendFill(sequence, lastSlice, reusableState.previousBand, reusableState.currentBand, reusableState.calculableQueue, bandwidth, fakeSeeds, std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::max(), fakeSlice, reusableState.hasSeedStart, false);
+				newSlice = pickMethodAndExtendFill(sequence, lastSlice, reusableState.previousBand, reusableState.currentBand, reusableState.calculableQueue, bandwidth, fakeSeeds, std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::max(), fakeSlice, reusableState.hasSeedStart, false, reusableState);
 			}
 #ifdef SLICEVERBOSE
 			auto timeEnd = std::chrono::system_clock::now();
@@ -636,19 +844,48 @@ private:
 			assert(newSlice.scores.hasNode(newSlice.minScoreNode));
 			assert(newSlice.minScoreNodeOffset < params.graph.NodeLength(newSlice.minScoreNode));
 			assert(newSlice.maxExactEndposScore != std::numeric_limits<ScoreType>::min());
-
-			if (newSlice.maxExactEndposScore > bestXScore) bestXScore = newSlice.maxExactEndposScore;
-
 			assert(newSlice.j == lastSlice.j + WordConfiguration<Word>::WordSize);
 
 			cellsProcessed += newSlice.cellsProcessed;
+			bool outOfBudget = !reusableState.budget.spend(newSlice.cellsProcessed);
+
+			if (ramp && !outOfBudget && slice >= rampUntil && newSlice.minScore > lastSlice.minScore + RampScoreJump)
+			{
+				// the narrow band lost the alignment somewhere in the last few slices
+				// rewind and redo the bad region with the ramp bandwidth
+				size_t rewind = rampHistory.size();
+#ifdef SLICEVERBOSE
+				std::cerr << " ramp, rewind " << rewind << std::endl;
+#endif
+				reusableState.previousBand.clear();
+				reusableState.currentBand.clear();
+				lastSlice.scoresVectorMap.removeVectorArray();
+				newSlice.scoresVectorMap.removeVectorArray();
+				if (rewind > 0) lastSlice = std::move(rampHistory.front());
+				rampHistory.clear();
+				for (auto node : lastSlice.scores)
+				{
+					reusableState.previousBand[node.first] = true;
+				}
+				result.slices.erase(result.slices.begin() + (slice + 1 - rewind), result.slices.end());
+				bestXScore = std::numeric_limits<ScoreType>::min();
+				for (const auto& kept : result.slices)
+				{
+					bestXScore = std::max(bestXScore, kept.maxExactEndposScore);
+				}
+				rampUntil = slice + RampRewindSlices + 1;
+				slice -= rewind;
+				continue;
+			}
+
+			if (newSlice.maxExactEndposScore > bestXScore) bestXScore = newSlice.maxExactEndposScore;
 
 			if (newSlice.cellsProcessed >= params.maxCellsPerSlice)
 			{
 				newSlice.scoresNotValid = true;
 			}
 
-			if (newSlice.maxExactEndposScore < bestXScore - Xdropcutoff)
+			if (outOfBudget || newSlice.maxExactEndposScore < bestXScore - Xdropcutoff)
 			{
 #ifndef NDEBUG
 				debugLastProcessedSlice = slice-1;
@@ -672,7 +909,27 @@ private:
 			std::cerr << std::endl;
 #endif
 
-			result.slices.push_back(newSlice.getMapSlice());
+			if (scoreOnly)
+			{
+				result.slices.push_back(newSlice.getMetadataSlice());
+				auto end = BV::getExactEndPos(params, sequence, newSlice, BV::getNodeOrEmpty(lastSlice, newSlice.maxExactEndposNode), true, false);
+				result.slices.back().exactEndPos = end.first;
+				result.slices.back().exactEndScore = end.second;
+			}
+			else if (result.checkpointInterval == 0)
+			{
+				result.slices.push_back(newSlice.takeMapSlice());
+				result.slices.back().scores.pack();
+			}
+			else if (result.slices.size() % result.checkpointInterval == 0)
+			{
+				// checkpoints are recalculated from so they keep the map and its iteration order
+				result.slices.push_back(newSlice.takeMapSlice());
+			}
+			else
+			{
+				result.slices.push_back(newSlice.getMetadataSlice());
+			}
 			for (auto node : lastSlice.scores)
 			{
 				assert(reusableState.previousBand[node.first]);
@@ -693,7 +950,15 @@ private:
 				std::swap(reusableState.previousBand, reusableState.currentBand);
 			}
 			lastSlice.scoresVectorMap.removeVectorArray();
+			if (ramp)
+			{
+				// the maps are shared with the table so remembering a few slices is cheap
+				rampHistory.push_back(lastSlice.getMetadataSlice());
+				rampHistory.back().scores = lastSlice.scores;
+				if (rampHistory.size() > RampRewindSlices) rampHistory.pop_front();
+			}
 			lastSlice = std::move(newSlice);
+			slice++;
 		}
 		lastSlice.scoresVectorMap.removeVectorArray();
 
@@ -701,11 +966,8 @@ private:
 
 #ifdef EXTRACORRECTNESSASSERTIONS
 		assert(reusableState.calculableQueue.size() == 0);
-		for (size_t i = 0; i < reusableState.currentBand.size(); i++)
-		{
-			assert(!reusableState.currentBand[i]);
-			assert(!reusableState.previousBand[i]);
-		}
+		assert(reusableState.currentBand.none());
+		assert(reusableState.previousBand.none());
 #endif
 
 #ifndef NDEBUG
@@ -724,6 +986,47 @@ private:
 		return result;
 	}
 
+	// recalculates the scores of slices (start, end) from the checkpoint at start
+	void recalculateSlices(const std::string_view& sequence, std::vector<DPSlice>& slices, size_t start, size_t end, AlignerGraphsizedState& reusableState) const
+	{
+		assert(start < end);
+		assert(end <= slices.size());
+		std::vector<SeedHit> fakeSeeds;
+		WordSlice fakeSlice { WordConfiguration<Word>::AllZeros, WordConfiguration<Word>::AllZeros, std::numeric_limits<ScoreType>::max() };
+		for (auto node : slices[start].scores)
+		{
+			assert(!reusableState.previousBand[node.first]);
+			reusableState.previousBand[node.first] = true;
+		}
+		for (size_t i = start+1; i < end; i++)
+		{
+			DPSlice newSlice;
+			if (reusableState.componentQueue.valid())
+			{
+				newSlice = pickMethodAndExtendFill(sequence, slices[i-1], reusableState.previousBand, reusableState.currentBand, reusableState.componentQueue, slices[i].bandwidth, fakeSeeds, std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::max(), fakeSlice, reusableState.hasSeedStart, false, reusableState);
+			}
+			else
+			{
+				newSlice = pickMethodAndExtendFill(sequence, slices[i-1], reusableState.previousBand, reusableState.currentBand, reusableState.calculableQueue, slices[i].bandwidth, fakeSeeds, std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::max(), fakeSlice, reusableState.hasSeedStart, false, reusableState);
+			}
+			assert(newSlice.j == slices[i].j);
+			assert(newSlice.minScore == slices[i].minScore);
+			assert(newSlice.maxExactEndposScore == slices[i].maxExactEndposScore);
+			for (auto node : slices[i-1].scores)
+			{
+				assert(reusableState.previousBand[node.first]);
+				reusableState.previousBand[node.first] = false;
+			}
+			std::swap(reusableState.previousBand, reusableState.currentBand);
+			slices[i].scores = std::move(newSlice.scores);
+		}
+		for (auto node : slices[end-1].scores)
+		{
+			assert(reusableState.previousBand[node.first]);
+			reusableState.previousBand[node.first] = false;
+		}
+	}
+
 	DPTable getMultiseedSlices(const std::string_view& sequence, const DPSlice& initialSlice, size_t numSlices, AlignerGraphsizedState& reusableState, const std::vector<SeedHit>& seedHits) const
 	{
 		assert(reusableState.componentQueue.valid());
@@ -753,7 +1056,7 @@ private:
 			WordSlice seedSlice = BV::getSeedSlice(seqOffset, sequence.size(), params);
 			assert(seedSlice.maxXScore(seqOffset, params.XscoreErrorCost) >= -(ScoreType)WordConfiguration<Word>::WordSize*100);
 			assert(seedSlice.maxXScore(seqOffset, params.XscoreErrorCost) <= (ScoreType)WordConfiguration<Word>::WordSize*100);
-			DPSlice newSlice = pickMethodAndExtendFill(sequence, lastSlice, reusableState.previousBand, reusableState.currentBand, reusableState.componentQueue, bandwidth, seedHits, lastSeedHit, nextSeedHit, seedSlice, reusableState.hasSeedStart, true);
+			DPSlice newSlice = pickMethodAndExtendFill(sequence, lastSlice, reusableState.previousBand, reusableState.currentBand, reusableState.componentQueue, bandwidth, seedHits, lastSeedHit, nextSeedHit, seedSlice, reusableState.hasSeedStart, true, reusableState);
 			lastSeedHit = nextSeedHit;
 #ifdef SLICEVERBOSE
 			auto timeEnd = std::chrono::system_clock::now();
@@ -774,7 +1077,26 @@ private:
 			std::cerr << std::endl;
 #endif
 
-			result.slices.push_back(newSlice.getMapSlice());
+			if (!reusableState.budget.spend(newSlice.cellsProcessed))
+			{
+				// out of budget, keep the slices so far and trace from them
+				for (auto node : lastSlice.scores)
+				{
+					assert(reusableState.previousBand[node.first]);
+					reusableState.previousBand[node.first] = false;
+				}
+				for (auto node : newSlice.scores)
+				{
+					assert(reusableState.currentBand[node.first]);
+					reusableState.currentBand[node.first] = false;
+				}
+				lastSlice.scoresVectorMap.removeVectorArray();
+				newSlice.scoresVectorMap.removeVectorArray();
+				break;
+			}
+
+			// not packed, the local maxima scan picks between equal scores by the map's iteration order
+			result.slices.push_back(newSlice.takeMapSlice());
 			for (auto node : lastSlice.scores)
 			{
 				assert(reusableState.previousBand[node.first]);
@@ -795,18 +1117,15 @@ private:
 			lastSlice.scoresVectorMap.removeVectorArray();
 			lastSlice = std::move(newSlice);
 		}
-		assert(lastSeedHit == seedHits.size());
+		assert(lastSeedHit == seedHits.size() || reusableState.budget.stoppedWork());
 		lastSlice.scoresVectorMap.removeVectorArray();
 
-		assert(result.slices.size() == numSlices + 1);
+		assert(result.slices.size() == numSlices + 1 || reusableState.budget.stoppedWork());
 
 #ifdef EXTRACORRECTNESSASSERTIONS
 		assert(reusableState.calculableQueue.size() == 0);
-		for (size_t i = 0; i < reusableState.currentBand.size(); i++)
-		{
-			assert(!reusableState.currentBand[i]);
-			assert(!reusableState.previousBand[i]);
-		}
+		assert(reusableState.currentBand.none());
+		assert(reusableState.previousBand.none());
 #endif
 
 #ifndef NDEBUG
@@ -143,6 +143,8 @@ public:
 		minScoreNodeOffset(std::numeric_limits<LengthType>::max()),
 		maxExactEndposScore(std::numeric_limits<ScoreType>::min()),
 		maxExactEndposNode(std::numeric_limits<LengthType>::max()),
+		exactEndPos(0, 0, 0),
+		exactEndScore(std::numeric_limits<ScoreType>::max()),
 		scoresVectorMap(),
 		scores(),
 		j(std::numeric_limits<LengthType>::max()),
@@ -161,6 +163,8 @@ public:
 		minScoreNodeOffset(std::numeric_limits<LengthType>::max()),
 		maxExactEndposScore(std::numeric_limits<ScoreType>::min()),
 		maxExactEndposNode(std::numeric_limits<LengthType>::max()),
+		exactEndPos(0, 0, 0),
+		exactEndScore(std::numeric_limits<ScoreType>::max()),
 		scoresVectorMap(vectorMap),
 		scores(),
 		j(std::numeric_limits<LengthType>::max()),
@@ -177,6 +181,9 @@ public:
 		LengthType minScoreNodeOffset;
 		ScoreType maxExactEndposScore;
 		LengthType maxExactEndposNode;
+		//cell and score of the exact end position, only set when the slice was calculated in score-only mode
+		MatrixPosition exactEndPos;
+		ScoreType exactEndScore;
 		NodeSlice<LengthType, ScoreType, Word, true> scoresVectorMap;
 		NodeSlice<LengthType, ScoreType, Word, false> scores;
 		LengthType j;
@@ -189,7 +196,18 @@ public:
 		size_t nodesProcessed;
 		size_t numCells;
 #endif
-		DPSlice getMapSlice() const
+		//the score map is shared, the per-node side tables are moved out since only the table needs them
+		DPSlice takeMapSlice()
+		{
+			DPSlice result = getMetadataSlice();
+			result.scores = scores;
+			result.seedstartNodes = std::move(seedstartNodes);
+			result.nodeMaxExactEndposScore = std::move(nodeMaxExactEndposScore);
+			seedstartNodes.clear();
+			nodeMaxExactEndposScore.clear();
+			return result;
+		}
+		DPSlice getMetadataSlice() const
 		{
 			DPSlice result;
 			result.minScore = minScore;
@@ -197,13 +215,12 @@ public:
 			result.minScoreNodeOffset = minScoreNodeOffset;
 			result.maxExactEndposNode = maxExactEndposNode;
 			result.maxExactEndposScore = maxExactEndposScore;
-			result.scores = scores;
+			result.exactEndPos = exactEndPos;
+			result.exactEndScore = exactEndScore;
 			result.j = j;
 			result.cellsProcessed = cellsProcessed;
 			result.bandwidth = bandwidth;
 			result.scoresNotValid = scoresNotValid;
-			result.seedstartNodes = seedstartNodes;
-			result.nodeMaxExactEndposScore = nodeMaxExactEndposScore;
 #ifdef SLICEVERBOSE
 			result.nodesProcessed = nodesProcessed;
 			result.numCells = numCells;
@@ -215,9 +232,40 @@ public:
 	{
 	public:
 		DPTable() :
-		slices()
+		slices(),
+		checkpointInterval(0),
+		recalculate(),
+		restoredBlock(std::numeric_limits<size_t>::max())
 		{}
-		std::vector<DPSlice> slices;
+		// with checkpointing only every checkpointInterval'th slice keeps its scores
+		// and the rest are recalculated one block at a time when needed
+		// metadata (min scores, x-scores etc) is always kept for every slice
+		const DPSlice& getSlice(size_t index) const
+		{
+			assert(index < slices.size());
+			if (checkpointInterval == 0 || index % checkpointInterval == 0) return slices[index];
+			size_t block = index / checkpointInterval;
+			if (block != restoredBlock)
+			{
+				if (restoredBlock != std::numeric_limits<size_t>::max()) forgetBlock(restoredBlock);
+				assert(recalculate);
+				recalculate(slices, block * checkpointInterval, std::min(slices.size(), (block + 1) * checkpointInterval));
+				restoredBlock = block;
+			}
+			return slices[index];
+		}
+		mutable std::vector<DPSlice> slices;
+		size_t checkpointInterval;
+		std::function<void(std::vector<DPSlice>&, size_t, size_t)> recalculate;
+	private:
+		void forgetBlock(size_t block) const
+		{
+			for (size_t i = block * checkpointInterval + 1; i < slices.size() && i < (block + 1) * checkpointInterval; i++)
+			{
+				slices[i].scores = NodeSlice<LengthType, ScoreType, Word, false>{};
+			}
+		}
+		mutable size_t restoredBlock;
 	};
 	class NodeCalculationResult
 	{
@@ -261,6 +309,60 @@ public:
 		return std::make_tuple(slice, Ph, Mh);
 	}
 
+	//number of independent column words advanced together, 4 x 64 bits fills one AVX2 register
+	static constexpr size_t SliceLanes = 4;
+
+	//same as getNextSlice but for SliceLanes independent slices with a shared Eq
+#ifdef NDEBUG
+	__attribute__((always_inline))
+#endif
+	static inline void getNextSlices(Word Eq, WordSlice* slices, const Word* hinP, const Word* hinN)
+	{
+		Word laneEq[SliceLanes];
+		for (size_t lane = 0; lane < SliceLanes; lane++)
+		{
+			laneEq[lane] = Eq;
+		}
+		getNextSlices(laneEq, slices, hinP, hinN);
+	}
+
+	//same as getNextSlice but for SliceLanes independent slices, each with its own Eq
+	//uses gcc vector extensions so it compiles to AVX2 / SSE2 / scalar depending on the target
+#ifdef NDEBUG
+	__attribute__((always_inline))
+#endif
+	static inline void getNextSlices(const Word* Eq, WordSlice* slices, const Word* hinP, const Word* hinN)
+	{
+		typedef Word LaneWord __attribute__((vector_size(sizeof(Word) * SliceLanes)));
+		LaneWord EqL, VP, VN, HP, HN;
+		for (size_t lane = 0; lane < SliceLanes; lane++)
+		{
+			EqL[lane] = Eq[lane];
+			VP[lane] = slices[lane].VP;
+			VN[lane] = slices[lane].VN;
+			HP[lane] = hinP[lane];
+			HN[lane] = hinN[lane];
+		}
+		LaneWord EqH = EqL | HN;
+		LaneWord Xv = EqL | VN;
+		LaneWord Xh = (((EqH & VP) + VP) ^ VP) | EqH;
+		LaneWord Ph = VN | ~(Xh | VP);
+		LaneWord Mh = VP & Xh;
+		LaneWord tempMh = (Mh << 1) | HN;
+		LaneWord tempPh = (Ph << 1) | HP;
+		VP = tempMh | ~(Xv | tempPh);
+		VN = tempPh & Xv;
+		Ph >>= WordConfiguration<Word>::WordSize-1;
+		Mh >>= WordConfiguration<Word>::WordSize-1;
+		for (size_t lane = 0; lane < SliceLanes; lane++)
+		{
+			slices[lane].VP = VP[lane];
+			slices[lane].VN = VN[lane];
+			slices[lane].scoreEnd -= Mh[lane];
+			slices[lane].scoreEnd += Ph[lane];
+		}
+	}
+
 	static WordSlice flattenWordSlice(WordSlice slice, size_t row)
 	{
 		Word mask = ~(WordConfiguration<Word>::AllOnes << row);
@@ -488,6 +590,8 @@ public:
 				{
 					sliceMaxScores[i] = std::max(sliceMaxScores[i], score);
 				}
+				// out of budget, keep the traces found so far
+				if (reusableState.budget.exhausted()) return result;
 			}
 		}
 		return result;
@@ -507,40 +611,35 @@ public:
 			}
 		}
 		auto node = slice.slices[bestIndex].maxExactEndposNode;
-		auto score = slice.slices[bestIndex].maxExactEndposScore;
-		typename NodeSlice<LengthType, ScoreType, Word, false>::NodeSliceMapItem previous;
-		if (slice.slices[bestIndex-1].scores.hasNode(node))
-		{
-			previous = slice.slices[bestIndex-1].scores.node(node);
-		}
-		else
-		{
-			for (size_t i = 0; i < previous.NUM_CHUNKS; i++)
-			{
-				previous.HP[i] = WordConfiguration<Word>::AllOnes;
-				previous.HN[i] = WordConfiguration<Word>::AllZeros;
-			}
-		}
+		auto previous = getNodeOrEmpty(slice.getSlice(bestIndex-1), node);
+		auto end = getExactEndPos(params, sequence, slice.getSlice(bestIndex), previous, sliceConsistency, multiseed);
+		return getReverseTraceFromTable(params, sequence, slice, reusableState, end.first, end.second, sliceConsistency, multiseed);
+	}
 
-		EqVector EqV = getEqVector(sequence, slice.slices[bestIndex].j);
+	//the cell where the slice's max x-score is reached and its score, previous is the end node's item in the previous slice
+	static std::pair<MatrixPosition, ScoreType> getExactEndPos(const Params& params, const std::string_view& sequence, const DPSlice& slice, const typename NodeSlice<LengthType, ScoreType, Word, false>::NodeSliceMapItem& previous, bool sliceConsistency, bool multiseed)
+	{
+		auto node = slice.maxExactEndposNode;
+		auto score = slice.maxExactEndposScore;
+		EqVector EqV = getEqVector(sequence, slice.j);
 		WordSlice fakeSlice { WordConfiguration<Word>::AllZeros, WordConfiguration<Word>::AllZeros, std::numeric_limits<ScoreType>::max() };
 		WordSlice seedstartSlice { WordConfiguration<Word>::AllZeros, WordConfiguration<Word>::AllZeros, std::numeric_limits<ScoreType>::max() };
-		if (multiseed) seedstartSlice = getSeedSlice(slice.slices[bestIndex].j, sequence.size(), params);
-		WordSlice extraSlice = slice.slices[bestIndex].seedstartNodes.count(node) == 1 ? seedstartSlice : fakeSlice;
-		std::vector<WordSlice> nodeSlices = recalcNodeWordslice(params, node, slice.slices[bestIndex].scores.node(node), EqV, previous, sliceConsistency, extraSlice, slice.slices[bestIndex].j);
+		if (multiseed) seedstartSlice = getSeedSlice(slice.j, sequence.size(), params);
+		WordSlice extraSlice = slice.seedstartNodes.count(node) == 1 ? seedstartSlice : fakeSlice;
+		std::vector<WordSlice> nodeSlices = recalcNodeWordslice(params, node, slice.scores.node(node), EqV, previous, sliceConsistency, extraSlice, slice.j);
 
 		size_t nodeOffset = std::numeric_limits<size_t>::max();
 		size_t bvOffset = std::numeric_limits<size_t>::max();
 		for (size_t i = 0; i < nodeSlices.size(); i++)
 		{
-			auto maxScore = nodeSlices[i].maxXScoreFirstSlices((ScoreType)slice.slices[bestIndex].j, params.XscoreErrorCost, std::min((size_t)WordConfiguration<Word>::WordSize, (size_t)(sequence.size() - slice.slices[bestIndex].j)));
+			auto maxScore = nodeSlices[i].maxXScoreFirstSlices((ScoreType)slice.j, params.XscoreErrorCost, std::min((size_t)WordConfiguration<Word>::WordSize, (size_t)(sequence.size() - slice.j)));
 			assert(maxScore <= score);
 			if (maxScore == score)
 			{
 				for (size_t off = WordConfiguration<Word>::WordSize-1; off < WordConfiguration<Word>::WordSize; off--)
 				{
-					if (slice.slices[bestIndex].j + off >= sequence.size()) continue;
-					auto scoreHere = nodeSlices[i].getXScore((ScoreType)slice.slices[bestIndex].j, off, params.XscoreErrorCost);
+					if (slice.j + off >= sequence.size()) continue;
+					auto scoreHere = nodeSlices[i].getXScore((ScoreType)slice.j, off, params.XscoreErrorCost);
 					assert(scoreHere <= score);
 					if (scoreHere == score)
 					{
@@ -555,10 +654,27 @@ public:
 		}
 		assert(nodeOffset != std::numeric_limits<size_t>::max());
 		assert(bvOffset != std::numeric_limits<size_t>::max());
-		assert(slice.slices[bestIndex].j + bvOffset < sequence.size());
-		ScoreType startScore = nodeSlices[nodeOffset].getValue(bvOffset);
-		MatrixPosition startPos { node, nodeOffset, slice.slices[bestIndex].j + bvOffset };
-		return getReverseTraceFromTable(params, sequence, slice, reusableState, startPos, startScore, sliceConsistency, multiseed);
+		assert(slice.j + bvOffset < sequence.size());
+		return std::make_pair(MatrixPosition { node, nodeOffset, slice.j + bvOffset }, nodeSlices[nodeOffset].getValue(bvOffset));
+	}
+
+	//the node's scores in the slice, or the scores of a node outside of the band
+	static typename NodeSlice<LengthType, ScoreType, Word, false>::NodeSliceMapItem getNodeOrEmpty(const DPSlice& slice, LengthType node)
+	{
+		typename NodeSlice<LengthType, ScoreType, Word, false>::NodeSliceMapItem result;
+		if (slice.scores.hasNode(node))
+		{
+			result = slice.scores.node(node);
+		}
+		else
+		{
+			for (size_t i = 0; i < result.NUM_CHUNKS; i++)
+			{
+				result.HP[i] = WordConfiguration<Word>::AllOnes;
+				result.HN[i] = WordConfiguration<Word>::AllZeros;
+			}
+		}
+		return result;
 	}
 
 	static OnewayTrace getReverseTraceFromTableStartLastRow(const Params& params, const std::string_view& sequence, const DPTable& slice, AlignerGraphsizedState& reusableState, bool sliceConsistency, bool multiseed)
@@ -595,12 +711,12 @@ public:
 				if (newSlice != currentSlice) EqV = getEqVector(sequence, slice.slices[newSlice].j);
 				currentSlice = newSlice;
 				currentNode = newNode;
-				assert(slice.slices[currentSlice].scores.hasNode(currentNode));
+				assert(slice.getSlice(currentSlice).scores.hasNode(currentNode));
 				assert(currentSlice > 0);
 				typename NodeSlice<LengthType, ScoreType, Word, false>::NodeSliceMapItem previous;
-				if (slice.slices[currentSlice-1].scores.hasNode(currentNode))
+				if (slice.getSlice(currentSlice-1).scores.hasNode(currentNode))
 				{
-					previous = slice.slices[currentSlice-1].scores.node(currentNode);
+					previous = slice.getSlice(currentSlice-1).scores.node(currentNode);
 				}
 				else
 				{
@@ -613,10 +729,10 @@ public:
 				extraSlice.VP = WordConfiguration<Word>::AllZeros;
 				extraSlice.VN = WordConfiguration<Word>::AllZeros;
 				extraSlice.scoreEnd = std::numeric_limits<ScoreType>::max();
-				if (slice.slices[currentSlice].seedstartNodes.count(currentNode) == 1) extraSlice = getSeedSlice(slice.slices[currentSlice].j, sequence.size(), params);
-				nodeSlices = recalcNodeWordslice(params, currentNode, slice.slices[currentSlice].scores.node(currentNode), EqV, previous, sliceConsistency, extraSlice, slice.slices[currentSlice].j);
+				if (slice.getSlice(currentSlice).seedstartNodes.count(currentNode) == 1) extraSlice = getSeedSlice(slice.slices[currentSlice].j, sequence.size(), params);
+				nodeSlices = recalcNodeWordslice(params, currentNode, slice.getSlice(currentSlice).scores.node(currentNode), EqV, previous, sliceConsistency, extraSlice, slice.slices[currentSlice].j);
 #ifdef SLICEVERBOSE
-				std::cerr << "j " << slice.slices[currentSlice].j << " firstbt-calc " << slice.slices[currentSlice].scores.node(currentNode).firstSlicesCalcedWhenCalced << " lastbt-calc " << slice.slices[currentSlice].scores.node(currentNode).slicesCalcedWhenCalced << std::endl;
+				std::cerr << "j " << slice.slices[currentSlice].j << " firstbt-calc " << slice.getSlice(currentSlice).scores.node(currentNode).firstSlicesCalcedWhenCalced << " lastbt-calc " << slice.getSlice(currentSlice).scores.node(currentNode).slicesCalcedWhenCalced << std::endl;
 #endif
 			}
 			assert(result.trace.back().DPposition.node == currentNode);
@@ -630,7 +746,7 @@ public:
 			lastScore = nodeSlices[result.trace.back().DPposition.nodeOffset].getValue(result.trace.back().DPposition.seqPos % WordConfiguration<Word>::WordSize);
 			if (result.trace.back().DPposition.seqPos % WordConfiguration<Word>::WordSize == 0 && result.trace.back().DPposition.nodeOffset == 0)
 			{
-				auto bt = pickBacktraceCorner(params, slice.slices[currentSlice].scores, slice.slices[currentSlice-1].scores, currentNode, slice.slices[currentSlice].j, sequence, slice.slices[currentSlice].minScore + slice.slices[currentSlice].bandwidth, slice.slices[currentSlice].scoresNotValid, slice.slices[currentSlice-1].minScore + slice.slices[currentSlice-1].bandwidth, slice.slices[currentSlice-1].scoresNotValid, extraSlice);
+				auto bt = pickBacktraceCorner(params, slice.getSlice(currentSlice).scores, slice.getSlice(currentSlice-1).scores, currentNode, slice.slices[currentSlice].j, sequence, slice.slices[currentSlice].minScore + slice.slices[currentSlice].bandwidth, slice.slices[currentSlice].scoresNotValid, slice.slices[currentSlice-1].minScore + slice.slices[currentSlice-1].bandwidth, slice.slices[currentSlice-1].scoresNotValid, extraSlice);
 				if (result.trace.size() > 0 && bt.first == result.trace.back().DPposition && !bt.second && nodeSlices[bt.first.nodeOffset].getValue(bt.first.seqPos % WordConfiguration<Word>::WordSize) == extraSlice.getValue(bt.first.seqPos % WordConfiguration<Word>::WordSize))
 				{
 					break;
@@ -647,7 +763,7 @@ public:
 			{
 				assert(currentSlice > 0);
 				assert(result.trace.back().DPposition.nodeOffset > 0);
-				if (!slice.slices[currentSlice-1].scores.hasNode(currentNode))
+				if (!slice.getSlice(currentSlice-1).scores.hasNode(currentNode))
 				{
 					for (size_t i = result.trace.back().DPposition.nodeOffset-1; i > 0; i--)
 					{
@@ -656,7 +772,7 @@ public:
 					result.trace.emplace_back(MatrixPosition {currentNode, 0, result.trace.back().DPposition.seqPos}, false, sequence, params.graph);
 					continue;
 				}
-				auto crossing = pickBacktraceVerticalCrossing(params, slice.slices[currentSlice].scores, slice.slices[currentSlice-1].scores, nodeSlices, slice.slices[currentSlice].j, currentNode, result.trace.back().DPposition, sequence, slice.slices[currentSlice].minScore + slice.slices[currentSlice].bandwidth, slice.slices[currentSlice].scoresNotValid, slice.slices[currentSlice-1].minScore + slice.slices[currentSlice-1].bandwidth, slice.slices[currentSlice-1].scoresNotValid, extraSlice);
+				auto crossing = pickBacktraceVerticalCrossing(params, slice.getSlice(currentSlice).scores, slice.getSlice(currentSlice-1).scores, nodeSlices, slice.slices[currentSlice].j, currentNode, result.trace.back().DPposition, sequence, slice.slices[currentSlice].minScore + slice.slices[currentSlice].bandwidth, slice.slices[currentSlice].scoresNotValid, slice.slices[currentSlice-1].minScore + slice.slices[currentSlice-1].bandwidth, slice.slices[currentSlice-1].scoresNotValid, extraSlice);
 				if (result.trace.size() > 0 && crossing.second.first.seqPos == result.trace.back().DPposition.seqPos && nodeSlices[crossing.second.first.nodeOffset].getValue(crossing.second.first.seqPos % WordConfiguration<Word>::WordSize) == extraSlice.getValue(crossing.second.first.seqPos % WordConfiguration<Word>::WordSize))
 				{
 					break;
@@ -681,7 +797,7 @@ public:
 			if (result.trace.back().DPposition.nodeOffset == 0)
 			{
 				assert(result.trace.back().DPposition.seqPos % WordConfiguration<Word>::WordSize != 0);
-				auto crossing = pickBacktraceHorizontalCrossing(params, slice.slices[currentSlice].scores, slice.slices[currentSlice-1].scores, slice.slices[currentSlice].j, currentNode, result.trace.back().DPposition, sequence, slice.slices[currentSlice].minScore + slice.slices[currentSlice].bandwidth, slice.slices[currentSlice].scoresNotValid, slice.slices[currentSlice-1].minScore + slice.slices[currentSlice-1].bandwidth, slice.slices[currentSlice-1].scoresNotValid, extraSlice);
+				auto crossing = pickBacktraceHorizontalCrossing(params, slice.getSlice(currentSlice).scores, slice.getSlice(currentSlice-1).scores, slice.slices[currentSlice].j, currentNode, result.trace.back().DPposition, sequence, slice.slices[currentSlice].minScore + slice.slices[currentSlice].bandwidth, slice.slices[currentSlice].scoresNotValid, slice.slices[currentSlice-1].minScore + slice.slices[currentSlice-1].bandwidth, slice.slices[currentSlice-1].scoresNotValid, extraSlice);
 				if (result.trace.size() > 0 && crossing.second.first.node == result.trace.back().DPposition.node && !crossing.second.second && nodeSlices[crossing.second.first.nodeOffset].getValue(crossing.second.first.seqPos % WordConfiguration<Word>::WordSize) == extraSlice.getValue(crossing.second.first.seqPos % WordConfiguration<Word>::WordSize))
 				{
 					break;
@@ -722,8 +838,8 @@ public:
 		{
 			if (multiseed) break;
 			assert(result.trace.back().DPposition.seqPos == (size_t)-1);
-			assert(slice.slices[0].scores.hasNode(result.trace.back().DPposition.node));
-			auto node = slice.slices[0].scores.node(result.trace.back().DPposition.node);
+			assert(slice.getSlice(0).scores.hasNode(result.trace.back().DPposition.node));
+			auto node = slice.getSlice(0).scores.node(result.trace.back().DPposition.node);
 			std::vector<ScoreType> beforeSliceScores;
 			beforeSliceScores.resize(params.graph.NodeLength(result.trace.back().DPposition.node));
 			beforeSliceScores[0] = node.startSlice.scoreEnd;
@@ -744,7 +860,7 @@ public:
 				bool found = false;
 				for (auto neighbor : params.graph.inNeighbors[result.trace.back().DPposition.node])
 				{
-					if (slice.slices[0].scores.hasNode(neighbor) && slice.slices[0].scores.node(neighbor).endSlice.getScoreBeforeStart() == beforeSliceScores[result.trace.back().DPposition.nodeOffset] - 1)
+					if (slice.getSlice(0).scores.hasNode(neighbor) && slice.getSlice(0).scores.node(neighbor).endSlice.getScoreBeforeStart() == beforeSliceScores[result.trace.back().DPposition.nodeOffset] - 1)
 					{
 						result.trace.emplace_back(MatrixPosition {neighbor, params.graph.NodeLength(neighbor)-1, result.trace.back().DPposition.seqPos}, true, sequence, params.graph);
 						found = true;
@@ -1105,11 +1221,49 @@ public:
 #ifdef NDEBUG
 	__attribute__((always_inline))
 #endif
-	static NodeCalculationResult calculateNodeClipPrecise(const Params& params, size_t i, typename NodeSlice<LengthType, ScoreType, Word, true>::NodeSliceMapItem& slice, const EqVector& EqV, typename NodeSlice<LengthType, ScoreType, Word, true>::NodeSliceMapItem previousSlice, const std::vector<EdgeWithPriority>& incoming, const std::vector<bool>& previousBand, NodeChunkType nodeChunks, const WordSlice extraSlice, ScoreType seqOffset)
+	static NodeCalculationResult calculateNodeClipPrecise(const Params& params, size_t i, typename NodeSlice<LengthType, ScoreType, Word, true>::NodeSliceMapItem& slice, const EqVector& EqV, typename NodeSlice<LengthType, ScoreType, Word, true>::NodeSliceMapItem previousSlice, const std::vector<EdgeWithPriority>& incoming, const EpochBitvector& previousBand, NodeChunkType nodeChunks, const WordSlice extraSlice, ScoreType seqOffset)
 	{
 		return calculateNodeInner<true>(params, i, slice, EqV, previousSlice, incoming, [&previousBand](size_t pos) { return previousBand[pos]; }, nodeChunks, extraSlice, [](const WordSlice& slice){}, seqOffset);
 	}
 
+	template <typename NodeChunkType>
+	using NodeCalculationFunction = NodeCalculationResult(*)(const Params&, size_t, typename NodeSlice<LengthType, ScoreType, Word, true>::NodeSliceMapItem&, const EqVector&, typename NodeSlice<LengthType, ScoreType, Word, true>::NodeSliceMapItem, const std::vector<EdgeWithPriority>&, const EpochBitvector&, NodeChunkType, const WordSlice, ScoreType);
+
+#if defined(__x86_64__)
+	//same as calculateNodeClipPrecise with the whole kernel inlined and compiled for popcnt / avx2
+	//popcount compiles to the popcnt instruction and getNextSlices to 256 bit vector operations
+	template <typename NodeChunkType>
+	__attribute__((target("popcnt"), flatten))
+	static NodeCalculationResult calculateNodeClipPrecisePopcnt(const Params& params, size_t i, typename NodeSlice<LengthType, ScoreType, Word, true>::NodeSliceMapItem& slice, const EqVector& EqV, typename NodeSlice<LengthType, ScoreType, Word, true>::NodeSliceMapItem previousSlice, const std::vector<EdgeWithPriority>& incoming, const EpochBitvector& previousBand, NodeChunkType nodeChunks, const WordSlice extraSlice, ScoreType seqOffset)
+	{
+		return calculateNodeInner<true>(params, i, slice, EqV, previousSlice, incoming, [&previousBand](size_t pos) { return previousBand[pos]; }, nodeChunks, extraSlice, [](const WordSlice& slice){}, seqOffset);
+	}
+
+	template <typename NodeChunkType>
+	__attribute__((target("popcnt,avx2"), flatten))
+	static NodeCalculationResult calculateNodeClipPreciseAVX2(const Params& params, size_t i, typename NodeSlice<LengthType, ScoreType, Word, true>::NodeSliceMapItem& slice, const EqVector& EqV, typename NodeSlice<LengthType, ScoreType, Word, true>::NodeSliceMapItem previousSlice, const std::vector<EdgeWithPriority>& incoming, const EpochBitvector& previousBand, NodeChunkType nodeChunks, const WordSlice extraSlice, ScoreType seqOffset)
+	{
+		return calculateNodeInner<true>(params, i, slice, EqV, previousSlice, incoming, [&previousBand](size_t pos) { return previousBand[pos]; }, nodeChunks, extraSlice, [](const WordSlice& slice){}, seqOffset);
+	}
+#endif
+
+	template <typename NodeChunkType>
+	static NodeCalculationFunction<NodeChunkType> selectNodeCalculation()
+	{
+#if defined(__x86_64__)
+		switch(CPUFeatures::Level)
+		{
+			case CPUFeatures::KernelLevel::AVX2:
+				return &calculateNodeClipPreciseAVX2<NodeChunkType>;
+			case CPUFeatures::KernelLevel::Popcnt:
+				return &calculateNodeClipPrecisePopcnt<NodeChunkType>;
+			default:
+				break;
+		}
+#endif
+		return &calculateNodeClipPrecise<NodeChunkType>;
+	}
+
 	template <bool AllowEarlyLeave, typename NodeChunkType, typename WordsliceCallback, typename ExistenceCheckFunction>
 #ifdef NDEBUG
 	__attribute__((always_inline))
@@ -1133,6 +1287,61 @@ public:
 		bool hasSkipless = false;
 		bool forceCalculation = false;
 
+		ScoreType compareHin = std::numeric_limits<ScoreType>::max();
+		if (previousSlice.exists)
+		{
+			compareHin = previousSlice.startSlice.scoreEnd;
+		}
+		if (extraSlice.scoreEnd != std::numeric_limits<ScoreType>::max())
+		{
+			compareHin = std::min(compareHin, extraSlice.getScoreBeforeStart());
+		}
+		//skipless incoming slices are independent of each other so advance them in lockstep
+		//merging is a cellwise minimum so the order of merges doesn't change the result
+		WordSlice laneSlices[SliceLanes];
+		Word laneHinP[SliceLanes];
+		Word laneHinN[SliceLanes];
+		size_t lanesUsed = 0;
+		auto flushLanes = [&]()
+		{
+			if (lanesUsed == 0) return;
+			if (lanesUsed == 1)
+			{
+				Word unusedHP, unusedHN;
+				std::tie(laneSlices[0], unusedHP, unusedHN) = getNextSlice(Eq, laneSlices[0], laneHinP[0], laneHinN[0]);
+			}
+			else
+			{
+				for (size_t lane = lanesUsed; lane < SliceLanes; lane++)
+				{
+					laneSlices[lane] = laneSlices[0];
+					laneHinP[lane] = laneHinP[0];
+					laneHinN[lane] = laneHinN[0];
+				}
+				getNextSlices(Eq, laneSlices, laneHinP, laneHinN);
+			}
+			for (size_t lane = 0; lane < lanesUsed; lane++)
+			{
+				WordSlice newWs = laneSlices[lane];
+				if (!previousSlice.exists || newWs.getScoreBeforeStart() < previousSlice.startSlice.scoreEnd)
+				{
+					newWs.VP &= WordConfiguration<Word>::AllOnes ^ 1;
+					newWs.VN |= 1;
+				}
+				// assert(newWs.getScoreBeforeStart() >= debugLastRowMinScore || newWs.getScoreBeforeStart() >= extraSlice.getScoreBeforeStart());
+				if (!hasWs)
+				{
+					ws = newWs;
+					hasWs = true;
+				}
+				else
+				{
+					ws = ws.mergeWith(newWs);
+				}
+			}
+			lanesUsed = 0;
+		};
+
 		for (auto inc : incoming)
 		{
 			result.cellsProcessed++;
@@ -1151,52 +1360,27 @@ public:
 				continue;
 			}
 			hasSkipless = true;
-			Word hinP;
-			Word hinN;
-			ScoreType compareHin = std::numeric_limits<ScoreType>::max();
-			if (previousSlice.exists)
-			{
-				compareHin = previousSlice.startSlice.scoreEnd;
-			}
-			if (extraSlice.scoreEnd != std::numeric_limits<ScoreType>::max())
-			{
-				compareHin = std::min(compareHin, extraSlice.getScoreBeforeStart());
-			}
 			ScoreType incomingScoreBeforeStart = inc.incoming.getScoreBeforeStart();
 			if (compareHin < incomingScoreBeforeStart)
 			{
-				hinP = 0;
-				hinN = 1;
+				laneHinP[lanesUsed] = 0;
+				laneHinN[lanesUsed] = 1;
 			}
 			else if (compareHin > incomingScoreBeforeStart)
 			{
-				hinP = 1;
-				hinN = 0;
-			}
-			else
-			{
-				hinP = 0;
-				hinN = 0;
-			}
-
-			WordSlice newWs;
-			std::tie(newWs, hinP, hinN) = getNextSlice(Eq, inc.incoming, hinP, hinN);
-			if (!previousSlice.exists || newWs.getScoreBeforeStart() < previousSlice.startSlice.scoreEnd)
-			{
-				newWs.VP &= WordConfiguration<Word>::AllOnes ^ 1;
-				newWs.VN |= 1;
-			}
-			// assert(newWs.getScoreBeforeStart() >= debugLastRowMinScore || newWs.getScoreBeforeStart() >= extraSlice.getScoreBeforeStart());
-			if (!hasWs)
-			{
-				ws = newWs;
-				hasWs = true;
+				laneHinP[lanesUsed] = 1;
+				laneHinN[lanesUsed] = 0;
 			}
 			else
 			{
-				ws = ws.mergeWith(newWs);
+				laneHinP[lanesUsed] = 0;
+				laneHinN[lanesUsed] = 0;
 			}
+			laneSlices[lanesUsed] = inc.incoming;
+			lanesUsed++;
+			if (lanesUsed == SliceLanes) flushLanes();
 		}
+		flushLanes();
 
 		assert(hasWs);
 
@@ -1538,23 +1722,23 @@ public:
 		assert(sliceCalc.minScoreNodeOffset < params.graph.NodeLength(sliceCalc.minScoreNode));
 	}
 
-	static DPSlice getInitialEmptySlice()
+	static DPSlice getInitialEmptySlice(SliceArena* arena)
 	{
 		DPSlice result;
 		result.j = -WordConfiguration<Word>::WordSize;
 		result.bandwidth = 1;
 		result.minScore = 0;
-		result.scores.addEmptyNodeMap(1);
+		result.scores.addEmptyNodeMap(1, arena);
 		return result;
 	}
 
-	static DPSlice getInitialSliceExactPosition(const Params& params, LengthType bigraphNodeId, size_t offset)
+	static DPSlice getInitialSliceExactPosition(const Params& params, LengthType bigraphNodeId, size_t offset, SliceArena* arena)
 	{
 		DPSlice result;
 		result.j = -WordConfiguration<Word>::WordSize;
 		result.bandwidth = 1;
 		result.minScore = 0;
-		result.scores.addEmptyNodeMap(1);
+		result.scores.addEmptyNodeMap(1, arena);
 		assert(offset < params.graph.originalNodeSize.at(bigraphNodeId));
 		size_t nodeIndex = params.graph.GetUnitigNode(bigraphNodeId, offset);
 		assert(params.graph.nodeOffset[nodeIndex] <= offset);
@@ -1586,13 +1770,13 @@ public:
 		return result;
 	}
 
-	static DPSlice getInitialSliceOneNodeGroup(const Params& params, const std::vector<LengthType>& nodeIndices)
+	static DPSlice getInitialSliceOneNodeGroup(const Params& params, const std::vector<LengthType>& nodeIndices, SliceArena* arena)
 	{
 		DPSlice result;
 		result.j = -WordConfiguration<Word>::WordSize;
 		result.bandwidth = 1;
 		result.minScore = 0;
-		result.scores.addEmptyNodeMap(nodeIndices.size());
+		result.scores.addEmptyNodeMap(nodeIndices.size(), arena);
 		for (auto nodeIndex : nodeIndices)
 		{
 			result.scores.addNodeToMap(nodeIndex);
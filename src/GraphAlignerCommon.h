@@ -1,12 +1,21 @@
 #ifndef GraphAlignerCommon_h
 #define GraphAlignerCommon_h
 
+#include <algorithm>
+#include <array>
+#include <mutex>
 #include <vector>
+#include <functional>
 #include "AlignmentGraph.h"
 #include "ArrayPriorityQueue.h"
 #include "ComponentPriorityQueue.h"
 #include "NodeSlice.h"
 #include "WordSlice.h"
+#include "SliceArena.h"
+#include "EpochBitvector.h"
+#include "ReadBudget.h"
+#include "WorkStealingPool.h"
+#include "EValue.h"
 
 template <typename LengthType, typename ScoreType, typename Word>
 class GraphAlignerCommon
@@ -49,42 +58,122 @@ public:
 		size_t slice;
 		bool forceCalculation;
 	};
+	//first rows of seedless DP only depend on which bases the first read character matches, so they are built once and shared by all reads
+	class FullStartSliceCache
+	{
+	public:
+		struct Row
+		{
+			NodeSlice<LengthType, ScoreType, Word, false> scores;
+			bool hasExactMatch;
+			LengthType exactMatchNode;
+		};
+		//bases is a bitmask of A, C, G, T. build is called once per bitmask
+		template <typename F>
+		std::shared_ptr<const Row> get(size_t bases, F build)
+		{
+			assert(bases < rows.size());
+			std::lock_guard<std::mutex> lock { mutex };
+			if (rows[bases] == nullptr) rows[bases] = std::make_shared<const Row>(build());
+			return rows[bases];
+		}
+	private:
+		std::mutex mutex;
+		std::array<std::shared_ptr<const Row>, 16> rows;
+	};
 	class AlignerGraphsizedState
 	{
 	public:
 		AlignerGraphsizedState(const AlignmentGraph& graph, size_t maxBandwidth) :
+		sliceArena(),
 		componentQueue(),
 		calculableQueue(),
 		currentBand(),
 		previousBand(),
-		hasSeedStart()
+		hasSeedStart(),
+		budget(),
+		taskPool(nullptr),
+		taskWorker(0),
+		parallelBandMinNodes(0),
+		fullStartSlices(std::make_shared<FullStartSliceCache>())
 		{
 			componentQueue.initialize(graph.ComponentSize());
 			calculableQueue.initialize(WordConfiguration<Word>::WordSize * (WordConfiguration<Word>::WordSize + maxBandwidth + 1) + maxBandwidth + 1, graph.NodeSize());
-			currentBand.resize(graph.NodeSize(), false);
-			previousBand.resize(graph.NodeSize(), false);
-			hasSeedStart.resize(graph.NodeSize(), false);
+			currentBand.resize(graph.NodeSize());
+			previousBand.resize(graph.NodeSize());
+			hasSeedStart.resize(graph.NodeSize());
 		}
 		void clear()
 		{
 			componentQueue.clear();
 			calculableQueue.clear();
-			currentBand.assign(currentBand.size(), false);
-			previousBand.assign(previousBand.size(), false);
-			hasSeedStart.assign(hasSeedStart.size(), false);
+			currentBand.clear();
+			previousBand.clear();
+			hasSeedStart.clear();
 		}
+		//runs the tasks on idle workers if there are any, otherwise in order on this thread
+		//each parallel task spends from its own copy of the read budget, which is charged back afterwards
+		//a task that ran out of budget marks this read's budget as stopped too
+		void runTasks(std::vector<std::function<void(AlignerGraphsizedState&)>>& tasks)
+		{
+			if (taskPool == nullptr || tasks.size() <= 1 || taskPool->idleWorkers() == 0)
+			{
+				for (auto& task : tasks)
+				{
+					task(*this);
+				}
+				return;
+			}
+			std::vector<ReadBudget> budgets(tasks.size(), budget);
+			std::vector<std::function<void(AlignerGraphsizedState&)>> budgeted;
+			for (size_t i = 0; i < tasks.size(); i++)
+			{
+				budgeted.emplace_back([&tasks, &budgets, i](AlignerGraphsizedState& state)
+				{
+					std::swap(state.budget, budgets[i]);
+					try
+					{
+						tasks[i](state);
+					}
+					catch (...)
+					{
+						std::swap(state.budget, budgets[i]);
+						state.clear();
+						throw;
+					}
+					std::swap(state.budget, budgets[i]);
+				});
+			}
+			size_t cellsBefore = budget.cells();
+			taskPool->run(taskWorker, *this, budgeted);
+			for (const auto& taskBudget : budgets)
+			{
+				budget.chargeTask(taskBudget, cellsBefore);
+			}
+		}
+		//declared first so it outlives everything allocated from it
+		SliceArena sliceArena;
 		ComponentPriorityQueue<EdgeWithPriority, true> componentQueue;
 		ArrayPriorityQueue<EdgeWithPriority, true> calculableQueue;
-		std::vector<bool> currentBand;
-		std::vector<bool> previousBand;
-		std::vector<bool> hasSeedStart;
+		EpochBitvector currentBand;
+		EpochBitvector previousBand;
+		EpochBitvector hasSeedStart;
+		ReadBudget budget;
+		//shared with the other worker threads so idle ones can take parts of this thread's read, null if single threaded
+		WorkStealingPool<AlignerGraphsizedState>* taskPool;
+		size_t taskWorker;
+		//slices whose queue reaches this many nodes are calculated in rounds shared with the idle threads, 0 for never
+		size_t parallelBandMinNodes;
+		//may be shared by the states of all threads aligning to the same graph
+		std::shared_ptr<FullStartSliceCache> fullStartSlices;
 	};
 	using MatrixPosition = AlignmentGraph::MatrixPosition;
 	class Params
 	{
 	public:
-		Params(LengthType alignmentBandwidth, const AlignmentGraph& graph, size_t maxCellsPerSlice, bool quietMode, bool sloppyOptimizations, size_t minSeedClusterSize, double seedExtendDensity, double preciseClippingIdentityCutoff, int Xdropcutoff, double multimapScoreFraction) :
+		Params(LengthType alignmentBandwidth, LengthType rampBandwidth, const AlignmentGraph& graph, size_t maxCellsPerSlice, bool quietMode, bool sloppyOptimizations, size_t minSeedClusterSize, double seedExtendDensity, double preciseClippingIdentityCutoff, int Xdropcutoff, double multimapScoreFraction, double ECutoff, int minAlignmentScore, size_t DPCheckpointInterval, double wavefrontMaxDivergence, bool scoreOnly) :
 		alignmentBandwidth(alignmentBandwidth),
+		rampBandwidth(rampBandwidth),
 		graph(graph),
 		maxCellsPerSlice(maxCellsPerSlice),
 		quietMode(quietMode),
@@ -93,10 +182,17 @@ public:
 		seedExtendDensity(seedExtendDensity),
 		XscoreErrorCost(100 * (preciseClippingIdentityCutoff / (1.0 - preciseClippingIdentityCutoff) + 1.0)),
 		Xdropcutoff(Xdropcutoff),
-		multimapScoreFraction(multimapScoreFraction)
+		multimapScoreFraction(multimapScoreFraction),
+		ECutoff(ECutoff),
+		minAlignmentScore(minAlignmentScore),
+		EValueCalc(ECutoff == -1 ? EValueCalculator {} : EValueCalculator { preciseClippingIdentityCutoff }),
+		DPCheckpointInterval(DPCheckpointInterval),
+		wavefrontMaxDivergence(wavefrontMaxDivergence),
+		scoreOnly(scoreOnly)
 		{
 		}
 		const LengthType alignmentBandwidth;
+		const LengthType rampBandwidth;
 		const AlignmentGraph& graph;
 		const size_t maxCellsPerSlice;
 		const bool quietMode;
@@ -106,6 +202,14 @@ public:
 		const ScoreType XscoreErrorCost;
 		const int Xdropcutoff;
 		const double multimapScoreFraction;
+		const double ECutoff;
+		const int minAlignmentScore;
+		const EValueCalculator EValueCalc;
+		const size_t DPCheckpointInterval;
+		//seed extensions try the wavefront engine before DP if this is positive, and fall back to DP if they diverge more than this
+		const double wavefrontMaxDivergence;
+		//seed extensions keep only their end positions and scores, not the traces
+		const bool scoreOnly;
 	};
 	struct TraceItem
 	{
@@ -170,6 +274,206 @@ public:
 		OnewayTrace forward;
 		OnewayTrace backward;
 	};
+	//end cell and score of a one-way extension without its trace, for score-only alignment
+	class OnewayEnd
+	{
+	public:
+		OnewayEnd() :
+		position(0, 0, 0),
+		score(0)
+		{
+		}
+		static OnewayEnd EndFailed()
+		{
+			OnewayEnd result;
+			result.score = std::numeric_limits<ScoreType>::max();
+			return result;
+		}
+		bool failed() const
+		{
+			return score == std::numeric_limits<ScoreType>::max();
+		}
+		MatrixPosition position;
+		ScoreType score;
+	};
+	enum class TraceEdit : char
+	{
+		Match,
+		Mismatch,
+		Insertion,
+		Deletion
+	};
+	//a bigraph node the trace passes through, and the offsets of the first and last cell on it in the original node
+	struct TracePathNode
+	{
+		int nodeId;
+		size_t startOffset;
+		size_t endOffset;
+	};
+	struct TraceEditRun
+	{
+		uint32_t length;
+		TraceEdit edit;
+	};
+	//cells of one edit run on one path node
+	struct TraceChunk
+	{
+		size_t pathIndex;
+		bool newNode;
+		TraceEdit edit;
+		size_t length;
+		//position of the first cell of the chunk. insertions stay at the same node offset and deletions at the same seqPos
+		size_t nodeOffset;
+		size_t seqPos;
+		size_t firstCell;
+	};
+	//run-length form of a finished trace, stored in the alignments instead of one TraceItem per cell
+	//the first cell is a match or mismatch, after that insertions stay on the same cell of the graph and other edits go to the next one,
+	//which is the next offset of the path node or the start of the next path node if the path node ends there
+	class CompactTrace
+	{
+		//position of the chunk walk before every CheckpointStride'th edit run, so walks can start near a read position
+		struct Checkpoint
+		{
+			size_t run;
+			size_t cell;
+			size_t pathIndex;
+			//of the cell before the run, or of the first cell for the first run
+			size_t nodeOffset;
+			size_t seqOffset;
+		};
+		static constexpr size_t CheckpointStride = 16;
+	public:
+		CompactTrace() :
+		path(),
+		edits(),
+		readStart(0),
+		readEnd(0),
+		cells(0),
+		score(0),
+		checkpoints()
+		{
+		}
+		CompactTrace(const CompactTrace& other) = delete;
+		CompactTrace(CompactTrace&& other) = default;
+		CompactTrace& operator=(const CompactTrace& other) = delete;
+		CompactTrace& operator=(CompactTrace&& other) = default;
+		//adds length cells with the same edit to the end, seqPos and nodeOffset are the position of the first added cell
+		void append(TraceEdit edit, size_t length, bool newNode, int nodeId, size_t nodeOffset, size_t seqPos)
+		{
+			assert(length > 0);
+			assert(cells > 0 || (newNode && (edit == TraceEdit::Match || edit == TraceEdit::Mismatch)));
+			assert(!newNode || edit != TraceEdit::Insertion);
+			if (cells == 0) readStart = seqPos;
+			bool newRun = edits.size() == 0 || edits.back().edit != edit;
+			if (newRun && edits.size() % CheckpointStride == 0)
+			{
+				//the last cell so far is always on the end offset of the last path node, insertions included
+				if (cells == 0) checkpoints.push_back(Checkpoint { 0, 0, 0, nodeOffset, 0 });
+				else checkpoints.push_back(Checkpoint { edits.size(), cells, path.size()-1, path.back().endOffset, readEnd - 1 - readStart });
+			}
+			if (newNode)
+			{
+				path.push_back(TracePathNode { nodeId, nodeOffset, nodeOffset });
+			}
+			assert(path.back().nodeId == nodeId);
+			if (edit != TraceEdit::Insertion) path.back().endOffset = nodeOffset + length - 1;
+			if (newRun)
+			{
+				edits.push_back(TraceEditRun { (uint32_t)length, edit });
+			}
+			else
+			{
+				edits.back().length += length;
+			}
+			cells += length;
+			readEnd = (edit == TraceEdit::Deletion ? seqPos : seqPos + length - 1) + 1;
+		}
+		//calls f with the chunks of the trace in order until f returns false
+		template <typename F>
+		void forEachChunk(F f) const
+		{
+			if (cells == 0) return;
+			walkChunks(checkpoints[0], f);
+		}
+		//same as forEachChunk but may skip chunks whose cells are all before seqPos, binary searches where to start
+		template <typename F>
+		void forEachChunkFrom(size_t seqPos, F f) const
+		{
+			if (cells == 0) return;
+			//the last checkpoint whose previous cell is before seqPos, so every cell at seqPos comes after it
+			auto after = std::partition_point(checkpoints.begin()+1, checkpoints.end(), [this, seqPos](const Checkpoint& checkpoint) { return readStart + checkpoint.seqOffset < seqPos; });
+			walkChunks(*(after-1), f);
+		}
+		std::vector<TracePathNode> path;
+		std::vector<TraceEditRun> edits;
+		size_t readStart;
+		size_t readEnd;
+		size_t cells;
+		ScoreType score;
+	private:
+		template <typename F>
+		void walkChunks(const Checkpoint& start, F& f) const
+		{
+			size_t pathIndex = start.pathIndex;
+			size_t nodeOffset = start.nodeOffset;
+			size_t seqPos = readStart + start.seqOffset;
+			size_t cell = start.cell;
+			bool newNode = cell == 0;
+			for (size_t runIndex = start.run; runIndex < edits.size(); runIndex++)
+			{
+				auto run = edits[runIndex];
+				size_t left = run.length;
+				while (left > 0)
+				{
+					TraceChunk chunk;
+					chunk.edit = run.edit;
+					chunk.firstCell = cell;
+					if (run.edit == TraceEdit::Insertion)
+					{
+						assert(cell > 0);
+						chunk.length = left;
+						chunk.nodeOffset = nodeOffset;
+						chunk.seqPos = seqPos + 1;
+						seqPos += left;
+					}
+					else
+					{
+						if (cell > 0)
+						{
+							if (nodeOffset == path[pathIndex].endOffset)
+							{
+								pathIndex += 1;
+								assert(pathIndex < path.size());
+								nodeOffset = path[pathIndex].startOffset;
+								newNode = true;
+							}
+							else
+							{
+								nodeOffset += 1;
+							}
+							if (run.edit != TraceEdit::Deletion) seqPos += 1;
+						}
+						chunk.length = std::min(left, path[pathIndex].endOffset - nodeOffset + 1);
+						chunk.nodeOffset = nodeOffset;
+						chunk.seqPos = seqPos;
+						nodeOffset += chunk.length - 1;
+						if (run.edit != TraceEdit::Deletion) seqPos += chunk.length - 1;
+					}
+					chunk.pathIndex = pathIndex;
+					chunk.newNode = newNode;
+					newNode = false;
+					if (!f(chunk)) return;
+					cell += chunk.length;
+					left -= chunk.length;
+				}
+			}
+			assert(cell == cells);
+			assert(pathIndex == path.size()-1);
+			assert(seqPos + 1 == readEnd);
+		}
+		std::vector<Checkpoint> checkpoints;
+	};
 #ifdef NDEBUG
 	__attribute__((always_inline))
 #endif
@@ -198,6 +502,16 @@ public:
 		|| (ambiguousMatch(sequenceCharacter, 'G') && ambiguousMatch(graphCharacter, 'G'))
 		|| (ambiguousMatch(sequenceCharacter, 'T') && ambiguousMatch(graphCharacter, 'T'));
 	}
+	//bitmask of A, C, G, T, read characters with the same mask match the same graph characters
+	static size_t matchedBases(char sequenceCharacter)
+	{
+		size_t result = 0;
+		if (characterMatch(sequenceCharacter, 'A')) result |= 1;
+		if (characterMatch(sequenceCharacter, 'C')) result |= 2;
+		if (characterMatch(sequenceCharacter, 'G')) result |= 4;
+		if (characterMatch(sequenceCharacter, 'T')) result |= 8;
+		return result;
+	}
 #ifdef NDEBUG
 	__attribute__((always_inline))
 #endif
@@ -284,7 +598,8 @@ class AlignmentResult
 public:
 	AlignmentResult() :
 		alignments(),
-		seedsExtended(0)
+		seedsExtended(0),
+		budgetExhausted(false)
 	{}
 	class AlignmentItem
 	{
@@ -300,9 +615,12 @@ public:
 		alignmentEnd(0),
 		alignmentScore(std::numeric_limits<size_t>::max()),
 		alignmentXScore(-1),
-		mappingQuality(255)
+		mappingQuality(255),
+		budgetExhausted(false),
+		alignmentStartPos(0, 0, 0),
+		alignmentEndPos(0, 0, 0)
 		{}
-		AlignmentItem(GraphAlignerCommon<size_t, int32_t, uint64_t>::OnewayTrace&& trace, size_t cellsProcessed, size_t ms) :
+		AlignmentItem(GraphAlignerCommon<size_t, int32_t, uint64_t>::CompactTrace&& trace, size_t cellsProcessed, size_t ms) :
 		corrected(),
 		alignment(),
 		trace(),
@@ -312,9 +630,12 @@ public:
 		alignmentEnd(0),
 		alignmentScore(std::numeric_limits<size_t>::max()),
 		alignmentXScore(-1),
-		mappingQuality(255)
+		mappingQuality(255),
+		budgetExhausted(false),
+		alignmentStartPos(0, 0, 0),
+		alignmentEndPos(0, 0, 0)
 		{
-			this->trace = std::make_shared<GraphAlignerCommon<size_t, int32_t, uint64_t>::OnewayTrace>();
+			this->trace = std::make_shared<GraphAlignerCommon<size_t, int32_t, uint64_t>::CompactTrace>();
 			*this->trace = std::move(trace);
 		}
 		bool alignmentFailed() const
@@ -328,7 +649,7 @@ public:
 		std::string corrected;
 		std::string GAFline;
 		std::shared_ptr<vg::Alignment> alignment;
-		std::shared_ptr<GraphAlignerCommon<size_t, int32_t, uint64_t>::OnewayTrace> trace;
+		std::shared_ptr<GraphAlignerCommon<size_t, int32_t, uint64_t>::CompactTrace> trace;
 		size_t seedGoodness;
 		size_t cellsProcessed;
 		size_t elapsedMilliseconds;
@@ -337,9 +658,16 @@ public:
 		size_t alignmentScore;
 		double alignmentXScore;
 		int mappingQuality;
+		//the read ran out of its time / cell budget so this alignment may be partial
+		bool budgetExhausted;
+		//score-only alignments have no trace, only the graph positions of the first and last aligned bp
+		//node is the bigraph node id and nodeOffset the offset in it
+		AlignmentGraph::MatrixPosition alignmentStartPos;
+		AlignmentGraph::MatrixPosition alignmentEndPos;
 	};
 	std::vector<AlignmentItem> alignments;
 	size_t seedsExtended;
+	bool budgetExhausted;
 	std::string readName;
 };
 
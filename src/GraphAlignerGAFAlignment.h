@@ -15,7 +15,7 @@ class GraphAlignerGAFAlignment
 	using Common = GraphAlignerCommon<LengthType, ScoreType, Word>;
 	using Params = typename Common::Params;
 	using MatrixPosition = typename Common::MatrixPosition;
-	using TraceItem = typename Common::TraceItem;
+	using TraceEdit = typename Common::TraceEdit;
 	struct MergedNodePos
 	{
 		int nodeId;
@@ -34,160 +34,79 @@ class GraphAlignerGAFAlignment
 	};
 public:
 
-	static std::string traceToAlignment(const std::string& seq_id, const std::string& sequence, const GraphAlignerCommon<size_t, int32_t, uint64_t>::OnewayTrace& tracePair, double alignmentXScore, int mappingQuality, const Params& params, bool cigarMatchMismatchMerge)
+	static std::string traceToAlignment(const std::string& seq_id, const std::string& sequence, const GraphAlignerCommon<size_t, int32_t, uint64_t>::CompactTrace& trace, double alignmentXScore, int mappingQuality, const Params& params, bool cigarMatchMismatchMerge)
 	{
-		auto& trace = tracePair.trace;
-		if (trace.size() == 0) return nullptr;
+		if (trace.cells == 0) return nullptr;
 		std::stringstream cigar;
 		std::string readName = seq_id;
 		size_t readLen = sequence.size();
-		size_t readStart = trace[0].DPposition.seqPos;
-		size_t readEnd = trace.back().DPposition.seqPos+1;
+		size_t readStart = trace.readStart;
+		size_t readEnd = trace.readEnd;
 		bool strand = true;
 		std::stringstream nodePath;
 		size_t nodePathLen = 0;
-		size_t nodePathStart = trace[0].DPposition.nodeOffset;
+		size_t nodePathStart = trace.path[0].startOffset;
 		size_t nodePathEnd = 0;
 		size_t matches = 0;
-		size_t blockLength = trace.size();
+		size_t blockLength = trace.cells;
+
+		for (size_t i = 0; i < trace.path.size(); i++)
+		{
+			MergedNodePos currentPos;
+			currentPos.nodeId = trace.path[i].nodeId;
+			currentPos.reverse = (trace.path[i].nodeId % 2) == 1;
+			currentPos.nodeOffset = trace.path[i].startOffset;
+			addPosToString(nodePath, currentPos, params);
+			assert(trace.path[i].endOffset < params.graph.originalNodeSize.at(currentPos.nodeId));
+			nodePathLen += params.graph.originalNodeSize.at(currentPos.nodeId);
+			if (i > 0)
+			{
+				size_t skippedBefore = params.graph.originalNodeSize.at(trace.path[i-1].nodeId) - 1 - trace.path[i-1].endOffset;
+				size_t skippedAfter = trace.path[i].startOffset;
+				nodePathLen -= skippedBefore + skippedAfter;
+			}
+		}
 
-		MergedNodePos currentPos;
-		currentPos.nodeId = trace[0].DPposition.node;
-		currentPos.reverse = (trace[0].DPposition.node % 2) == 1;
-		currentPos.nodeOffset = trace[0].DPposition.nodeOffset;
-		currentPos.seqPos = trace[0].DPposition.seqPos;
 		EditType currentEdit = Empty;
 		size_t mismatches = 0;
 		size_t deletions = 0;
 		size_t insertions = 0;
 		size_t editLength = 0;
-		if (cigarMatchMismatchMerge)
+		for (auto run : trace.edits)
 		{
-			currentEdit = MatchOrMismatch;
-			editLength = 1;
-			if (Common::characterMatch(trace[0].sequenceCharacter, trace[0].graphCharacter))
-			{
-				matches += 1;
-			}
-			else
-			{
-				mismatches += 1;
-			}
-		}
-		else if (Common::characterMatch(trace[0].sequenceCharacter, trace[0].graphCharacter))
-		{
-			currentEdit = Match;
-			editLength = 1;
-			matches += 1;
-		}
-		else
-		{
-			currentEdit = Mismatch;
-			editLength = 1;
-			mismatches += 1;
-		}
-		addPosToString(nodePath, currentPos, params);
-		nodePathLen += params.graph.originalNodeSize.at(currentPos.nodeId);
-		for (size_t pos = 1; pos < trace.size(); pos++)
-		{
-			assert(trace[pos].DPposition.seqPos < sequence.size());
-			MergedNodePos newPos;
-			newPos.nodeId = trace[pos].DPposition.node;
-			newPos.reverse = (trace[pos].DPposition.node % 2) == 1;
-			newPos.nodeOffset = trace[pos].DPposition.nodeOffset;
-			newPos.seqPos = trace[pos].DPposition.seqPos;
-			bool insideNode = !trace[pos-1].nodeSwitch || (newPos.nodeId == currentPos.nodeId && newPos.reverse == currentPos.reverse && newPos.nodeOffset > currentPos.nodeOffset);
-
-			assert(newPos.seqPos >= currentPos.seqPos);
-
-			if (!insideNode)
-			{
-				size_t skippedBefore = params.graph.originalNodeSize.at(currentPos.nodeId) - 1 - trace[pos-1].DPposition.nodeOffset;
-				currentPos = newPos;
-				addPosToString(nodePath, currentPos, params);
-				assert(trace[pos].DPposition.nodeOffset < params.graph.originalNodeSize.at(currentPos.nodeId));
-				size_t skippedAfter = trace[pos].DPposition.nodeOffset;
-				nodePathLen += params.graph.originalNodeSize.at(currentPos.nodeId) - (skippedBefore + skippedAfter);
-			}
-
-			if (trace[pos-1].DPposition.seqPos == trace[pos].DPposition.seqPos)
-			{
-				if (currentEdit == Empty) currentEdit = Deletion;
-				if (currentEdit != Deletion)
-				{
-					addCigarItem(cigar, editLength, currentEdit);
-					currentEdit = Deletion;
-					editLength = 0;
-				}
-				editLength += 1;
-				deletions += 1;
-			}
-			else if (insideNode && trace[pos-1].DPposition.nodeOffset == trace[pos].DPposition.nodeOffset)
-			{
-				if (currentEdit == Empty) currentEdit = Insertion;
-				if (currentEdit != Insertion)
-				{
-					addCigarItem(cigar, editLength, currentEdit);
-					currentEdit = Insertion;
-					editLength = 0;
-				}
-				editLength += 1;
-				insertions += 1;
-			}
-			else if (cigarMatchMismatchMerge)
-			{
-				if (currentEdit == Empty) currentEdit = MatchOrMismatch;
-				if (currentEdit != MatchOrMismatch)
-				{
-					addCigarItem(cigar, editLength, currentEdit);
-					currentEdit = MatchOrMismatch;
-					editLength = 0;
-				}
-				editLength += 1;
-				if (Common::characterMatch(trace[pos].sequenceCharacter, trace[pos].graphCharacter))
-				{
-					matches += 1;
-				}
-				else
-				{
-					mismatches += 1;
-				}
-			}
-			else if (Common::characterMatch(trace[pos].sequenceCharacter, trace[pos].graphCharacter))
-			{
-				if (currentEdit == Empty) currentEdit = Match;
-				if (currentEdit != Match)
-				{
-					addCigarItem(cigar, editLength, currentEdit);
-					currentEdit = Match;
-					editLength = 0;
-				}
-				editLength += 1;
-				matches += 1;
-			}
-			else
+			EditType edit = Empty;
+			switch(run.edit)
 			{
-				if (currentEdit == Empty) currentEdit = Mismatch;
-				if (currentEdit != Mismatch)
-				{
-					addCigarItem(cigar, editLength, currentEdit);
-					currentEdit = Mismatch;
-					editLength = 0;
-				}
-				editLength += 1;
-				mismatches += 1;
+				case TraceEdit::Match:
+					edit = cigarMatchMismatchMerge ? MatchOrMismatch : Match;
+					matches += run.length;
+					break;
+				case TraceEdit::Mismatch:
+					edit = cigarMatchMismatchMerge ? MatchOrMismatch : Mismatch;
+					mismatches += run.length;
+					break;
+				case TraceEdit::Insertion:
+					edit = Insertion;
+					insertions += run.length;
+					break;
+				case TraceEdit::Deletion:
+					edit = Deletion;
+					deletions += run.length;
+					break;
 			}
-			if (insideNode)
+			if (edit != currentEdit)
 			{
-				assert(trace[pos-1].nodeSwitch || newPos.nodeId == currentPos.nodeId);
-				assert(trace[pos-1].nodeSwitch || newPos.reverse == currentPos.reverse);
+				addCigarItem(cigar, editLength, currentEdit);
+				currentEdit = edit;
+				editLength = 0;
 			}
+			editLength += run.length;
 		}
 
-		assert(matches + mismatches + deletions + insertions == trace.size());
+		assert(matches + mismatches + deletions + insertions == trace.cells);
 		addCigarItem(cigar, editLength, currentEdit);
 
-		nodePathEnd = nodePathLen - (params.graph.originalNodeSize.at(trace.back().DPposition.node) - 1 - trace.back().DPposition.nodeOffset);
+		nodePathEnd = nodePathLen - (params.graph.originalNodeSize.at(trace.path.back().nodeId) - 1 - trace.path.back().endOffset);
 
 		std::stringstream sstr;
 		sstr << readName << "\t" << readLen << "\t" << readStart << "\t" << readEnd << "\t" << (strand ? "+" : "-") << "\t" << nodePath.str() << "\t" << nodePathLen << "\t" << nodePathStart << "\t" << nodePathEnd << "\t" << matches << "\t" << blockLength << "\t" << mappingQuality;
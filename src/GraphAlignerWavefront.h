@@ -0,0 +1,202 @@
+#ifndef GraphAlignerWavefront_h
+#define GraphAlignerWavefront_h
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <limits>
+#include <string_view>
+#include <phmap.h>
+#include "AlignmentGraph.h"
+#include "ThreadReadAssertion.h"
+#include "GraphAlignerCommon.h"
+
+//wavefront extension from a seed, work grows with the number of edits instead of the read length
+//the wavefront of each edit count keeps only the furthest reaching point of each diagonal, where a diagonal is (node, offset - seqPos) within a split node
+//gives up with TraceFailed when the read looks too divergent for it, and the caller falls back to DP
+template <typename LengthType, typename ScoreType, typename Word>
+class GraphAlignerWavefront
+{
+private:
+	using Common = GraphAlignerCommon<LengthType, ScoreType, Word>;
+	using AlignerGraphsizedState = typename Common::AlignerGraphsizedState;
+	using Params = typename Common::Params;
+	using MatrixPosition = typename Common::MatrixPosition;
+	using OnewayTrace = typename Common::OnewayTrace;
+	//points further than this many bp behind the furthest point of their wavefront are dropped
+	static constexpr size_t WavefrontMaxLag = 50;
+	//give up if a wavefront has more points than this after dropping
+	static constexpr size_t WavefrontMaxWidth = 2000;
+	//edits allowed on top of the divergence limit, so that the first bp of the extension don't fail it
+	static constexpr size_t WavefrontDivergenceSlack = 8;
+	//the DP checks the X-drop once per slice, allow a few edits of slack so that clustered edits don't end the extension early
+	static constexpr ScoreType WavefrontXdropEdits = 4;
+	enum PointMove
+	{
+		Seed,
+		Match,
+		Mismatch,
+		Insertion,
+		Deletion
+	};
+	//a run of matches along one diagonal, from the start cell that was reached with move from the end of the parent
+	struct WavefrontPoint
+	{
+		LengthType node;
+		LengthType startOffset;
+		size_t startConsumed;
+		LengthType endOffset;
+		size_t endConsumed;
+		size_t parent;
+		ScoreType edits;
+		PointMove move;
+	};
+	const Params& params;
+public:
+
+	GraphAlignerWavefront(const Params& params) :
+	params(params)
+	{
+	}
+
+	//returns the trace in the same form as the DP, starting from the seed cell at seqPos -1, or TraceFailed if the read diverges more than maxDivergence
+	OnewayTrace getTraceFromSeed(const std::string_view& sequence, int bigraphNodeId, size_t nodeOffset, double maxDivergence, AlignerGraphsizedState& reusableState) const
+	{
+		LengthType startNode = params.graph.GetUnitigNode(bigraphNodeId, nodeOffset);
+		LengthType startOffset = nodeOffset - params.graph.nodeOffset[startNode];
+		std::vector<WavefrontPoint> points;
+		//furthest seqPos reached on each diagonal
+		phmap::flat_hash_map<std::pair<size_t, size_t>, size_t> furthest;
+		std::vector<size_t> wavefront;
+		std::vector<size_t> nextWavefront;
+		auto addPoint = [&points, &furthest](std::vector<size_t>& addTo, LengthType node, LengthType offset, size_t consumed, size_t parent, ScoreType edits, PointMove move)
+		{
+			std::pair<size_t, size_t> diagonal { node, (size_t)offset - consumed };
+			auto found = furthest.find(diagonal);
+			if (found != furthest.end() && found->second >= consumed) return;
+			furthest[diagonal] = consumed;
+			addTo.push_back(points.size());
+			points.push_back(WavefrontPoint { node, offset, consumed, offset, consumed, parent, edits, move });
+		};
+		addPoint(wavefront, startNode, startOffset, 0, std::numeric_limits<size_t>::max(), 0, Seed);
+		ScoreType bestXScore = 0;
+		size_t bestPoint = 0;
+		ScoreType edits = 0;
+		while (true)
+		{
+			size_t cells = 0;
+			size_t maxConsumed = 0;
+			ScoreType levelBestXScore = std::numeric_limits<ScoreType>::min();
+			//wavefront grows while iterating when matches continue into several out-neighbors
+			for (size_t i = 0; i < wavefront.size(); i++)
+			{
+				WavefrontPoint& point = points[wavefront[i]];
+				std::pair<size_t, size_t> diagonal { point.node, (size_t)point.startOffset - point.startConsumed };
+				if (furthest.at(diagonal) > point.startConsumed)
+				{
+					//another point of this wavefront got further on the same diagonal
+					point.endConsumed = std::numeric_limits<size_t>::max();
+					continue;
+				}
+				LengthType offset = point.startOffset;
+				size_t consumed = point.startConsumed;
+				size_t nodeLength = params.graph.NodeLength(point.node);
+				while (consumed < sequence.size() && offset + 1 < nodeLength && Common::characterMatch(sequence[consumed], params.graph.NodeSequences(point.node, offset + 1)))
+				{
+					offset += 1;
+					consumed += 1;
+				}
+				cells += consumed - point.startConsumed + 1;
+				point.endOffset = offset;
+				point.endConsumed = consumed;
+				furthest[diagonal] = consumed;
+				maxConsumed = std::max(maxConsumed, consumed);
+				ScoreType XScore = (ScoreType)consumed * 100 - edits * params.XscoreErrorCost;
+				levelBestXScore = std::max(levelBestXScore, XScore);
+				if (XScore > bestXScore)
+				{
+					bestXScore = XScore;
+					bestPoint = wavefront[i];
+				}
+				if (consumed < sequence.size() && offset + 1 == nodeLength)
+				{
+					LengthType node = point.node;
+					size_t parent = wavefront[i];
+					for (auto neighbor : params.graph.outNeighbors[node])
+					{
+						if (!Common::characterMatch(sequence[consumed], params.graph.NodeSequences(neighbor, 0))) continue;
+						addPoint(wavefront, neighbor, 0, consumed + 1, parent, edits, Match);
+					}
+				}
+			}
+			if (maxConsumed == sequence.size()) break;
+			if (!reusableState.budget.spend(cells)) break;
+			if (levelBestXScore < bestXScore - params.Xdropcutoff - WavefrontXdropEdits * params.XscoreErrorCost) break;
+			if ((double)edits > maxDivergence * maxConsumed + WavefrontDivergenceSlack) return OnewayTrace::TraceFailed();
+			nextWavefront.clear();
+			size_t width = 0;
+			for (auto index : wavefront)
+			{
+				if (points[index].endConsumed == std::numeric_limits<size_t>::max()) continue;
+				if (points[index].endConsumed + WavefrontMaxLag < maxConsumed) continue;
+				width += 1;
+				LengthType node = points[index].node;
+				LengthType offset = points[index].endOffset;
+				size_t consumed = points[index].endConsumed;
+				if (consumed < sequence.size()) addPoint(nextWavefront, node, offset, consumed + 1, index, edits + 1, Insertion);
+				if (offset + 1 < params.graph.NodeLength(node))
+				{
+					if (consumed < sequence.size()) addPoint(nextWavefront, node, offset + 1, consumed + 1, index, edits + 1, Mismatch);
+					addPoint(nextWavefront, node, offset + 1, consumed, index, edits + 1, Deletion);
+				}
+				else
+				{
+					for (auto neighbor : params.graph.outNeighbors[node])
+					{
+						if (consumed < sequence.size()) addPoint(nextWavefront, neighbor, 0, consumed + 1, index, edits + 1, Mismatch);
+						addPoint(nextWavefront, neighbor, 0, consumed, index, edits + 1, Deletion);
+					}
+				}
+			}
+			if (width > WavefrontMaxWidth) return OnewayTrace::TraceFailed();
+			if (nextWavefront.size() == 0) break;
+			std::swap(wavefront, nextWavefront);
+			edits += 1;
+		}
+		if (points[bestPoint].endConsumed == 0) return OnewayTrace::TraceFailed();
+		return getTrace(sequence, points, bestPoint);
+	}
+
+private:
+
+	OnewayTrace getTrace(const std::string_view& sequence, const std::vector<WavefrontPoint>& points, size_t bestPoint) const
+	{
+		std::vector<size_t> path;
+		for (size_t index = bestPoint; index != std::numeric_limits<size_t>::max(); index = points[index].parent)
+		{
+			path.push_back(index);
+		}
+		std::reverse(path.begin(), path.end());
+		assert(points[path[0]].move == Seed);
+		OnewayTrace result;
+		result.score = points[bestPoint].edits;
+		for (auto index : path)
+		{
+			const WavefrontPoint& point = points[index];
+			if (result.trace.size() > 0 && point.move != Insertion)
+			{
+				const MatrixPosition& previous = result.trace.back().DPposition;
+				if (point.node != previous.node || point.startOffset != previous.nodeOffset + 1) result.trace.back().nodeSwitch = true;
+			}
+			for (size_t i = 0; i <= point.endConsumed - point.startConsumed; i++)
+			{
+				result.trace.emplace_back(MatrixPosition { point.node, point.startOffset + i, point.startConsumed + i - 1 }, false, sequence, params.graph);
+			}
+		}
+		assert(result.trace[0].DPposition.seqPos == (size_t)-1);
+		return result;
+	}
+
+};
+
+#endif
@@ -5,58 +5,72 @@
 #include "GraphAligner.h"
 #include "ThreadReadAssertion.h"
 
-AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, size_t alignmentBandwidth, bool quietMode, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState, double preciseClippingIdentityCutoff, int Xdropcutoff, size_t DPRestartStride)
+AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, size_t alignmentBandwidth, size_t rampBandwidth, bool quietMode, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState, double preciseClippingIdentityCutoff, int Xdropcutoff, size_t DPRestartStride, size_t DPCheckpointInterval)
 {
-	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {alignmentBandwidth, graph, std::numeric_limits<size_t>::max(), quietMode, false, 1, 0, preciseClippingIdentityCutoff, Xdropcutoff, 0};
+	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {alignmentBandwidth, rampBandwidth, graph, std::numeric_limits<size_t>::max(), quietMode, false, 1, 0, preciseClippingIdentityCutoff, Xdropcutoff, 0, -1, std::numeric_limits<int>::min(), DPCheckpointInterval, 0, false};
 	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
 	return aligner.AlignOneWay(seq_id, sequence, reusableState, DPRestartStride);
 }
 
-AlignmentResult AlignMultiseed(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, size_t alignmentBandwidth, size_t maxCellsPerSlice, bool quietMode, bool sloppyOptimizations, const std::vector<SeedHit>& seedHits, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState, size_t minClusterSize, double seedExtendDensity, double preciseClippingIdentityCutoff, int Xdropcutoff, double multimapScoreFraction)
+AlignmentResult AlignMultiseed(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, size_t alignmentBandwidth, size_t rampBandwidth, size_t maxCellsPerSlice, bool quietMode, bool sloppyOptimizations, const std::vector<SeedHit>& seedHits, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState, size_t minClusterSize, double seedExtendDensity, double preciseClippingIdentityCutoff, int Xdropcutoff, double multimapScoreFraction)
 {
-	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {alignmentBandwidth, graph, maxCellsPerSlice, quietMode, sloppyOptimizations, minClusterSize, seedExtendDensity, preciseClippingIdentityCutoff, Xdropcutoff, multimapScoreFraction};
+	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {alignmentBandwidth, rampBandwidth, graph, maxCellsPerSlice, quietMode, sloppyOptimizations, minClusterSize, seedExtendDensity, preciseClippingIdentityCutoff, Xdropcutoff, multimapScoreFraction, -1, std::numeric_limits<int>::min(), 0, 0, false};
 	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
 	return aligner.AlignMultiseed(seq_id, sequence, seedHits, reusableState);
 }
 
-AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, size_t alignmentBandwidth, size_t maxCellsPerSlice, bool quietMode, bool sloppyOptimizations, const std::vector<SeedHit>& seedHits, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState, size_t minClusterSize, double seedExtendDensity, double preciseClippingIdentityCutoff, int Xdropcutoff)
+AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, size_t alignmentBandwidth, size_t rampBandwidth, size_t maxCellsPerSlice, bool quietMode, bool sloppyOptimizations, const std::vector<SeedHit>& seedHits, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState, size_t minClusterSize, double seedExtendDensity, double preciseClippingIdentityCutoff, int Xdropcutoff, double multimapScoreFraction, double ECutoff, int minAlignmentScore, size_t DPCheckpointInterval, double wavefrontMaxDivergence, bool scoreOnly)
 {
-	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {alignmentBandwidth, graph, maxCellsPerSlice, quietMode, sloppyOptimizations, minClusterSize, seedExtendDensity, preciseClippingIdentityCutoff, Xdropcutoff, 0};
+	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {alignmentBandwidth, rampBandwidth, graph, maxCellsPerSlice, quietMode, sloppyOptimizations, minClusterSize, seedExtendDensity, preciseClippingIdentityCutoff, Xdropcutoff, multimapScoreFraction, ECutoff, minAlignmentScore, DPCheckpointInterval, wavefrontMaxDivergence, scoreOnly};
 	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
 	return aligner.AlignOneWay(seq_id, sequence, seedHits, reusableState);
 }
 
+std::vector<AlignmentResult> AlignShortReadBatch(const AlignmentGraph& graph, const std::vector<std::string>& seq_ids, const std::vector<std::string>& sequences, size_t alignmentBandwidth, size_t rampBandwidth, size_t maxCellsPerSlice, bool quietMode, const std::vector<SeedHit>& seedHits, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState, double preciseClippingIdentityCutoff, int Xdropcutoff)
+{
+	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {alignmentBandwidth, rampBandwidth, graph, maxCellsPerSlice, quietMode, false, 1, 0, preciseClippingIdentityCutoff, Xdropcutoff, 0, -1, std::numeric_limits<int>::min(), 0, 0, false};
+	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
+	return aligner.AlignShortReadBatch(seq_ids, sequences, seedHits, reusableState);
+}
+
+AlignmentResult StitchWindows(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, const std::vector<size_t>& windowStarts, std::vector<AlignmentResult>& windowResults, double preciseClippingIdentityCutoff)
+{
+	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {1, 0, graph, 1, true, true, 1, 0, preciseClippingIdentityCutoff, 0, 0, -1, std::numeric_limits<int>::min(), 0, 0, false};
+	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
+	return aligner.StitchWindows(seq_id, sequence, windowStarts, windowResults);
+}
+
 void AddAlignment(const std::string& seq_id, const std::string& sequence, AlignmentResult::AlignmentItem& alignment)
 {
-	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {1, AlignmentGraph::DummyGraph(), 1, true, true, 1, 0, .5, 0, 0};
+	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {1, 0, AlignmentGraph::DummyGraph(), 1, true, true, 1, 0, .5, 0, 0, -1, std::numeric_limits<int>::min(), 0, 0, false};
 	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
 	aligner.AddAlignment(seq_id, sequence, alignment);
 }
 
 void AddGAFLine(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, AlignmentResult::AlignmentItem& alignment, bool cigarMatchMismatchMerge)
 {
-	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {1, graph, 1, true, true, 1, 0, .5, 0, 0};
+	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {1, 0, graph, 1, true, true, 1, 0, .5, 0, 0, -1, std::numeric_limits<int>::min(), 0, 0, false};
 	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
 	aligner.AddGAFLine(seq_id, sequence, alignment, cigarMatchMismatchMerge);
 }
 
-void AddCorrected(AlignmentResult::AlignmentItem& alignment)
+void AddCorrected(const AlignmentGraph& graph, AlignmentResult::AlignmentItem& alignment)
 {
-	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {1, AlignmentGraph::DummyGraph(), 1, true, true, 1, 0, .5, 0, 0};
+	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {1, 0, graph, 1, true, true, 1, 0, .5, 0, 0, -1, std::numeric_limits<int>::min(), 0, 0, false};
 	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
 	aligner.AddCorrected(alignment);
 }
 
 void OrderSeeds(const AlignmentGraph& graph, std::vector<SeedHit>& seedHits)
 {
-	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {1, graph, 1, true, true, 1, 0, .5, 0, 0};
+	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {1, 0, graph, 1, true, true, 1, 0, .5, 0, 0, -1, std::numeric_limits<int>::min(), 0, 0, false};
 	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
 	aligner.orderSeedsByChaining(seedHits);
 }
 
 void PrepareMultiseeds(const AlignmentGraph& graph, std::vector<SeedHit>& seedHits, const size_t seqLen)
 {
-	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {1, graph, 1, true, true, 1, 0, .5, 0, 0};
+	GraphAlignerCommon<size_t, int32_t, uint64_t>::Params params {1, 0, graph, 1, true, true, 1, 0, .5, 0, 0, -1, std::numeric_limits<int>::min(), 0, 0, false};
 	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
 	seedHits = aligner.prepareSeedsForMultiseeding(seedHits, seqLen);
 }
@@ -21,7 +21,9 @@ public:
 	alignmentGraphNodeOffset(std::numeric_limits<size_t>::max()),
 	rawSeedGoodness(0),
 	seedGoodness(0),
-	seedClusterSize(0)
+	seedClusterSize(0),
+	seedClusterStart(0),
+	seedClusterEnd(std::numeric_limits<size_t>::max())
 	{
 	}
 	SeedHit(int nodeID, size_t nodeOffset, size_t seqPos, size_t matchLen, size_t rawSeedGoodness, bool reverse) :
@@ -34,7 +36,9 @@ public:
 	alignmentGraphNodeOffset(std::numeric_limits<size_t>::max()),
 	rawSeedGoodness(rawSeedGoodness),
 	seedGoodness(0),
-	seedClusterSize(0)
+	seedClusterSize(0),
+	seedClusterStart(0),
+	seedClusterEnd(std::numeric_limits<size_t>::max())
 	{
 	}
 	int nodeID;
@@ -47,15 +51,19 @@ public:
 	size_t rawSeedGoodness;
 	size_t seedGoodness;
 	size_t seedClusterSize;
+	size_t seedClusterStart;
+	size_t seedClusterEnd;
 };
 
-AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, size_t alignmentBandwidth, bool quietMode, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState, double preciseClippingIdentityCutoff, int Xdropcutoff, size_t DPRestartStride);
-AlignmentResult AlignMultiseed(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, size_t alignmentBandwidth, size_t maxCellsPerSlice, bool quietMode, bool sloppyOptimizations, const std::vector<SeedHit>& seedHits, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState, size_t minClusterSize, double seedExtendDensity, double preciseClippingIdentityCutoff, int Xdropcutoff, double multimapScoreFraction);
-AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, size_t alignmentBandwidth, size_t maxCellsPerSlice, bool quietMode, bool sloppyOptimizations, const std::vector<SeedHit>& seedHits, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState, size_t minClusterSize, double seedExtendDensity, double preciseClippingIdentityCutoff, int Xdropcutoff);
+AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, size_t alignmentBandwidth, size_t rampBandwidth, bool quietMode, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState, double preciseClippingIdentityCutoff, int Xdropcutoff, size_t DPRestartStride, size_t DPCheckpointInterval);
+AlignmentResult AlignMultiseed(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, size_t alignmentBandwidth, size_t rampBandwidth, size_t maxCellsPerSlice, bool quietMode, bool sloppyOptimizations, const std::vector<SeedHit>& seedHits, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState, size_t minClusterSize, double seedExtendDensity, double preciseClippingIdentityCutoff, int Xdropcutoff, double multimapScoreFraction);
+AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, size_t alignmentBandwidth, size_t rampBandwidth, size_t maxCellsPerSlice, bool quietMode, bool sloppyOptimizations, const std::vector<SeedHit>& seedHits, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState, size_t minClusterSize, double seedExtendDensity, double preciseClippingIdentityCutoff, int Xdropcutoff, double multimapScoreFraction, double ECutoff, int minAlignmentScore, size_t DPCheckpointInterval, double wavefrontMaxDivergence, bool scoreOnly);
+std::vector<AlignmentResult> AlignShortReadBatch(const AlignmentGraph& graph, const std::vector<std::string>& seq_ids, const std::vector<std::string>& sequences, size_t alignmentBandwidth, size_t rampBandwidth, size_t maxCellsPerSlice, bool quietMode, const std::vector<SeedHit>& seedHits, GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState& reusableState, double preciseClippingIdentityCutoff, int Xdropcutoff);
+AlignmentResult StitchWindows(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, const std::vector<size_t>& windowStarts, std::vector<AlignmentResult>& windowResults, double preciseClippingIdentityCutoff);
 
 void AddAlignment(const std::string& seq_id, const std::string& sequence, AlignmentResult::AlignmentItem& alignment);
 void AddGAFLine(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, AlignmentResult::AlignmentItem& alignment, bool cigarMatchMismatchMerge);
-void AddCorrected(AlignmentResult::AlignmentItem& alignment);
+void AddCorrected(const AlignmentGraph& graph, AlignmentResult::AlignmentItem& alignment);
 void OrderSeeds(const AlignmentGraph& graph, std::vector<SeedHit>& seedHits);
 void PrepareMultiseeds(const AlignmentGraph& graph, std::vector<SeedHit>& seedHits, const size_t seqLen);
 
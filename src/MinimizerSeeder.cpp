@@ -542,6 +542,218 @@ std::vector<SeedHit> MinimizerSeeder::getSeeds(const std::string& sequence, doub
 	return result;
 }
 
+// looks up only every sampleStride'th kmer so off-target reads can be rejected before full seeding
+double MinimizerSeeder::sampledHitFraction(const std::string& sequence, size_t sampleStride) const
+{
+	assert(sampleStride >= 1);
+	size_t sampled = 0;
+	size_t hits = 0;
+	size_t kmerIndex = 0;
+	iterateKmers(sequence, minimizerLength, windowSize, [this, sampleStride, &sampled, &hits, &kmerIndex](size_t pos, size_t kmer)
+	{
+		kmerIndex += 1;
+		if ((kmerIndex - 1) % sampleStride != 0) return;
+		sampled += 1;
+		size_t bucket = getBucket(kmer);
+		assert(bucket < buckets.size());
+		size_t index = buckets[bucket].locator->lookup(kmer);
+		if (index == ULLONG_MAX) return;
+		assert(index < buckets[bucket].kmerCheck.size());
+		if (buckets[bucket].kmerCheck[(size_t)index] != kmer) return;
+		size_t count = getStart(bucket, index+1) - getStart(bucket, index);
+		if (count >= maxCount) return;
+		hits += 1;
+	});
+	if (sampled == 0) return 1.0;
+	return (double)hits / (double)sampled;
+}
+
+// 32bp starting at base pos, same 2-bit packing as AlignmentGraph::NodeChunks
+size_t getPackedBases(const size_t* chunks, size_t numChunks, size_t pos)
+{
+	size_t chunk = pos / AlignmentGraph::BP_IN_CHUNK;
+	size_t shift = (pos % AlignmentGraph::BP_IN_CHUNK) * 2;
+	assert(chunk < numChunks);
+	size_t result = chunks[chunk] >> shift;
+	if (shift > 0 && chunk + 1 < numChunks) result |= chunks[chunk+1] << (sizeof(size_t) * 8 - shift);
+	return result;
+}
+
+size_t lowBasesMask(size_t numBases)
+{
+	assert(numBases <= AlignmentGraph::BP_IN_CHUNK);
+	if (numBases == AlignmentGraph::BP_IN_CHUNK) return ~(size_t)0;
+	return ((size_t)1 << (numBases * 2)) - 1;
+}
+
+// greedy exact match forwards from the cell after (node, offset, seqPos), word at a time within split nodes
+// stops at mismatches, ambiguous nodes and branches where more than one out-neighbor matches
+// node & offset are updated to the last matching cell
+size_t MinimizerSeeder::extendMatchForward(const std::vector<size_t>& readChunks, const std::vector<size_t>& readInvalid, size_t readLength, size_t& node, size_t& offset, size_t seqPos, std::vector<std::pair<size_t, size_t>>& visited) const
+{
+	size_t added = 0;
+	size_t readPos = seqPos + 1;
+	size_t nodeOffset = offset + 1;
+	while (readPos < readLength)
+	{
+		if (node >= graph.firstAmbiguous) break;
+		if (nodeOffset == graph.NodeLength(node))
+		{
+			if ((getPackedBases(readInvalid.data(), readInvalid.size(), readPos) & 3) != 0) break;
+			size_t readBase = getPackedBases(readChunks.data(), readChunks.size(), readPos) & 3;
+			size_t next = std::numeric_limits<size_t>::max();
+			bool ambiguous = false;
+			for (auto neighbor : graph.outNeighbors[node])
+			{
+				if (neighbor >= graph.firstAmbiguous)
+				{
+					ambiguous = true;
+					break;
+				}
+				if ((graph.nodeSequences[neighbor][0] & 3) != readBase) continue;
+				if (next != std::numeric_limits<size_t>::max())
+				{
+					ambiguous = true;
+					break;
+				}
+				next = neighbor;
+			}
+			if (ambiguous || next == std::numeric_limits<size_t>::max()) break;
+			node = next;
+			nodeOffset = 0;
+			visited.emplace_back(node, readPos);
+		}
+		size_t avail = std::min(AlignmentGraph::BP_IN_CHUNK, std::min(graph.NodeLength(node) - nodeOffset, readLength - readPos));
+		size_t mismatch = getPackedBases(graph.nodeSequences[node].s, AlignmentGraph::CHUNKS_IN_NODE, nodeOffset) ^ getPackedBases(readChunks.data(), readChunks.size(), readPos);
+		mismatch |= getPackedBases(readInvalid.data(), readInvalid.size(), readPos);
+		mismatch &= lowBasesMask(avail);
+		if (mismatch == 0)
+		{
+			added += avail;
+			nodeOffset += avail;
+			readPos += avail;
+			continue;
+		}
+		size_t matching = __builtin_ctzll(mismatch) / 2;
+		added += matching;
+		nodeOffset += matching;
+		break;
+	}
+	assert(nodeOffset > 0);
+	offset = nodeOffset - 1;
+	return added;
+}
+
+// greedy exact match backwards, including the cell (node, offset, seqPos) itself
+size_t MinimizerSeeder::extendMatchBackward(const std::vector<size_t>& readChunks, const std::vector<size_t>& readInvalid, size_t node, size_t offset, size_t seqPos, std::vector<std::pair<size_t, size_t>>& visited) const
+{
+	size_t added = 0;
+	size_t readEnd = seqPos + 1;
+	size_t nodeEnd = offset + 1;
+	while (readEnd > 0)
+	{
+		if (node >= graph.firstAmbiguous) break;
+		if (nodeEnd == 0)
+		{
+			if ((getPackedBases(readInvalid.data(), readInvalid.size(), readEnd-1) & 3) != 0) break;
+			size_t readBase = getPackedBases(readChunks.data(), readChunks.size(), readEnd-1) & 3;
+			size_t next = std::numeric_limits<size_t>::max();
+			bool ambiguous = false;
+			for (auto neighbor : graph.inNeighbors[node])
+			{
+				if (neighbor >= graph.firstAmbiguous)
+				{
+					ambiguous = true;
+					break;
+				}
+				if ((getPackedBases(graph.nodeSequences[neighbor].s, AlignmentGraph::CHUNKS_IN_NODE, graph.NodeLength(neighbor)-1) & 3) != readBase) continue;
+				if (next != std::numeric_limits<size_t>::max())
+				{
+					ambiguous = true;
+					break;
+				}
+				next = neighbor;
+			}
+			if (ambiguous || next == std::numeric_limits<size_t>::max()) break;
+			node = next;
+			nodeEnd = graph.NodeLength(node);
+			visited.emplace_back(node, readEnd - nodeEnd);
+		}
+		size_t avail = std::min(AlignmentGraph::BP_IN_CHUNK, std::min(nodeEnd, readEnd));
+		size_t mismatch = getPackedBases(graph.nodeSequences[node].s, AlignmentGraph::CHUNKS_IN_NODE, nodeEnd - avail) ^ getPackedBases(readChunks.data(), readChunks.size(), readEnd - avail);
+		mismatch |= getPackedBases(readInvalid.data(), readInvalid.size(), readEnd - avail);
+		mismatch &= lowBasesMask(avail);
+		if (mismatch == 0)
+		{
+			added += avail;
+			nodeEnd -= avail;
+			readEnd -= avail;
+			continue;
+		}
+		size_t highestMismatch = (sizeof(size_t) * 8 - 1 - __builtin_clzll(mismatch)) / 2;
+		size_t matching = avail - 1 - highestMismatch;
+		added += matching;
+		nodeEnd -= matching;
+		break;
+	}
+	return added;
+}
+
+// minimizer hits grown to maximal exact matches along unambiguous paths in the graph
+// hits inside an already found match are not extended again, and matches are reported once, anchored at their last cell
+std::vector<SeedHit> MinimizerSeeder::getMaximalMatchSeeds(const std::string& sequence, double density) const
+{
+	std::vector<SeedHit> minimizerHits = getSeeds(sequence, density);
+	std::vector<size_t> readChunks;
+	std::vector<size_t> readInvalid;
+	readChunks.resize((sequence.size() + AlignmentGraph::BP_IN_CHUNK - 1) / AlignmentGraph::BP_IN_CHUNK + 1, 0);
+	readInvalid.resize(readChunks.size(), 0);
+	for (size_t i = 0; i < sequence.size(); i++)
+	{
+		size_t chunk = i / AlignmentGraph::BP_IN_CHUNK;
+		size_t shift = (i % AlignmentGraph::BP_IN_CHUNK) * 2;
+		if (validChar[sequence[i]])
+		{
+			readChunks[chunk] |= charToInt(sequence[i]) << shift;
+		}
+		else
+		{
+			readInvalid[chunk] |= (size_t)3 << shift;
+		}
+	}
+	// (split node, read position of node offset 0) -> read range of the match on that diagonal
+	phmap::flat_hash_map<std::pair<size_t, size_t>, std::pair<size_t, size_t>> covered;
+	// (split node << 6 + offset, read position) of match ends
+	phmap::flat_hash_set<std::pair<size_t, size_t>> foundEnds;
+	std::vector<std::pair<size_t, size_t>> visited;
+	std::vector<SeedHit> result;
+	for (const SeedHit& hit : minimizerHits)
+	{
+		size_t node = hit.alignmentGraphNodeId;
+		size_t offset = hit.alignmentGraphNodeOffset;
+		assert(node < graph.NodeSize());
+		assert(offset < graph.NodeLength(node));
+		auto found = covered.find(std::make_pair(node, hit.seqPos - offset));
+		if (found != covered.end() && found->second.first <= hit.seqPos && found->second.second >= hit.seqPos) continue;
+		visited.clear();
+		visited.emplace_back(node, hit.seqPos - offset);
+		size_t backward = extendMatchBackward(readChunks, readInvalid, node, offset, hit.seqPos, visited);
+		size_t forward = extendMatchForward(readChunks, readInvalid, sequence.size(), node, offset, hit.seqPos, visited);
+		size_t matchEnd = hit.seqPos + forward;
+		size_t matchLength = std::max(backward, minimizerLength) + forward;
+		assert(matchLength <= matchEnd + 1);
+		for (auto pos : visited)
+		{
+			covered[pos] = std::make_pair(matchEnd + 1 - matchLength, matchEnd);
+		}
+		assert(offset < 64);
+		if (!foundEnds.emplace((node << 6) + offset, matchEnd).second) continue;
+		result.push_back(matchToSeedHit(node, offset, matchEnd, maxCount - hit.rawSeedGoodness));
+		result.back().matchLen = matchLength;
+	}
+	return result;
+}
+
 SeedHit MinimizerSeeder::matchToSeedHit(int nodeId, size_t nodeOffset, size_t seqPos, int count) const
 {
 	assert(nodeId >= 0);
@@ -31,12 +31,16 @@ class MinimizerSeeder
 public:
 	MinimizerSeeder(const AlignmentGraph& graph, size_t minimizerLength, size_t windowSize, size_t numThreads, double keepLeastFrequentFraction);
 	std::vector<SeedHit> getSeeds(const std::string& sequence, double density) const;
+	double sampledHitFraction(const std::string& sequence, size_t sampleStride) const;
+	std::vector<SeedHit> getMaximalMatchSeeds(const std::string& sequence, double density) const;
 	bool canSeed() const;
 private:
 	void addMinimizers(std::vector<SeedHit>& result, std::vector<std::tuple<size_t, size_t, size_t, size_t>>& matchIndices, size_t maxCount) const;
 	size_t getStart(size_t bucket, size_t index) const;
 	size_t getBucket(size_t hash) const;
 	SeedHit matchToSeedHit(int nodeId, size_t nodeOffset, size_t seqPos, int count) const;
+	size_t extendMatchForward(const std::vector<size_t>& readChunks, const std::vector<size_t>& readInvalid, size_t readLength, size_t& node, size_t& offset, size_t seqPos, std::vector<std::pair<size_t, size_t>>& visited) const;
+	size_t extendMatchBackward(const std::vector<size_t>& readChunks, const std::vector<size_t>& readInvalid, size_t node, size_t offset, size_t seqPos, std::vector<std::pair<size_t, size_t>>& visited) const;
 	void initMinimizers(size_t numThreads);
 	void initMaxCount(double keepLeastFrequentFraction);
 	const AlignmentGraph& graph;
@@ -1,6 +1,11 @@
 #ifndef NodeSlice_h
 #define NodeSlice_h
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <limits>
 #include <unordered_map>
@@ -10,6 +15,7 @@
 #include "AlignmentGraph.h"
 #include "ThreadReadAssertion.h"
 #include "WordSlice.h"
+#include "SliceArena.h"
 
 
 template <typename LengthType, typename ScoreType, typename Word>
@@ -51,8 +57,230 @@ class NodeSlice
 {
 public:
 	using NodeSliceMapItem = NodeSliceMapItemStruct<LengthType, ScoreType, Word>;
-	using MapType = phmap::flat_hash_map<size_t, NodeSliceMapItem>;
+	using MapType = phmap::flat_hash_map<size_t, NodeSliceMapItem, phmap::Hash<size_t>, phmap::EqualTo<size_t>, ArenaAllocator<std::pair<const size_t, NodeSliceMapItem>>>;
 	using MapItem = NodeSliceMapItem;
+	//finalized slices kept in the DP table can be packed into a single byte buffer
+	//nodes are sorted by id and delta coded, words are tagged as zero / all ones / varint / complemented varint
+	//and scores are zigzag varints relative to the slice minimum
+	//lookups decode the whole slice into a small per-thread cache of recently used slices and copy the node out of it
+	struct PackedNodes
+	{
+		static constexpr size_t NumWords = 4 + 2 * NodeSliceMapItem::NUM_CHUNKS;
+		static constexpr size_t HeaderSize = sizeof(uint32_t) + 2 * sizeof(int64_t);
+		static constexpr size_t DecodedSlots = 8;
+		static std::shared_ptr<const uint8_t[]> pack(const MapType& nodes)
+		{
+			static std::atomic<uint64_t> nextSerial { 1 };
+			thread_local std::vector<std::pair<size_t, const NodeSliceMapItem*>> order;
+			thread_local std::vector<uint8_t> buffer;
+			order.clear();
+			buffer.clear();
+			int64_t baseScore = std::numeric_limits<ScoreType>::max();
+			for (const auto& pair : nodes)
+			{
+				order.emplace_back(pair.first, &pair.second);
+				baseScore = std::min(baseScore, (int64_t)pair.second.minScore);
+			}
+			std::sort(order.begin(), order.end());
+			assert(order.size() < std::numeric_limits<uint32_t>::max());
+			uint32_t numNodes = order.size();
+			uint64_t serial = nextSerial++;
+			buffer.resize(HeaderSize);
+			memcpy(buffer.data(), &numNodes, sizeof(uint32_t));
+			memcpy(buffer.data() + sizeof(uint32_t), &baseScore, sizeof(int64_t));
+			memcpy(buffer.data() + sizeof(uint32_t) + sizeof(int64_t), &serial, sizeof(uint64_t));
+			for (size_t i = 0; i < order.size(); i++)
+			{
+				encode(buffer, order[i].first, i > 0 ? order[i-1].first : 0, *order[i].second, baseScore);
+			}
+			std::shared_ptr<uint8_t[]> result { new uint8_t[buffer.size()] };
+			memcpy(result.get(), buffer.data(), buffer.size());
+			return result;
+		}
+		static size_t numNodes(const uint8_t* packed)
+		{
+			return readFixed<uint32_t>(packed);
+		}
+		//decodes the node at offset, current holds the previous node
+		static size_t decodeNext(const uint8_t* packed, size_t offset, std::pair<size_t, NodeSliceMapItem>& current)
+		{
+			if (offset == 0)
+			{
+				current.first = 0;
+				offset = HeaderSize;
+			}
+			int64_t baseScore = readFixed<int64_t>(packed + sizeof(uint32_t));
+			const uint8_t* pos = packed + offset;
+			size_t idAndExists = readVarint<size_t>(pos);
+			current.first += idAndExists >> 1;
+			NodeSliceMapItem& item = current.second;
+			item.exists = idAndExists & 1;
+			const uint8_t* tags = pos;
+			pos += (NumWords + 3) / 4;
+			for (size_t i = 0; i < NumWords; i++)
+			{
+				switch((tags[i / 4] >> ((i % 4) * 2)) & 3)
+				{
+					case 0:
+						getWord(item, i) = WordConfiguration<Word>::AllZeros;
+						break;
+					case 1:
+						getWord(item, i) = WordConfiguration<Word>::AllOnes;
+						break;
+					case 2:
+						getWord(item, i) = readVarint<Word>(pos);
+						break;
+					case 3:
+						getWord(item, i) = ~readVarint<Word>(pos);
+						break;
+				}
+			}
+			item.minScore = unzigzag(readVarint<uint64_t>(pos), baseScore);
+			item.startSlice.scoreEnd = unzigzag(readVarint<uint64_t>(pos), baseScore);
+			item.endSlice.scoreEnd = unzigzag(readVarint<uint64_t>(pos), baseScore);
+#ifdef SLICEVERBOSE
+			item.firstSlicesCalcedWhenCalced = readVarint<size_t>(pos);
+			item.slicesCalcedWhenCalced = readVarint<size_t>(pos);
+#endif
+			return pos - packed;
+		}
+		static bool find(const uint8_t* packed, size_t nodeIndex, NodeSliceMapItem& result)
+		{
+			auto& nodes = decoded(packed);
+			auto found = std::lower_bound(nodes.begin(), nodes.end(), nodeIndex, [](const std::pair<size_t, NodeSliceMapItem>& item, size_t index) { return item.first < index; });
+			if (found == nodes.end() || found->first != nodeIndex) return false;
+			result = found->second;
+			return true;
+		}
+	private:
+		struct DecodedSlice
+		{
+			uint64_t serial = 0;
+			size_t lastUse = 0;
+			std::vector<std::pair<size_t, NodeSliceMapItem>> nodes;
+		};
+		static std::vector<std::pair<size_t, NodeSliceMapItem>>& decoded(const uint8_t* packed)
+		{
+			thread_local std::array<DecodedSlice, DecodedSlots> slots;
+			thread_local size_t useCounter = 0;
+			uint64_t serial = readFixed<uint64_t>(packed + sizeof(uint32_t) + sizeof(int64_t));
+			useCounter++;
+			size_t victim = 0;
+			for (size_t i = 0; i < DecodedSlots; i++)
+			{
+				if (slots[i].serial == serial)
+				{
+					slots[i].lastUse = useCounter;
+					return slots[i].nodes;
+				}
+				if (slots[i].lastUse < slots[victim].lastUse) victim = i;
+			}
+			DecodedSlice& slot = slots[victim];
+			slot.serial = serial;
+			slot.lastUse = useCounter;
+			slot.nodes.resize(numNodes(packed));
+			size_t offset = 0;
+			for (size_t i = 0; i < slot.nodes.size(); i++)
+			{
+				if (i > 0) slot.nodes[i].first = slot.nodes[i-1].first;
+				offset = decodeNext(packed, offset, slot.nodes[i]);
+			}
+			return slot.nodes;
+		}
+		static void encode(std::vector<uint8_t>& out, size_t nodeIndex, size_t previousIndex, const NodeSliceMapItem& item, int64_t baseScore)
+		{
+			assert(nodeIndex >= previousIndex);
+			writeVarint<size_t>(out, ((nodeIndex - previousIndex) << 1) | (item.exists ? 1 : 0));
+			size_t tagStart = out.size();
+			out.resize(out.size() + (NumWords + 3) / 4, 0);
+			for (size_t i = 0; i < NumWords; i++)
+			{
+				Word word = getWord(item, i);
+				uint8_t tag;
+				if (word == WordConfiguration<Word>::AllZeros)
+				{
+					tag = 0;
+				}
+				else if (word == WordConfiguration<Word>::AllOnes)
+				{
+					tag = 1;
+				}
+				else if (word <= (Word)~word)
+				{
+					tag = 2;
+					writeVarint<Word>(out, word);
+				}
+				else
+				{
+					tag = 3;
+					writeVarint<Word>(out, ~word);
+				}
+				out[tagStart + i / 4] |= tag << ((i % 4) * 2);
+			}
+			writeVarint<uint64_t>(out, zigzag(item.minScore, baseScore));
+			writeVarint<uint64_t>(out, zigzag(item.startSlice.scoreEnd, baseScore));
+			writeVarint<uint64_t>(out, zigzag(item.endSlice.scoreEnd, baseScore));
+#ifdef SLICEVERBOSE
+			writeVarint<size_t>(out, item.firstSlicesCalcedWhenCalced);
+			writeVarint<size_t>(out, item.slicesCalcedWhenCalced);
+#endif
+		}
+		template <typename T>
+		static T readFixed(const uint8_t* pos)
+		{
+			T result;
+			memcpy(&result, pos, sizeof(T));
+			return result;
+		}
+		template <typename T>
+		static void writeVarint(std::vector<uint8_t>& out, T value)
+		{
+			while (value >= 0x80)
+			{
+				out.push_back((uint8_t)(value & 0x7F) | 0x80);
+				value >>= 7;
+			}
+			out.push_back((uint8_t)value);
+		}
+		template <typename T>
+		static T readVarint(const uint8_t*& pos)
+		{
+			T result = 0;
+			size_t shift = 0;
+			while (*pos & 0x80)
+			{
+				result |= (T)(*pos & 0x7F) << shift;
+				shift += 7;
+				pos++;
+			}
+			result |= (T)*pos << shift;
+			pos++;
+			return result;
+		}
+		static uint64_t zigzag(ScoreType score, int64_t baseScore)
+		{
+			int64_t diff = (int64_t)score - baseScore;
+			return ((uint64_t)diff << 1) ^ (uint64_t)(diff >> 63);
+		}
+		static ScoreType unzigzag(uint64_t value, int64_t baseScore)
+		{
+			int64_t diff = (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+			return (ScoreType)(diff + baseScore);
+		}
+		static Word& getWord(NodeSliceMapItem& item, size_t index)
+		{
+			if (index == 0) return item.startSlice.VP;
+			if (index == 1) return item.startSlice.VN;
+			if (index == 2) return item.endSlice.VP;
+			if (index == 3) return item.endSlice.VN;
+			if (index < 4 + NodeSliceMapItem::NUM_CHUNKS) return item.HP[index - 4];
+			return item.HN[index - 4 - NodeSliceMapItem::NUM_CHUNKS];
+		}
+		static Word getWord(const NodeSliceMapItem& item, size_t index)
+		{
+			return getWord(const_cast<NodeSliceMapItem&>(item), index);
+		}
+	};
 	class NodeSliceIterator : std::iterator<std::forward_iterator_tag, std::pair<size_t, MapItem>>
 	{
 		using map_iterator = typename MapType::iterator;
@@ -60,15 +288,26 @@ public:
 		template <bool HasVectorMap = UseVectorMap>
 		NodeSliceIterator(NodeSlice* slice, typename std::enable_if<!HasVectorMap, map_iterator>::type pos) :
 		slice(slice),
-		mappos(pos)
+		mappos(pos),
+		packed(nullptr)
 		{
 		}
 		template <bool HasVectorMap = UseVectorMap>
 		NodeSliceIterator(NodeSlice* slice, typename std::enable_if<HasVectorMap, size_t>::type indexPos) :
 		slice(slice),
-		indexPos(indexPos)
+		indexPos(indexPos),
+		packed(nullptr)
 		{
 		}
+		NodeSliceIterator(NodeSlice* slice, const uint8_t* packed, size_t ordinal) :
+		slice(slice),
+		packed(packed),
+		packedOrdinal(ordinal),
+		packedOffset(0),
+		packedCurrent()
+		{
+			if (packedOrdinal < PackedNodes::numNodes(packed)) packedOffset = PackedNodes::decodeNext(packed, packedOffset, packedCurrent);
+		}
 		template <bool HasVectorMap = UseVectorMap>
 		typename std::enable_if<HasVectorMap, std::pair<size_t, MapItem>>::type operator*()
 		{
@@ -79,6 +318,7 @@ public:
 		template <bool HasVectorMap = UseVectorMap>
 		typename std::enable_if<!HasVectorMap, std::pair<size_t, MapItem>>::type operator*()
 		{
+			if (packed != nullptr) return packedCurrent;
 			return std::make_pair(mappos->first, mappos->second);
 		}
 		template <bool HasVectorMap = UseVectorMap>
@@ -91,6 +331,7 @@ public:
 		template <bool HasVectorMap = UseVectorMap>
 		typename std::enable_if<!HasVectorMap, std::pair<size_t, const MapItem>>::type operator*() const
 		{
+			if (packed != nullptr) return packedCurrent;
 			return std::make_pair(mappos->first, mappos->second);
 		}
 		template <bool HasVectorMap = UseVectorMap>
@@ -102,6 +343,12 @@ public:
 		template <bool HasVectorMap = UseVectorMap>
 		typename std::enable_if<!HasVectorMap, NodeSliceIterator&>::type operator++()
 		{
+			if (packed != nullptr)
+			{
+				packedOrdinal++;
+				if (packedOrdinal < PackedNodes::numNodes(packed)) packedOffset = PackedNodes::decodeNext(packed, packedOffset, packedCurrent);
+				return *this;
+			}
 			++mappos;
 			return *this;
 		}
@@ -115,6 +362,7 @@ public:
 		typename std::enable_if<!HasVectorMap, bool>::type operator==(const NodeSliceIterator& other) const
 		{
 			assert(slice == other.slice);
+			if (packed != nullptr) return packedOrdinal == other.packedOrdinal;
 			return mappos == other.mappos;
 		}
 		bool operator!=(const NodeSliceIterator& other) const
@@ -125,6 +373,10 @@ public:
 		NodeSlice* slice;
 		map_iterator mappos;
 		size_t indexPos;
+		const uint8_t* packed;
+		size_t packedOrdinal;
+		size_t packedOffset;
+		std::pair<size_t, MapItem> packedCurrent;
 	};
 	class NodeSliceConstIterator : std::iterator<std::forward_iterator_tag, const std::pair<size_t, MapItem>>
 	{
@@ -133,15 +385,26 @@ public:
 		template <bool HasVectorMap = UseVectorMap>
 		NodeSliceConstIterator(const NodeSlice* slice, typename std::enable_if<!HasVectorMap, map_iterator>::type pos) :
 		slice(slice),
-		mappos(pos)
+		mappos(pos),
+		packed(nullptr)
 		{
 		}
 		template <bool HasVectorMap = UseVectorMap>
 		NodeSliceConstIterator(const NodeSlice* slice, typename std::enable_if<HasVectorMap, size_t>::type indexPos) :
 		slice(slice),
-		indexPos(indexPos)
+		indexPos(indexPos),
+		packed(nullptr)
 		{
 		}
+		NodeSliceConstIterator(const NodeSlice* slice, const uint8_t* packed, size_t ordinal) :
+		slice(slice),
+		packed(packed),
+		packedOrdinal(ordinal),
+		packedOffset(0),
+		packedCurrent()
+		{
+			if (packedOrdinal < PackedNodes::numNodes(packed)) packedOffset = PackedNodes::decodeNext(packed, packedOffset, packedCurrent);
+		}
 		template <bool HasVectorMap = UseVectorMap>
 		typename std::enable_if<HasVectorMap, const std::pair<size_t, const MapItem>>::type operator*() const
 		{
@@ -152,6 +415,7 @@ public:
 		template <bool HasVectorMap = UseVectorMap>
 		typename std::enable_if<!HasVectorMap, const std::pair<size_t, const MapItem>>::type operator*() const
 		{
+			if (packed != nullptr) return packedCurrent;
 			return std::make_pair(mappos->first, mappos->second);
 		}
 		template <bool HasVectorMap = UseVectorMap>
@@ -163,6 +427,12 @@ public:
 		template <bool HasVectorMap = UseVectorMap>
 		typename std::enable_if<!HasVectorMap, NodeSliceConstIterator&>::type operator++()
 		{
+			if (packed != nullptr)
+			{
+				packedOrdinal++;
+				if (packedOrdinal < PackedNodes::numNodes(packed)) packedOffset = PackedNodes::decodeNext(packed, packedOffset, packedCurrent);
+				return *this;
+			}
 			++mappos;
 			return *this;
 		}
@@ -176,6 +446,7 @@ public:
 		typename std::enable_if<!HasVectorMap, bool>::type operator==(const NodeSliceConstIterator& other) const
 		{
 			assert(slice == other.slice);
+			if (packed != nullptr) return packedOrdinal == other.packedOrdinal;
 			return mappos == other.mappos;
 		}
 		bool operator!=(const NodeSliceConstIterator& other) const
@@ -186,30 +457,63 @@ public:
 		const NodeSlice* slice;
 		map_iterator mappos;
 		size_t indexPos;
+		const uint8_t* packed;
+		size_t packedOrdinal;
+		size_t packedOffset;
+		std::pair<size_t, MapItem> packedCurrent;
 	};
 	NodeSlice() :
 	vectorMap(nullptr),
-	nodes(nullptr)
+	nodes(nullptr),
+	packed(nullptr),
+	arena(nullptr)
 	{
 	}
 	template <bool HasVectorMap = UseVectorMap>
 	NodeSlice(typename std::enable_if<HasVectorMap, std::vector<NodeSliceMapItem>*>::type vectorMap) :
 	vectorMap(vectorMap),
-	nodes(nullptr)
+	nodes(nullptr),
+	packed(nullptr),
+	arena(nullptr)
 	{
 	}
-	void addEmptyNodeMap(size_t size)
+	void addEmptyNodeMap(size_t size, SliceArena* arena)
 	{
 		assert(nodes == nullptr);
-		nodes = std::make_shared<MapType>();
+		this->arena = arena;
+		nodes = makeNodeMap();
 		nodes->reserve(size);
 	}
+	SliceArena* getArena() const
+	{
+		return arena;
+	}
+	//uses the node map of other, which must not be modified while shared. slices calculated from this one allocate from arena
+	void shareNodeMap(const NodeSlice& other, SliceArena* arena)
+	{
+		assert(nodes == nullptr);
+		assert(other.nodes != nullptr);
+		this->arena = arena;
+		nodes = other.nodes;
+	}
+	//replaces the node map with its packed encoding, other slices sharing the map are not affected
+	template <bool HasVectorMap = UseVectorMap>
+	typename std::enable_if<!HasVectorMap>::type pack()
+	{
+		assert(nodes != nullptr);
+		packed = PackedNodes::pack(*nodes);
+		nodes = nullptr;
+	}
+	bool isPacked() const
+	{
+		return packed != nullptr;
+	}
 	template <bool HasVectorMap = UseVectorMap>
 	typename std::enable_if<HasVectorMap, NodeSlice<LengthType, ScoreType, Word, false>>::type getMapSlice() const
 	{
 		assert(vectorMap != nullptr);
 		NodeSlice<LengthType, ScoreType, Word, false> result;
-		result.addEmptyNodeMap(activeVectorMapIndices.size());
+		result.addEmptyNodeMap(activeVectorMapIndices.size(), arena);
 		for (auto index : activeVectorMapIndices)
 		{
 			assert((*vectorMap)[index].exists);
@@ -261,9 +565,11 @@ public:
 		assert(nodeIndex < vectorMap->size());
 		return (*vectorMap)[nodeIndex];
 	}
+	//packed slices are read only, use the const overload
 	template <bool HasVectorMap = UseVectorMap>
 	typename std::enable_if<!HasVectorMap, NodeSliceMapItem&>::type node(size_t nodeIndex)
 	{
+		assert(packed == nullptr);
 		assert(nodes != nullptr);
 		auto found = nodes->find(nodeIndex);
 		assert(found != nodes->end());
@@ -276,9 +582,17 @@ public:
 		assert(nodeIndex < vectorMap->size());
 		return (*vectorMap)[nodeIndex];
 	}
+	//by value since packed slices don't store the items
 	template <bool HasVectorMap = UseVectorMap>
-	typename std::enable_if<!HasVectorMap, const NodeSliceMapItem&>::type node(size_t nodeIndex) const
+	typename std::enable_if<!HasVectorMap, NodeSliceMapItem>::type node(size_t nodeIndex) const
 	{
+		if (packed != nullptr)
+		{
+			NodeSliceMapItem result;
+			bool found = findPacked(nodeIndex, result);
+			assert(found);
+			return result;
+		}
 		assert(nodes != nullptr);
 		auto found = nodes->find(nodeIndex);
 		assert(found != nodes->end());
@@ -294,6 +608,13 @@ public:
 	template <bool HasVectorMap = UseVectorMap>
 	typename std::enable_if<!HasVectorMap, bool>::type hasNode(size_t nodeIndex) const
 	{
+		if (packed != nullptr)
+		{
+			NodeSliceMapItem found;
+			if (!findPacked(nodeIndex, found)) return false;
+			assert(found.exists);
+			return true;
+		}
 		assert(nodes != nullptr);
 		auto found = nodes->find(nodeIndex);
 		if (found == nodes->end()) return false;
@@ -322,7 +643,7 @@ public:
 		{
 			if (item.second.exists) newActiveMapItems.push_back(item);
 		}
-		nodes = std::make_shared<MapType>();
+		nodes = makeNodeMap();
 		nodes->resize(newActiveMapItems.size());
 		for (auto item : newActiveMapItems)
 		{
@@ -351,6 +672,7 @@ public:
 	template <bool HasVectorMap = UseVectorMap>
 	typename std::enable_if<!HasVectorMap, size_t>::type size() const
 	{
+		if (packed != nullptr) return PackedNodes::numNodes(packed.get());
 		assert(nodes != nullptr);
 		return nodes->size();
 	}
@@ -363,6 +685,7 @@ public:
 	template <bool HasVectorMap = UseVectorMap>
 	typename std::enable_if<!HasVectorMap, NodeSliceIterator>::type begin()
 	{
+		if (packed != nullptr) return NodeSliceIterator { this, packed.get(), 0 };
 		assert(nodes != nullptr);
 		return NodeSliceIterator { this, nodes->begin() };
 	}
@@ -375,6 +698,7 @@ public:
 	template <bool HasVectorMap = UseVectorMap>
 	typename std::enable_if<!HasVectorMap, NodeSliceIterator>::type end()
 	{
+		if (packed != nullptr) return NodeSliceIterator { this, packed.get(), PackedNodes::numNodes(packed.get()) };
 		assert(nodes != nullptr);
 		return NodeSliceIterator { this, nodes->end() };
 	}
@@ -387,6 +711,7 @@ public:
 	template <bool HasVectorMap = UseVectorMap>
 	typename std::enable_if<!HasVectorMap, NodeSliceConstIterator>::type begin() const
 	{
+		if (packed != nullptr) return NodeSliceConstIterator { this, packed.get(), 0 };
 		assert(nodes != nullptr);
 		return NodeSliceConstIterator { this, nodes->begin() };
 	}
@@ -399,6 +724,7 @@ public:
 	template <bool HasVectorMap = UseVectorMap>
 	typename std::enable_if<!HasVectorMap, NodeSliceConstIterator>::type end() const
 	{
+		if (packed != nullptr) return NodeSliceConstIterator { this, packed.get(), PackedNodes::numNodes(packed.get()) };
 		assert(nodes != nullptr);
 		return NodeSliceConstIterator { this, nodes->end() };
 	}
@@ -407,6 +733,16 @@ public:
 		return vectorMap != nullptr;
 	}
 private:
+	bool findPacked(size_t nodeIndex, NodeSliceMapItem& result) const
+	{
+		assert(packed != nullptr);
+		return PackedNodes::find(packed.get(), nodeIndex, result);
+	}
+	std::shared_ptr<MapType> makeNodeMap() const
+	{
+		ArenaAllocator<std::pair<const size_t, NodeSliceMapItem>> allocator { arena };
+		return std::allocate_shared<MapType>(ArenaAllocator<MapType> { arena }, 0, phmap::Hash<size_t>{}, phmap::EqualTo<size_t>{}, allocator);
+	}
 	template <bool HasVectorMap = UseVectorMap>
 	typename std::enable_if<HasVectorMap>::type clearVectorMap()
 	{
@@ -420,6 +756,8 @@ private:
 	std::vector<NodeSliceMapItem>* vectorMap;
 	std::vector<size_t> activeVectorMapIndices;
 	std::shared_ptr<MapType> nodes;
+	std::shared_ptr<const uint8_t[]> packed;
+	SliceArena* arena;
 	friend class NodeSliceIterator;
 	friend class NodeSliceConstIterator;
 	friend class NodeSlice<LengthType, ScoreType, Word, true>;
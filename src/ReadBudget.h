@@ -0,0 +1,66 @@
+#ifndef ReadBudget_h
+#define ReadBudget_h
+
+#include <chrono>
+#include <cstddef>
+#include <limits>
+
+//per-read effort limits, started by the caller for each read
+//the aligner stops extending once either limit runs out and keeps what it has so far
+class ReadBudget
+{
+public:
+	using Clock = std::chrono::steady_clock;
+	ReadBudget() :
+	deadline(Clock::time_point::max()),
+	maxCells(std::numeric_limits<size_t>::max()),
+	cellsUsed(0),
+	outOfBudget(false)
+	{
+	}
+	//zero means no limit
+	void start(double maxSeconds, size_t maxCells)
+	{
+		deadline = Clock::time_point::max();
+		if (maxSeconds > 0) deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(maxSeconds));
+		this->maxCells = maxCells > 0 ? maxCells : std::numeric_limits<size_t>::max();
+		cellsUsed = 0;
+		outOfBudget = false;
+	}
+	//returns false once the budget has run out
+	bool spend(size_t cells)
+	{
+		cellsUsed += cells;
+		return !exhausted();
+	}
+	//checks the limits, callers stop their work when this returns true
+	bool exhausted()
+	{
+		if (outOfBudget) return true;
+		if (cellsUsed >= maxCells) outOfBudget = true;
+		else if (deadline != Clock::time_point::max() && Clock::now() >= deadline) outOfBudget = true;
+		return outOfBudget;
+	}
+	//true only if some check above has returned exhausted, so the read's work was actually cut short
+	bool stoppedWork() const
+	{
+		return outOfBudget;
+	}
+	//takes the cells spent by a task's copy of this budget since the copy was made, without checking the limits
+	void chargeTask(const ReadBudget& taskBudget, size_t cellsBefore)
+	{
+		cellsUsed += taskBudget.cellsUsed - cellsBefore;
+		if (taskBudget.outOfBudget) outOfBudget = true;
+	}
+	size_t cells() const
+	{
+		return cellsUsed;
+	}
+private:
+	Clock::time_point deadline;
+	size_t maxCells;
+	size_t cellsUsed;
+	bool outOfBudget;
+};
+
+#endif
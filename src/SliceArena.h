@@ -0,0 +1,159 @@
+#ifndef SliceArena_h
+#define SliceArena_h
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "ThreadReadAssertion.h"
+
+//per-thread memory for the DP slice containers
+//freed blocks are recycled by power-of-two size class, and once everything is freed
+//(after each DP table is discarded) the arena rewinds in O(1) while keeping its chunks
+class SliceArena
+{
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+	struct Chunk
+	{
+		Chunk(size_t size) :
+		data(new char[size]),
+		size(size)
+		{}
+		std::unique_ptr<char[]> data;
+		size_t size;
+	};
+public:
+	static constexpr size_t MaxAlignment = 16;
+	SliceArena() :
+	chunks(),
+	currentChunk(0),
+	chunkUsed(0),
+	outstanding(0)
+	{
+		std::fill(freeLists, freeLists + NumSizeClasses, nullptr);
+	}
+	SliceArena(const SliceArena& other) = delete;
+	SliceArena& operator=(const SliceArena& other) = delete;
+	~SliceArena()
+	{
+		assert(outstanding == 0);
+	}
+	void* allocate(size_t bytes)
+	{
+		size_t sizeClass = getSizeClass(bytes);
+		outstanding++;
+		if (freeLists[sizeClass] != nullptr)
+		{
+			FreeBlock* block = freeLists[sizeClass];
+			freeLists[sizeClass] = block->next;
+			return block;
+		}
+		return bump((size_t)1 << sizeClass);
+	}
+	void deallocate(void* ptr, size_t bytes)
+	{
+		assert(outstanding > 0);
+		outstanding--;
+		if (outstanding == 0)
+		{
+			rewind();
+			return;
+		}
+		size_t sizeClass = getSizeClass(bytes);
+		FreeBlock* block = (FreeBlock*)ptr;
+		block->next = freeLists[sizeClass];
+		freeLists[sizeClass] = block;
+	}
+	size_t reservedBytes() const
+	{
+		size_t result = 0;
+		for (const auto& chunk : chunks) result += chunk.size;
+		return result;
+	}
+private:
+	static constexpr size_t MinSizeClass = 4;
+	static constexpr size_t NumSizeClasses = 64;
+	static constexpr size_t MinChunkSize = 1 << 20;
+	static size_t getSizeClass(size_t bytes)
+	{
+		static_assert(((size_t)1 << MinSizeClass) >= MaxAlignment);
+		static_assert(((size_t)1 << MinSizeClass) >= sizeof(FreeBlock));
+		if (bytes <= ((size_t)1 << MinSizeClass)) return MinSizeClass;
+		return 64 - __builtin_clzll(bytes - 1);
+	}
+	void* bump(size_t bytes)
+	{
+		while (currentChunk < chunks.size() && chunkUsed + bytes > chunks[currentChunk].size)
+		{
+			currentChunk++;
+			chunkUsed = 0;
+		}
+		if (currentChunk == chunks.size())
+		{
+			chunks.emplace_back(std::max(MinChunkSize, bytes));
+		}
+		void* result = chunks[currentChunk].data.get() + chunkUsed;
+		chunkUsed += bytes;
+		return result;
+	}
+	void rewind()
+	{
+		currentChunk = 0;
+		chunkUsed = 0;
+		std::fill(freeLists, freeLists + NumSizeClasses, nullptr);
+	}
+	std::vector<Chunk> chunks;
+	size_t currentChunk;
+	size_t chunkUsed;
+	size_t outstanding;
+	FreeBlock* freeLists[NumSizeClasses];
+};
+
+//falls back to the global allocator when there is no arena
+template <typename T>
+class ArenaAllocator
+{
+public:
+	using value_type = T;
+	ArenaAllocator() :
+	arena(nullptr)
+	{}
+	ArenaAllocator(SliceArena* arena) :
+	arena(arena)
+	{}
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) :
+	arena(other.arena)
+	{}
+	T* allocate(size_t n)
+	{
+		static_assert(alignof(T) <= SliceArena::MaxAlignment);
+		if (arena == nullptr) return std::allocator<T>{}.allocate(n);
+		return (T*)arena->allocate(n * sizeof(T));
+	}
+	void deallocate(T* ptr, size_t n)
+	{
+		if (arena == nullptr)
+		{
+			std::allocator<T>{}.deallocate(ptr, n);
+			return;
+		}
+		arena->deallocate(ptr, n * sizeof(T));
+	}
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& other) const
+	{
+		return arena == other.arena;
+	}
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const
+	{
+		return arena != other.arena;
+	}
+	SliceArena* arena;
+};
+
+#endif
@@ -1,6 +1,41 @@
 #ifndef WordSlice_h
 #define WordSlice_h
 
+//the node calculation kernel is compiled for each level, GraphAlignerBitvectorBanded picks one when it's constructed
+class CPUFeatures
+{
+public:
+	enum class KernelLevel
+	{
+		Baseline,
+		Popcnt,
+		AVX2
+	};
+#if defined(__x86_64__) && !defined(NOBUILTINPOPCOUNT)
+	static inline const KernelLevel Level = []()
+	{
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("popcnt") == 0) return KernelLevel::Baseline;
+		if (__builtin_cpu_supports("avx2") == 0) return KernelLevel::Popcnt;
+		return KernelLevel::AVX2;
+	}();
+#else
+	static constexpr KernelLevel Level = KernelLevel::Baseline;
+#endif
+	static const char* KernelName()
+	{
+		switch(Level)
+		{
+			case KernelLevel::AVX2:
+				return "avx2";
+			case KernelLevel::Popcnt:
+				return "popcnt";
+			default:
+				return "baseline";
+		}
+	}
+};
+
 template <typename Word>
 class WordConfiguration
 {
@@ -25,26 +60,18 @@ public:
 	//positions of the least significant bits for each chunk
 	static constexpr uint64_t LSBMask = 0x0101010101010101;
 
-#ifdef NOBUILTINPOPCOUNT
+#ifdef NDEBUG
+	__attribute__((always_inline))
+#endif
 	static int popcount(uint64_t x)
 	{
 		//https://en.wikipedia.org/wiki/Hamming_weight
+		//gcc and clang recognize this and emit popcnt in functions compiled for a CPU which has it
 		x -= (x >> 1) & 0x5555555555555555;
 		x = (x & 0x3333333333333333) + ((x >> 2) & 0x3333333333333333);
 		x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0f;
 		return (x * 0x0101010101010101) >> 56;
 	}
-#else
-	static int popcount(uint64_t x)
-	{
-		//https://gcc.gnu.org/onlinedocs/gcc-4.8.4/gcc/X86-Built-in-Functions.html
-		// return __builtin_popcountll(x);
-		//for some reason __builtin_popcount takes 21 instructions so call assembly directly
-		__asm__("popcnt %0, %0" : "+r" (x));
-		return x;
-	}
-#endif
-
 
 	static uint64_t ChunkPopcounts(uint64_t value)
 	{
@@ -55,60 +82,6 @@ public:
 		return x;
 	}
 
-	static int BitPosition(uint64_t low, uint64_t high, int rank)
-	{
-		assert(rank >= 0);
-		if (popcount(low) <= rank)
-		{
-			rank -= popcount(low);
-			return 64 + BitPosition(high, rank);
-		}
-		return BitPosition(low, rank);
-	}
-
-	static int BitPosition(uint64_t number, int rank)
-	{
-		// // https://stackoverflow.com/questions/45482787/how-to-efficiently-find-the-n-th-set-bit
-		// uint64_t j = _pdep_u64(1 << rank, number);
-		// return (__builtin_ctz(j));
-		uint64_t bytes = ChunkPopcounts(number);
-		//cumulative popcount of each byte
-		uint64_t cumulative = bytes * PrefixSumMultiplierConstant;
-		//spread the rank into each byte
-		uint64_t rankFinder = ((rank + 1) & 0xFF) * PrefixSumMultiplierConstant;
-		//rankMask's msb will be 0 if the c. popcount at that byte is < rank, or 1 if >= rank
-		uint64_t rankMask = (cumulative | SignMask) - rankFinder;
-		//the total number of ones in rankMask is the number of bytes whose c. popcount is >= rank
-		//8 - that is the number of bytes whose c. popcount is < rank
-		int smallerBytes = 8 - ((((rankMask & SignMask) >> 7) * PrefixSumMultiplierConstant) >> 56);
-		assert(smallerBytes < 8);
-		//the bit position will be inside this byte
-		uint64_t interestingByte = (number >> (smallerBytes * 8)) & 0xFF;
-		if (smallerBytes > 0) rank -= (cumulative >> ((smallerBytes - 1) * 8)) & 0xFF;
-		assert(rank >= 0 && rank < 8);
-		//spread the 1's from interesting byte to each byte
-		//first put every pair of bits into each 2-byte boundary
-		//then select only those pairs
-		//then spread the pairs into each byte boundary
-		//and select the ones
-		uint64_t spreadBits = (((interestingByte * 0x0000040010004001) & 0x0003000300030003) * 0x0000000000000081) & 0x0101010101010101;
-/*
-0000 0000  0000 0000  0000 0000  0000 0000  0000 0000  0000 0000  0000 0000  abcd efgh
-0000 0000  0000 00ab  cdef gh00  0000 abcd  efgh 0000  00ab cdef  gh00 0000  abcd efgh  * 0x0000040010004001
-0000 0000  0000 00ab  0000 0000  0000 00cd  0000 0000  0000 00ef  0000 0000  0000 00gh  & 0x0003000300030003
-0000 000a  b000 00ab  0000 000c  d000 00cd  0000 000e  f000 00ef  0000 000g  h000 00gh  * 0x0000000000000081
-0000 000a  0000 000b  0000 000c  0000 000d  0000 000e  0000 000f  0000 000g  0000 000h  & 0x0101010101010101
-*/
-		//find the position from the bits the same way as from the bytes
-		uint64_t cumulativeBits = spreadBits * PrefixSumMultiplierConstant;
-		uint64_t bitRankFinder = ((rank + 1) & 0xFF) * PrefixSumMultiplierConstant;
-		uint64_t bitRankMask = (cumulativeBits | SignMask) - bitRankFinder;
-		int smallerBits = 8 - ((((bitRankMask & SignMask) >> 7) * PrefixSumMultiplierConstant) >> 56);
-		assert(smallerBits >= 0);
-		assert(smallerBits < 8);
-		return smallerBytes * 8 + smallerBits;
-	}
-
 	static uint64_t MortonHigh(uint64_t left, uint64_t right)
 	{
 		return Interleave(left >> 32, right >> 32);
@@ -0,0 +1,181 @@
+#ifndef WorkStealingPool_h
+#define WorkStealingPool_h
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ThreadReadAssertion.h"
+
+//lets the alignment worker threads share the independent parts of one read
+//each worker has its own task deque, the owner runs its newest tasks and idle workers steal the oldest ones
+//tasks run with the state of the worker which executes them
+template <typename State>
+class WorkStealingPool
+{
+	struct Batch
+	{
+		Batch(size_t count) :
+		remaining(count),
+		error(),
+		errorMutex()
+		{}
+		std::atomic<size_t> remaining;
+		std::exception_ptr error;
+		std::mutex errorMutex;
+	};
+	struct Job
+	{
+		std::function<void(State&)>* work;
+		Batch* batch;
+	};
+	struct Worker
+	{
+		Worker() :
+		mutex(),
+		jobs(),
+		queued(0),
+		spinsLeft(0)
+		{}
+		std::mutex mutex;
+		std::deque<Job> jobs;
+		std::atomic<size_t> queued;
+		//only touched by the worker itself
+		size_t spinsLeft;
+	};
+	//how many times a worker polls without sleeping after a successful steal
+	static constexpr size_t SpinsAfterSteal = 10000;
+public:
+	WorkStealingPool(size_t numWorkers) :
+	workers(numWorkers),
+	idle(0),
+	working(numWorkers)
+	{
+	}
+	size_t numWorkers() const
+	{
+		return workers.size();
+	}
+	//workers which have no read of their own and would take a task
+	size_t idleWorkers() const
+	{
+		return idle;
+	}
+	void beginIdle()
+	{
+		idle += 1;
+	}
+	void endIdle()
+	{
+		assert(idle > 0);
+		idle -= 1;
+	}
+	//a worker which has run out of reads keeps stealing until every worker has
+	void finishWorking()
+	{
+		assert(working > 0);
+		working -= 1;
+	}
+	bool anyoneWorking() const
+	{
+		return working > 0;
+	}
+	//returns once all tasks are done, rethrowing the first exception thrown by them
+	void run(size_t worker, State& state, std::vector<std::function<void(State&)>>& tasks)
+	{
+		assert(worker < workers.size());
+		if (tasks.size() == 0) return;
+		Batch batch { tasks.size() };
+		{
+			std::lock_guard<std::mutex> lock { workers[worker].mutex };
+			for (auto& task : tasks)
+			{
+				workers[worker].jobs.push_back(Job { &task, &batch });
+			}
+			workers[worker].queued += tasks.size();
+		}
+		while (batch.remaining > 0)
+		{
+			Job job;
+			if (popNewest(worker, job))
+			{
+				execute(job, state);
+				continue;
+			}
+			std::this_thread::yield();
+		}
+		if (batch.error) std::rethrow_exception(batch.error);
+	}
+	//runs one task queued by another worker, false if there was nothing to steal
+	bool trySteal(size_t worker, State& state)
+	{
+		for (size_t i = 1; i < workers.size(); i++)
+		{
+			size_t victim = (worker + i) % workers.size();
+			if (workers[victim].queued == 0) continue;
+			Job job;
+			{
+				std::lock_guard<std::mutex> lock { workers[victim].mutex };
+				if (workers[victim].jobs.size() == 0) continue;
+				job = workers[victim].jobs.front();
+				workers[victim].jobs.pop_front();
+				workers[victim].queued -= 1;
+			}
+			execute(job, state);
+			return true;
+		}
+		return false;
+	}
+	//steals a task or waits for one, false if nothing was stolen
+	//right after a successful steal the worker only yields since the victim is likely to queue more soon, eg the next band round of a tangle
+	bool stealOrWait(size_t worker, State& state, std::chrono::milliseconds sleep)
+	{
+		if (trySteal(worker, state))
+		{
+			workers[worker].spinsLeft = SpinsAfterSteal;
+			return true;
+		}
+		if (workers[worker].spinsLeft > 0)
+		{
+			workers[worker].spinsLeft -= 1;
+			std::this_thread::yield();
+			return false;
+		}
+		std::this_thread::sleep_for(sleep);
+		return false;
+	}
+private:
+	bool popNewest(size_t worker, Job& job)
+	{
+		if (workers[worker].queued == 0) return false;
+		std::lock_guard<std::mutex> lock { workers[worker].mutex };
+		if (workers[worker].jobs.size() == 0) return false;
+		job = workers[worker].jobs.back();
+		workers[worker].jobs.pop_back();
+		workers[worker].queued -= 1;
+		return true;
+	}
+	void execute(Job job, State& state)
+	{
+		try
+		{
+			(*job.work)(state);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock { job.batch->errorMutex };
+			if (!job.batch->error) job.batch->error = std::current_exception();
+		}
+		//the batch may be gone once this reaches zero
+		job.batch->remaining -= 1;
+	}
+	std::vector<Worker> workers;
+	std::atomic<size_t> idle;
+	std::atomic<size_t> working;
+};
+
+#endif
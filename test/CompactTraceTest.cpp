@@ -0,0 +1,228 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "UnitTest.h"
+#include "vg.pb.h"
+#include "GraphAlignerCommon.h"
+
+using Common = GraphAlignerCommon<size_t, int32_t, uint64_t>;
+using CompactTrace = Common::CompactTrace;
+using TraceEdit = Common::TraceEdit;
+using TraceChunk = Common::TraceChunk;
+
+struct Cell
+{
+	TraceEdit edit;
+	bool newNode;
+	int nodeId;
+	size_t nodeOffset;
+	size_t seqPos;
+};
+
+CompactTrace compact(const std::vector<Cell>& cells)
+{
+	CompactTrace result;
+	for (const auto& cell : cells)
+	{
+		result.append(cell.edit, 1, cell.newNode, cell.nodeId, cell.nodeOffset, cell.seqPos);
+	}
+	return result;
+}
+
+std::vector<Cell> expand(const CompactTrace& trace)
+{
+	std::vector<Cell> result;
+	trace.forEachChunk([&trace, &result](const TraceChunk& chunk)
+	{
+		CHECK(chunk.firstCell == result.size());
+		for (size_t i = 0; i < chunk.length; i++)
+		{
+			size_t nodeOffset = chunk.nodeOffset + (chunk.edit == TraceEdit::Insertion ? 0 : i);
+			size_t seqPos = chunk.seqPos + (chunk.edit == TraceEdit::Deletion ? 0 : i);
+			result.push_back(Cell { chunk.edit, chunk.newNode && i == 0, trace.path[chunk.pathIndex].nodeId, nodeOffset, seqPos });
+		}
+		return true;
+	});
+	return result;
+}
+
+bool sameCells(const std::vector<Cell>& left, const std::vector<Cell>& right)
+{
+	if (left.size() != right.size()) return false;
+	for (size_t i = 0; i < left.size(); i++)
+	{
+		if (left[i].edit != right[i].edit) return false;
+		if (left[i].newNode != right[i].newNode) return false;
+		if (left[i].nodeId != right[i].nodeId) return false;
+		if (left[i].nodeOffset != right[i].nodeOffset) return false;
+		if (left[i].seqPos != right[i].seqPos) return false;
+	}
+	return true;
+}
+
+void testRoundTripAllEdits()
+{
+	const TraceEdit M = TraceEdit::Match;
+	const TraceEdit X = TraceEdit::Mismatch;
+	const TraceEdit I = TraceEdit::Insertion;
+	const TraceEdit D = TraceEdit::Deletion;
+	std::vector<Cell> cells {
+		{ M, true, 2, 3, 10 },
+		{ M, false, 2, 4, 11 },
+		{ I, false, 2, 4, 12 },
+		{ I, false, 2, 4, 13 },
+		{ X, false, 2, 5, 14 },
+		{ D, false, 2, 6, 14 },
+		{ D, false, 2, 7, 14 },
+		{ M, false, 2, 8, 15 },
+		//deletion run continuing on the next node
+		{ D, true, 7, 0, 15 },
+		{ D, false, 7, 1, 15 },
+		{ M, false, 7, 2, 16 },
+		{ X, true, 5, 10, 17 },
+		{ M, false, 5, 11, 18 },
+		//match run continuing on the next node
+		{ M, true, 11, 0, 19 },
+		{ M, false, 11, 1, 20 },
+	};
+	CompactTrace trace = compact(cells);
+	CHECK(trace.cells == cells.size());
+	CHECK(trace.readStart == 10);
+	CHECK(trace.readEnd == 21);
+	CHECK(trace.path.size() == 4);
+	CHECK(trace.path[0].nodeId == 2 && trace.path[0].startOffset == 3 && trace.path[0].endOffset == 8);
+	CHECK(trace.path[1].nodeId == 7 && trace.path[1].startOffset == 0 && trace.path[1].endOffset == 2);
+	CHECK(trace.path[2].nodeId == 5 && trace.path[2].startOffset == 10 && trace.path[2].endOffset == 11);
+	CHECK(trace.path[3].nodeId == 11 && trace.path[3].startOffset == 0 && trace.path[3].endOffset == 1);
+	//M I X D M D M X M
+	CHECK(trace.edits.size() == 9);
+	CHECK(sameCells(expand(trace), cells));
+}
+
+void testRoundTripRevisitedNode()
+{
+	//a self loop enters the same node again from its start
+	std::vector<Cell> cells {
+		{ TraceEdit::Match, true, 3, 0, 0 },
+		{ TraceEdit::Match, false, 3, 1, 1 },
+		{ TraceEdit::Match, false, 3, 2, 2 },
+		{ TraceEdit::Match, true, 3, 0, 3 },
+		{ TraceEdit::Match, false, 3, 1, 4 },
+	};
+	CompactTrace trace = compact(cells);
+	CHECK(trace.path.size() == 2);
+	CHECK(trace.edits.size() == 1);
+	CHECK(sameCells(expand(trace), cells));
+}
+
+void testRunsAppendedAtOnce()
+{
+	CompactTrace single = compact({
+		{ TraceEdit::Mismatch, true, 4, 5, 7 },
+		{ TraceEdit::Match, false, 4, 6, 8 },
+		{ TraceEdit::Match, false, 4, 7, 9 },
+		{ TraceEdit::Match, false, 4, 8, 10 },
+		{ TraceEdit::Insertion, false, 4, 8, 11 },
+		{ TraceEdit::Insertion, false, 4, 8, 12 },
+	});
+	CompactTrace runs;
+	runs.append(TraceEdit::Mismatch, 1, true, 4, 5, 7);
+	runs.append(TraceEdit::Match, 3, false, 4, 6, 8);
+	runs.append(TraceEdit::Insertion, 2, false, 4, 8, 11);
+	CHECK(sameCells(expand(single), expand(runs)));
+	CHECK(runs.readEnd == single.readEnd);
+	CHECK(runs.path.size() == 1 && runs.path[0].endOffset == 8);
+}
+
+void testWalkStopsEarly()
+{
+	CompactTrace empty;
+	size_t calls = 0;
+	empty.forEachChunk([&calls](const TraceChunk& chunk) { calls += 1; return true; });
+	CHECK(calls == 0);
+	CompactTrace trace = compact({
+		{ TraceEdit::Match, true, 1, 0, 0 },
+		{ TraceEdit::Mismatch, false, 1, 1, 1 },
+		{ TraceEdit::Match, false, 1, 2, 2 },
+	});
+	trace.forEachChunk([&calls](const TraceChunk& chunk) { calls += 1; return chunk.edit != TraceEdit::Mismatch; });
+	CHECK(calls == 2);
+}
+
+//random cells following the trace rules, long enough for several walk checkpoints
+std::vector<Cell> randomCells(std::mt19937_64& rand, size_t count)
+{
+	std::vector<Cell> result;
+	int nodeId = 10;
+	size_t nodeOffset = rand() % 50;
+	size_t seqPos = rand() % 50;
+	result.push_back(Cell { TraceEdit::Match, true, nodeId, nodeOffset, seqPos });
+	const TraceEdit edits[4] { TraceEdit::Match, TraceEdit::Mismatch, TraceEdit::Insertion, TraceEdit::Deletion };
+	TraceEdit edit = TraceEdit::Match;
+	while (result.size() < count)
+	{
+		if (rand() % 3 == 0) edit = edits[rand() % 4];
+		if (edit == TraceEdit::Insertion)
+		{
+			seqPos += 1;
+			result.push_back(Cell { edit, false, nodeId, nodeOffset, seqPos });
+			continue;
+		}
+		bool newNode = rand() % 10 == 0;
+		if (newNode)
+		{
+			nodeId += 1 + rand() % 3;
+			nodeOffset = rand() % 50;
+		}
+		else
+		{
+			nodeOffset += 1;
+		}
+		if (edit != TraceEdit::Deletion) seqPos += 1;
+		result.push_back(Cell { edit, newNode, nodeId, nodeOffset, seqPos });
+	}
+	return result;
+}
+
+void testWalkFromSeqPos()
+{
+	std::mt19937_64 rand { 2 };
+	for (size_t test = 0; test < 20; test++)
+	{
+		std::vector<Cell> cells = randomCells(rand, 100 + rand() % 2000);
+		CompactTrace trace = compact(cells);
+		CHECK(sameCells(expand(trace), cells));
+		std::vector<TraceChunk> chunks;
+		trace.forEachChunk([&chunks](const TraceChunk& chunk) { chunks.push_back(chunk); return true; });
+		bool correct = true;
+		for (size_t seqPos = trace.readStart; seqPos <= trace.readEnd; seqPos++)
+		{
+			std::vector<TraceChunk> from;
+			trace.forEachChunkFrom(seqPos, [&from](const TraceChunk& chunk) { from.push_back(chunk); return true; });
+			//a suffix of all chunks, and the skipped ones end before seqPos
+			if (from.size() == 0 || from.size() > chunks.size()) { correct = false; continue; }
+			size_t skipped = chunks.size() - from.size();
+			for (size_t i = 0; i < from.size(); i++)
+			{
+				const TraceChunk& full = chunks[skipped + i];
+				if (from[i].firstCell != full.firstCell || from[i].length != full.length || from[i].edit != full.edit || from[i].pathIndex != full.pathIndex || from[i].newNode != full.newNode || from[i].nodeOffset != full.nodeOffset || from[i].seqPos != full.seqPos) correct = false;
+			}
+			if (skipped > 0 && cells[from[0].firstCell - 1].seqPos >= seqPos) correct = false;
+		}
+		CHECK(correct);
+		//the walk from the end of a long trace skips most of it
+		std::vector<TraceChunk> tail;
+		trace.forEachChunkFrom(trace.readEnd - 1, [&tail](const TraceChunk& chunk) { tail.push_back(chunk); return true; });
+		CHECK(cells.size() < 1000 || tail.size() * 4 < chunks.size());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	testRoundTripAllEdits();
+	testRoundTripRevisitedNode();
+	testRunsAppendedAtOnce();
+	testWalkStopsEarly();
+	testWalkFromSeqPos();
+	return UnitTest::finish("CompactTrace");
+}
@@ -0,0 +1,95 @@
+#include <limits>
+#include "UnitTest.h"
+#include "EpochBitvector.h"
+
+class EpochBitvectorTest
+{
+public:
+	static void setEpoch(EpochBitvector& vec, uint32_t epoch)
+	{
+		vec.epoch = epoch;
+	}
+	static uint32_t usedPages(const EpochBitvector& vec)
+	{
+		return vec.usedPages;
+	}
+};
+
+void testSetAndGetAcrossPages()
+{
+	EpochBitvector vec { 5000 };
+	CHECK(vec.none());
+	vec.set(0, true);
+	vec[1023] = true;
+	vec[1024] = true;
+	vec.set(4999, true);
+	CHECK(vec.get(0) && vec.get(1023) && vec.get(1024) && vec.get(4999));
+	CHECK(!vec.get(1) && !vec.get(2000) && !vec.get(4998));
+	CHECK(EpochBitvectorTest::usedPages(vec) == 3);
+	//setting a set bit or unsetting an unset bit doesn't change anything
+	vec.set(0, true);
+	vec.set(3000, false);
+	CHECK(EpochBitvectorTest::usedPages(vec) == 3);
+	CHECK(!vec.none());
+}
+
+void testEmptyPagesAreRecycled()
+{
+	EpochBitvector vec { 5000 };
+	vec.set(10, true);
+	vec.set(2000, true);
+	CHECK(EpochBitvectorTest::usedPages(vec) == 2);
+	vec.set(10, false);
+	CHECK(!vec.get(10));
+	//the page of bit 10 is free and is reused for a different part of the vector
+	vec.set(4000, true);
+	CHECK(EpochBitvectorTest::usedPages(vec) == 2);
+	CHECK(vec.get(4000) && vec.get(2000) && !vec.get(10) && !vec.get(4001));
+	vec.set(2000, false);
+	vec.set(4000, false);
+	CHECK(vec.none());
+}
+
+void testClearForgetsBitsAndZeroesStalePages()
+{
+	EpochBitvector vec { 5000 };
+	for (size_t i = 0; i < 5000; i += 7) vec.set(i, true);
+	vec.clear();
+	CHECK(vec.none());
+	bool anySet = false;
+	for (size_t i = 0; i < 5000; i++) anySet = anySet || vec.get(i);
+	CHECK(!anySet);
+	//reuses a page from before the clear, which must not leak the old bits
+	vec.set(3000, true);
+	CHECK(vec.get(3000) && !vec.get(3003) && !vec.get(3010));
+	CHECK(EpochBitvectorTest::usedPages(vec) == 1);
+}
+
+void testEpochWraparound()
+{
+	EpochBitvector vec { 5000 };
+	//directory entry stamped with epoch 1
+	vec.set(100, true);
+	EpochBitvectorTest::setEpoch(vec, std::numeric_limits<uint32_t>::max());
+	vec.set(2000, true);
+	CHECK(vec.get(2000));
+	CHECK(!vec.get(100));
+	vec.clear();
+	//wrapped back to epoch 1, the old entry of bit 100 must not look current
+	CHECK(!vec.get(100));
+	CHECK(!vec.get(2000));
+	CHECK(vec.none());
+	vec.set(100, true);
+	CHECK(vec.get(100) && !vec.get(101));
+	vec.clear();
+	CHECK(!vec.get(100));
+}
+
+int main(int argc, char** argv)
+{
+	testSetAndGetAcrossPages();
+	testEmptyPagesAreRecycled();
+	testClearForgetsBitsAndZeroesStalePages();
+	testEpochWraparound();
+	return UnitTest::finish("EpochBitvector");
+}
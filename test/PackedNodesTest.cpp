@@ -0,0 +1,159 @@
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+#include "UnitTest.h"
+#include "NodeSlice.h"
+
+using Slice = NodeSlice<size_t, int32_t, uint64_t, false>;
+using Item = Slice::NodeSliceMapItem;
+
+bool sameItem(const Item& left, const Item& right)
+{
+	if (left.exists != right.exists) return false;
+	if (left.minScore != right.minScore) return false;
+	if (left.startSlice.VP != right.startSlice.VP || left.startSlice.VN != right.startSlice.VN || left.startSlice.scoreEnd != right.startSlice.scoreEnd) return false;
+	if (left.endSlice.VP != right.endSlice.VP || left.endSlice.VN != right.endSlice.VN || left.endSlice.scoreEnd != right.endSlice.scoreEnd) return false;
+	for (size_t i = 0; i < Item::NUM_CHUNKS; i++)
+	{
+		if (left.HP[i] != right.HP[i] || left.HN[i] != right.HN[i]) return false;
+	}
+	return true;
+}
+
+//mix of the word shapes the encoder special cases: zero, all ones, small values and complements of small values
+uint64_t randomWord(std::mt19937_64& rand)
+{
+	switch(rand() % 5)
+	{
+		case 0:
+			return 0;
+		case 1:
+			return ~(uint64_t)0;
+		case 2:
+			return rand() % 1000;
+		case 3:
+			return ~(rand() % 1000);
+		default:
+			return rand();
+	}
+}
+
+std::map<size_t, Item> randomSlice(Slice& slice, std::mt19937_64& rand, size_t numNodes, size_t maxNode)
+{
+	std::map<size_t, Item> result;
+	slice.addEmptyNodeMap(numNodes, nullptr);
+	while (result.size() < numNodes)
+	{
+		size_t node = rand() % maxNode;
+		if (result.count(node) == 1) continue;
+		slice.addNode(node);
+		Item& item = slice.node(node);
+		item.exists = true;
+		item.startSlice = { randomWord(rand), randomWord(rand), (int32_t)(rand() % 2000) - 1000 };
+		item.endSlice = { randomWord(rand), randomWord(rand), (int32_t)(rand() % 2000) - 1000 };
+		for (size_t i = 0; i < Item::NUM_CHUNKS; i++)
+		{
+			item.HP[i] = randomWord(rand);
+			item.HN[i] = randomWord(rand);
+		}
+		item.minScore = (int32_t)(rand() % 2000) - 1000;
+		result[node] = item;
+	}
+	return result;
+}
+
+void testRoundTrip()
+{
+	std::mt19937_64 rand { 1 };
+	for (size_t numNodes : { 1, 3, 50, 500 })
+	{
+		Slice slice;
+		auto expected = randomSlice(slice, rand, numNodes, 100000);
+		slice.pack();
+		CHECK(slice.isPacked());
+		CHECK(slice.size() == expected.size());
+		const Slice& packed = slice;
+		bool allSame = true;
+		for (const auto& pair : expected)
+		{
+			allSame = allSame && packed.hasNode(pair.first) && sameItem(packed.node(pair.first), pair.second);
+		}
+		CHECK(allSame);
+		bool noneExtra = true;
+		for (size_t i = 0; i < 1000; i++)
+		{
+			size_t node = rand() % 100000;
+			if (expected.count(node) == 0) noneExtra = noneExtra && !packed.hasNode(node);
+		}
+		CHECK(noneExtra);
+		//iteration decodes sequentially in node order
+		auto iter = expected.begin();
+		bool iterationSame = true;
+		size_t count = 0;
+		for (auto pair : packed)
+		{
+			iterationSame = iterationSame && iter != expected.end() && pair.first == iter->first && sameItem(pair.second, iter->second);
+			++iter;
+			count++;
+		}
+		CHECK(iterationSame);
+		CHECK(count == expected.size());
+	}
+}
+
+void testLookupsAcrossManySlices()
+{
+	//more slices than the decode cache has slots
+	std::mt19937_64 rand { 2 };
+	std::vector<Slice> slices;
+	std::vector<std::map<size_t, Item>> expected;
+	slices.resize(20);
+	for (size_t i = 0; i < slices.size(); i++)
+	{
+		expected.push_back(randomSlice(slices[i], rand, 20, 1000));
+		slices[i].pack();
+	}
+	Item first = static_cast<const Slice&>(slices[0]).node(expected[0].begin()->first);
+	bool allSame = true;
+	for (size_t round = 0; round < 3; round++)
+	{
+		for (size_t i = 0; i < slices.size(); i++)
+		{
+			const Slice& slice = slices[(i * 7) % slices.size()];
+			for (const auto& pair : expected[(i * 7) % slices.size()])
+			{
+				allSame = allSame && sameItem(slice.node(pair.first), pair.second);
+			}
+		}
+	}
+	CHECK(allSame);
+	//items are returned by value, so they don't change when the cache is reused
+	CHECK(sameItem(first, expected[0].begin()->second));
+}
+
+void testPackingDoesNotAffectSharedMap()
+{
+	std::mt19937_64 rand { 3 };
+	Slice slice;
+	auto expected = randomSlice(slice, rand, 10, 1000);
+	Slice shared;
+	shared.shareNodeMap(slice, nullptr);
+	slice.pack();
+	CHECK(!shared.isPacked());
+	CHECK(shared.size() == expected.size());
+	bool allSame = true;
+	for (const auto& pair : expected)
+	{
+		allSame = allSame && sameItem(static_cast<const Slice&>(shared).node(pair.first), pair.second);
+	}
+	CHECK(allSame);
+}
+
+int main(int argc, char** argv)
+{
+	testRoundTrip();
+	testLookupsAcrossManySlices();
+	testPackingDoesNotAffectSharedMap();
+	return UnitTest::finish("PackedNodes");
+}
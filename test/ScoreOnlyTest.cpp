@@ -0,0 +1,60 @@
+#include <random>
+#include <string>
+#include <vector>
+#include "UnitTest.h"
+#include "vg.pb.h"
+#include "GraphAlignerWrapper.h"
+#include "TestGraph.h"
+
+AlignmentResult align(const AlignmentGraph& graph, const std::string& sequence, const std::vector<SeedHit>& seeds, bool scoreOnly)
+{
+	GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState reusableState { graph, 10 };
+	return AlignOneWay(graph, "read", sequence, 5, 10, 10000, true, false, seeds, reusableState, 0, -1, 0.66, 50, 0.9, -1, 0, 0, 0, scoreOnly);
+}
+
+void testRepeatCopiesAreBothAligned()
+{
+	std::mt19937_64 rand { 3 };
+	//two copies of the same repeat with different flanks
+	std::string repeat = randomSequence(rand, 200);
+	AlignmentGraph graph;
+	for (int copy = 0; copy < 2; copy++)
+	{
+		addNode(graph, 1 + copy * 3, randomSequence(rand, 100));
+		addNode(graph, 2 + copy * 3, repeat);
+		addNode(graph, 3 + copy * 3, randomSequence(rand, 100));
+		addEdge(graph, 1 + copy * 3, 2 + copy * 3);
+		addEdge(graph, 2 + copy * 3, 3 + copy * 3);
+	}
+	graph.Finalize(64);
+	std::string read = repeat.substr(20, 150);
+	std::vector<SeedHit> seeds;
+	seeds.emplace_back(2, 70, 50, 20, 20, false);
+	seeds.emplace_back(5, 70, 50, 20, 20, false);
+	//on the first copy's alignment
+	seeds.emplace_back(2, 120, 100, 20, 20, false);
+	AlignmentResult traced = align(graph, read, seeds, false);
+	AlignmentResult scoreOnly = align(graph, read, seeds, true);
+	CHECK(traced.seedsExtended == 2);
+	CHECK(scoreOnly.seedsExtended == 2);
+	CHECK(traced.alignments.size() == 2);
+	CHECK(scoreOnly.alignments.size() == 2);
+	for (size_t i = 0; i < scoreOnly.alignments.size() && i < traced.alignments.size(); i++)
+	{
+		CHECK(scoreOnly.alignments[i].trace == nullptr);
+		CHECK(scoreOnly.alignments[i].alignmentScore == traced.alignments[i].alignmentScore);
+		CHECK(scoreOnly.alignments[i].alignmentStart == traced.alignments[i].alignmentStart);
+		CHECK(scoreOnly.alignments[i].alignmentEnd == traced.alignments[i].alignmentEnd);
+	}
+	if (scoreOnly.alignments.size() == 2)
+	{
+		CHECK(scoreOnly.alignments[0].alignmentStartPos.node / 2 == 2);
+		CHECK(scoreOnly.alignments[1].alignmentStartPos.node / 2 == 5);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	testRepeatCopiesAreBothAligned();
+	return UnitTest::finish("ScoreOnly");
+}
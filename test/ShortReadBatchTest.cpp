@@ -0,0 +1,102 @@
+#include <random>
+#include <string>
+#include <vector>
+#include "UnitTest.h"
+#include "vg.pb.h"
+#include "GraphAlignerWrapper.h"
+#include "TestGraph.h"
+
+char otherBase(std::mt19937_64& rand, char base)
+{
+	char result = base;
+	while (result == base) result = "ACGT"[rand() % 4];
+	return result;
+}
+
+void testBatchScoresMatchSeedExtension()
+{
+	std::mt19937_64 rand { 1 };
+	//a chain of nodes with a SNP bubble in the middle of each link
+	std::vector<std::string> chain;
+	for (size_t i = 0; i < 6; i++) chain.push_back(randomSequence(rand, 80));
+	AlignmentGraph graph;
+	for (size_t i = 0; i < chain.size(); i++) addNode(graph, 1 + i * 3, chain[i]);
+	std::vector<std::string> snps;
+	for (size_t i = 0; i + 1 < chain.size(); i++)
+	{
+		std::string ref = randomSequence(rand, 1);
+		std::string alt { otherBase(rand, ref[0]) };
+		addNode(graph, 2 + i * 3, ref);
+		addNode(graph, 3 + i * 3, alt);
+		addEdge(graph, 1 + i * 3, 2 + i * 3);
+		addEdge(graph, 1 + i * 3, 3 + i * 3);
+		addEdge(graph, 2 + i * 3, 4 + i * 3);
+		addEdge(graph, 3 + i * 3, 4 + i * 3);
+		snps.push_back(ref);
+	}
+	graph.Finalize(64);
+	std::string reference;
+	std::vector<size_t> chainStart;
+	for (size_t i = 0; i < chain.size(); i++)
+	{
+		chainStart.push_back(reference.size());
+		reference += chain[i];
+		if (i < snps.size()) reference += snps[i];
+	}
+	std::vector<std::string> seq_ids;
+	std::vector<std::string> sequences;
+	std::vector<SeedHit> seeds;
+	for (size_t i = 0; i < 40; i++)
+	{
+		size_t length = 100 + rand() % 100;
+		size_t start = rand() % (reference.size() - length);
+		std::string read = reference.substr(start, length);
+		//a few substitutions away from the seed
+		for (size_t j = 0; j < rand() % 4; j++)
+		{
+			size_t pos = rand() % length;
+			read[pos] = otherBase(rand, read[pos]);
+		}
+		//seed ending in the middle of the read, on a chain node
+		size_t seqPos = length / 2;
+		size_t node = 0;
+		while (chainStart[node] + chain[node].size() <= start + seqPos) node++;
+		if (chainStart[node] > start + seqPos) seqPos = chainStart[node] - start;
+		size_t nodeOffset = start + seqPos - chainStart[node];
+		SeedHit seed { (int)(1 + node * 3), nodeOffset, seqPos, 20, 20, false };
+		seq_ids.push_back("read" + std::to_string(i));
+		sequences.push_back(read);
+		seeds.push_back(seed);
+	}
+	GraphAlignerCommon<size_t, int32_t, uint64_t>::AlignerGraphsizedState reusableState { graph, 10 };
+	std::vector<std::vector<SeedHit>> orderedSeeds;
+	for (size_t i = 0; i < seeds.size(); i++)
+	{
+		orderedSeeds.emplace_back(1, seeds[i]);
+		OrderSeeds(graph, orderedSeeds.back());
+		seeds[i] = orderedSeeds.back()[0];
+	}
+	std::vector<AlignmentResult> batched = AlignShortReadBatch(graph, seq_ids, sequences, 5, 10, 10000, true, seeds, reusableState, 0.66, 50);
+	CHECK(batched.size() == sequences.size());
+	size_t compared = 0;
+	for (size_t i = 0; i < sequences.size(); i++)
+	{
+		if (batched[i].alignments.size() == 0) continue;
+		AlignmentResult single = AlignOneWay(graph, seq_ids[i], sequences[i], 5, 10, 10000, true, true, orderedSeeds[i], reusableState, 1, -1, 0.66, 50, 0.9, -1, 0, 0, 0, false);
+		CHECK(batched[i].alignments.size() == 1);
+		CHECK(single.alignments.size() == 1);
+		if (single.alignments.size() != 1) continue;
+		CHECK(batched[i].alignments[0].alignmentScore == single.alignments[0].alignmentScore);
+		CHECK(batched[i].alignments[0].alignmentStart == single.alignments[0].alignmentStart);
+		CHECK(batched[i].alignments[0].alignmentEnd == single.alignments[0].alignmentEnd);
+		compared += 1;
+	}
+	//almost all of the reads are close enough to the graph to be batched
+	CHECK(compared * 10 >= sequences.size() * 9);
+}
+
+int main(int argc, char** argv)
+{
+	testBatchScoresMatchSeedExtension();
+	return UnitTest::finish("ShortReadBatch");
+}
@@ -0,0 +1,83 @@
+#include <vector>
+#include "UnitTest.h"
+#include "SliceArena.h"
+
+void testFreedBlocksAreReused()
+{
+	SliceArena arena;
+	void* first = arena.allocate(100);
+	void* second = arena.allocate(100);
+	void* other = arena.allocate(1000);
+	CHECK(first != second);
+	arena.deallocate(second, 100);
+	//same size class
+	void* reused = arena.allocate(120);
+	CHECK(reused == second);
+	//different size class
+	void* notReused = arena.allocate(20);
+	CHECK(notReused != second);
+	arena.deallocate(first, 100);
+	arena.deallocate(other, 1000);
+	arena.deallocate(reused, 120);
+	arena.deallocate(notReused, 20);
+}
+
+void testRewindsWhenEverythingIsFreed()
+{
+	SliceArena arena;
+	void* first = arena.allocate(64);
+	void* second = arena.allocate(64);
+	size_t reserved = arena.reservedBytes();
+	CHECK(reserved > 0);
+	arena.deallocate(first, 64);
+	arena.deallocate(second, 64);
+	//rewound to the start of the first chunk, and the chunk is kept
+	void* afterRewind = arena.allocate(64);
+	CHECK(afterRewind == first);
+	CHECK(arena.reservedBytes() == reserved);
+	arena.deallocate(afterRewind, 64);
+}
+
+void testLargeAllocationsGetTheirOwnChunk()
+{
+	SliceArena arena;
+	void* small = arena.allocate(16);
+	size_t reserved = arena.reservedBytes();
+	void* large = arena.allocate(reserved * 2);
+	CHECK(arena.reservedBytes() >= reserved * 3);
+	CHECK(large != small);
+	arena.deallocate(large, reserved * 2);
+	arena.deallocate(small, 16);
+	//the chunks are reused after the rewind
+	void* largeAgain = arena.allocate(reserved * 2);
+	CHECK(arena.reservedBytes() >= reserved * 3 && arena.reservedBytes() < reserved * 5);
+	arena.deallocate(largeAgain, reserved * 2);
+}
+
+void testAllocatorWithAndWithoutArena()
+{
+	SliceArena arena;
+	{
+		std::vector<size_t, ArenaAllocator<size_t>> numbers { ArenaAllocator<size_t> { &arena } };
+		for (size_t i = 0; i < 1000; i++) numbers.push_back(i);
+		bool correct = true;
+		for (size_t i = 0; i < 1000; i++) correct = correct && numbers[i] == i;
+		CHECK(correct);
+		CHECK(arena.reservedBytes() > 0);
+	}
+	std::vector<size_t, ArenaAllocator<size_t>> global;
+	for (size_t i = 0; i < 1000; i++) global.push_back(i);
+	CHECK(global.get_allocator().arena == nullptr);
+	CHECK(global.back() == 999);
+	CHECK(ArenaAllocator<size_t> { &arena } == ArenaAllocator<char> { &arena });
+	CHECK(ArenaAllocator<size_t> { &arena } != ArenaAllocator<size_t> {});
+}
+
+int main(int argc, char** argv)
+{
+	testFreedBlocksAreReused();
+	testRewindsWhenEverythingIsFreed();
+	testLargeAllocationsGetTheirOwnChunk();
+	testAllocatorWithAndWithoutArena();
+	return UnitTest::finish("SliceArena");
+}
@@ -0,0 +1,31 @@
+#ifndef TestGraph_h
+#define TestGraph_h
+
+#include <random>
+#include <string>
+#include "AlignmentGraph.h"
+#include "CommonUtils.h"
+
+//small graphs for the aligner tests
+
+inline std::string randomSequence(std::mt19937_64& rand, size_t length)
+{
+	std::string result;
+	for (size_t i = 0; i < length; i++) result += "ACGT"[rand() % 4];
+	return result;
+}
+
+//one forward and one reverse complement node per original node, like the bigraph built from a GFA
+inline void addNode(AlignmentGraph& graph, int nodeId, const std::string& sequence)
+{
+	graph.AddNode(nodeId * 2, sequence, std::to_string(nodeId), false, { 0, sequence.size() });
+	graph.AddNode(nodeId * 2 + 1, CommonUtils::ReverseComplement(sequence), std::to_string(nodeId), true, { 0, sequence.size() });
+}
+
+inline void addEdge(AlignmentGraph& graph, int from, int to)
+{
+	graph.AddEdgeNodeId(from * 2, to * 2, 0);
+	graph.AddEdgeNodeId(to * 2 + 1, from * 2 + 1, 0);
+}
+
+#endif
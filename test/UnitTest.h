@@ -0,0 +1,34 @@
+#ifndef UnitTest_h
+#define UnitTest_h
+
+#include <iostream>
+
+//minimal checks for the unit tests, independent of NDEBUG so they also run in release builds
+namespace UnitTest
+{
+	inline size_t& failures()
+	{
+		static size_t count = 0;
+		return count;
+	}
+	inline void check(bool result, const char* expression, const char* file, int line)
+	{
+		if (result) return;
+		std::cerr << file << ":" << line << ": check failed: " << expression << std::endl;
+		failures() += 1;
+	}
+	inline int finish(const char* name)
+	{
+		if (failures() > 0)
+		{
+			std::cerr << name << ": " << failures() << " checks failed" << std::endl;
+			return 1;
+		}
+		std::cerr << name << ": ok" << std::endl;
+		return 0;
+	}
+}
+
+#define CHECK(expression) UnitTest::check((expression), #expression, __FILE__, __LINE__)
+
+#endif
@@ -0,0 +1,82 @@
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "UnitTest.h"
+#include "WorkStealingPool.h"
+
+//the states only record which worker ran a task
+struct TestState
+{
+	size_t worker;
+};
+
+void testOwnerRunsNewestAndThievesTakeOldest()
+{
+	WorkStealingPool<TestState> pool { 2 };
+	TestState owner { 0 };
+	TestState thief { 1 };
+	std::vector<size_t> order;
+	std::vector<size_t> ranOn;
+	std::vector<std::function<void(TestState&)>> tasks;
+	for (size_t i = 0; i < 4; i++)
+	{
+		tasks.emplace_back([&pool, &thief, &order, &ranOn, i](TestState& state)
+		{
+			order.push_back(i);
+			ranOn.push_back(state.worker);
+			//the first task the owner runs lets the other worker steal one
+			if (order.size() == 1) CHECK(pool.trySteal(1, thief));
+		});
+	}
+	pool.run(0, owner, tasks);
+	CHECK((order == std::vector<size_t> { 3, 0, 2, 1 }));
+	CHECK((ranOn == std::vector<size_t> { 0, 1, 0, 0 }));
+}
+
+void testNothingToSteal()
+{
+	WorkStealingPool<TestState> pool { 3 };
+	TestState thief { 2 };
+	CHECK(!pool.trySteal(2, thief));
+	//a worker doesn't steal from itself
+	std::vector<std::function<void(TestState&)>> tasks;
+	bool stoleOwn = true;
+	tasks.emplace_back([](TestState& state) {});
+	tasks.emplace_back([&pool, &stoleOwn](TestState& state) { stoleOwn = pool.trySteal(0, state); });
+	TestState owner { 0 };
+	pool.run(0, owner, tasks);
+	CHECK(!stoleOwn);
+}
+
+void testFirstExceptionIsRethrownAfterAllTasks()
+{
+	WorkStealingPool<TestState> pool { 2 };
+	TestState owner { 0 };
+	size_t ran = 0;
+	std::vector<std::function<void(TestState&)>> tasks;
+	tasks.emplace_back([&ran](TestState& state) { ran += 1; throw std::runtime_error { "first" }; });
+	tasks.emplace_back([&ran](TestState& state) { ran += 1; });
+	tasks.emplace_back([&ran](TestState& state) { ran += 1; throw std::runtime_error { "last" }; });
+	bool threw = false;
+	try
+	{
+		pool.run(0, owner, tasks);
+	}
+	catch (const std::runtime_error& e)
+	{
+		threw = true;
+		//the newest task runs first
+		CHECK(std::string { e.what() } == "last");
+	}
+	CHECK(threw);
+	CHECK(ran == 3);
+}
+
+int main(int argc, char** argv)
+{
+	testOwnerRunsNewestAndThievesTakeOldest();
+	testNothingToSteal();
+	testFirstExceptionIsRethrownAfterAllTasks();
+	return UnitTest::finish("WorkStealingPool");
+}